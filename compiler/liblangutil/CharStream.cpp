@@ -51,8 +51,16 @@
  */
 
 #include <liblangutil/CharStream.h>
+#include <liblangutil/Common.h>
 #include <liblangutil/Exceptions.h>
 
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 using namespace std;
 using namespace solidity;
 using namespace solidity::langutil;
@@ -81,6 +89,154 @@ char CharStream::setPosition(size_t _location)
 	return get();
 }
 
+namespace
+{
+
+#if defined(__SSE2__)
+/// @returns all-ones in the bytes of @a _v that lie in [_lo, _hi].
+/// Bytes >= 0x80 compare as negative, so the bounds have to be ASCII.
+__m128i inRange(__m128i _v, char _lo, char _hi)
+{
+	return _mm_and_si128(
+		_mm_cmpgt_epi8(_v, _mm_set1_epi8(char(_lo - 1))),
+		_mm_cmplt_epi8(_v, _mm_set1_epi8(char(_hi + 1)))
+	);
+}
+
+__m128i equalTo(__m128i _v, char _c)
+{
+	return _mm_cmpeq_epi8(_v, _mm_set1_epi8(_c));
+}
+#endif
+
+/// Character classes for prefixLength. The vector overloads mark the members
+/// among 16 characters with all-ones bytes.
+struct WhiteSpace
+{
+	static bool contains(char _c) { return isWhiteSpace(_c); }
+#if defined(__SSE2__)
+	static __m128i contains(__m128i _v)
+	{
+		return _mm_or_si128(
+			_mm_or_si128(equalTo(_v, ' '), equalTo(_v, '\n')),
+			_mm_or_si128(equalTo(_v, '\t'), equalTo(_v, '\r'))
+		);
+	}
+#endif
+};
+
+struct IdentifierPart
+{
+	static bool contains(char _c) { return isIdentifierPart(_c); }
+#if defined(__SSE2__)
+	static __m128i contains(__m128i _v)
+	{
+		return _mm_or_si128(
+			_mm_or_si128(inRange(_v, 'a', 'z'), inRange(_v, 'A', 'Z')),
+			_mm_or_si128(inRange(_v, '0', '9'), _mm_or_si128(equalTo(_v, '_'), equalTo(_v, '$')))
+		);
+	}
+#endif
+};
+
+struct HexDigit
+{
+	static bool contains(char _c) { return isHexDigit(_c); }
+#if defined(__SSE2__)
+	static __m128i contains(__m128i _v)
+	{
+		return _mm_or_si128(
+			inRange(_v, '0', '9'),
+			_mm_or_si128(inRange(_v, 'a', 'f'), inRange(_v, 'A', 'F'))
+		);
+	}
+#endif
+};
+
+/// Everything except 0x0a-0x0d and the lead bytes 0xc2 (NEL) and 0xe2 (LS, PS).
+struct NoLineTerminatorStart
+{
+	static bool contains(char _c)
+	{
+		return !(0x0a <= _c && _c <= 0x0d) && uint8_t(_c) != 0xc2 && uint8_t(_c) != 0xe2;
+	}
+#if defined(__SSE2__)
+	static __m128i contains(__m128i _v)
+	{
+		__m128i starts = _mm_or_si128(
+			inRange(_v, 0x0a, 0x0d),
+			_mm_or_si128(equalTo(_v, char(0xc2)), equalTo(_v, char(0xe2)))
+		);
+		return _mm_andnot_si128(starts, _mm_set1_epi8(char(0xff)));
+	}
+#endif
+};
+
+/// @returns the length of the longest prefix of [_begin, _end) whose characters
+/// belong to @a CharClass.
+template <class CharClass>
+size_t prefixLength(char const* _begin, char const* _end)
+{
+	char const* it = _begin;
+#if defined(__SSE2__)
+	for (; _end - it >= 16; it += 16)
+	{
+		__m128i chunk = _mm_loadu_si128(reinterpret_cast<__m128i const*>(it));
+		unsigned nonMembers = ~unsigned(_mm_movemask_epi8(CharClass::contains(chunk))) & 0xffffu;
+		if (nonMembers != 0)
+			return size_t(it - _begin) + size_t(__builtin_ctz(nonMembers));
+	}
+#endif
+	while (it != _end && CharClass::contains(*it))
+		++it;
+	return size_t(it - _begin);
+}
+
+}
+
+char CharStream::skip(size_t _chars)
+{
+	m_position += _chars;
+	return isPastEndOfInput() ? 0 : m_source[m_position];
+}
+
+char CharStream::advanceWhileWhiteSpace()
+{
+	if (isPastEndOfInput())
+		return 0;
+	return skip(prefixLength<WhiteSpace>(m_source.data() + m_position, m_source.data() + m_source.size()));
+}
+
+char CharStream::advanceWhileIdentifierPart()
+{
+	if (isPastEndOfInput())
+		return 0;
+	return skip(prefixLength<IdentifierPart>(m_source.data() + m_position, m_source.data() + m_source.size()));
+}
+
+char CharStream::advanceWhileHexDigit()
+{
+	if (isPastEndOfInput())
+		return 0;
+	return skip(prefixLength<HexDigit>(m_source.data() + m_position, m_source.data() + m_source.size()));
+}
+
+char CharStream::advanceToLineTerminatorCandidate()
+{
+	if (isPastEndOfInput())
+		return 0;
+	return skip(prefixLength<NoLineTerminatorStart>(m_source.data() + m_position, m_source.data() + m_source.size()));
+}
+
+char CharStream::advanceTo(char _c)
+{
+	if (isPastEndOfInput())
+		return 0;
+	size_t const remaining = m_source.size() - m_position;
+	void const* found = memchr(m_source.data() + m_position, _c, remaining);
+	return skip(found ? size_t(static_cast<char const*>(found) - (m_source.data() + m_position)) : remaining);
+}
+
 string CharStream::lineAtPosition(int _position) const
 {
 	// if _position points to \n, it returns the line before the \n
@@ -106,14 +262,16 @@ tuple<int, int> CharStream::translatePositionToLineColumn(int _position) const
 {
 	using size_type = string::size_type;
 	size_type searchPosition = min<size_type>(m_source.size(), _position);
-	int lineNumber = count(m_source.begin(), m_source.begin() + searchPosition, '\n');
-	size_type lineStart;
-	if (searchPosition == 0)
-		lineStart = 0;
-	else
-	{
-		lineStart = m_source.rfind('\n', searchPosition - 1);
-		lineStart = lineStart == string::npos ? 0 : lineStart + 1;
-	}
+	// the line of the position is the last one that starts not after it
+	auto next = upper_bound(m_lineStarts.begin(), m_lineStarts.end(), searchPosition);
+	int lineNumber = next - m_lineStarts.begin() - 1;
+	size_type lineStart = *prev(next);
 	return tuple<int, int>(lineNumber, searchPosition - lineStart);
 }
+
+void CharStream::computeLineStarts()
+{
+	for (size_t i = 0; i < m_source.size(); ++i)
+		if (m_source[i] == '\n')
+			m_lineStarts.push_back(i + 1);
+}
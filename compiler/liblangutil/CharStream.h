@@ -55,6 +55,7 @@
 #include <cstdint>
 #include <string>
 #include <tuple>
+#include <vector>
 
 namespace solidity::langutil
 {
@@ -69,7 +70,7 @@ class CharStream
 public:
 	CharStream() = default;
 	explicit CharStream(std::string const& _source, std::string const& name):
-		m_source(_source), m_name(name) {}
+		m_source(_source), m_name(name) { computeLineStarts(); }
 
 	int position() const { return m_position; }
 	bool isPastEndOfInput(size_t _charsForward = 0) const { return (m_position + _charsForward) >= m_source.size(); }
@@ -84,6 +85,24 @@ public:
 	/// @returns The character of the current location after update is returned.
 	char setPosition(size_t _location);
 
+	///@{
+	///@name Bulk advancing
+	/// Advance over a run of characters of one class, inspecting 16 characters at
+	/// a time where SSE2 is available.
+	/// @returns the character of the current location after update (0 at the end of input).
+	/// Advances over characters satisfying isWhiteSpace.
+	char advanceWhileWhiteSpace();
+	/// Advances over characters satisfying isIdentifierPart.
+	char advanceWhileIdentifierPart();
+	/// Advances over characters satisfying isHexDigit.
+	char advanceWhileHexDigit();
+	/// Advances to the next character that can start a line terminator, i.e. one of
+	/// 0x0a-0x0d or the first byte of the UTF-8 encoding of NEL, LS or PS.
+	char advanceToLineTerminatorCandidate();
+	/// Advances to the next occurrence of @a _c.
+	char advanceTo(char _c);
+	///@}
+
 	void reset() { m_position = 0; }
 
 	std::string const& source() const noexcept { return m_source; }
@@ -94,13 +113,20 @@ public:
 	/// Functions that help pretty-printing parse errors
 	/// Do only use in error cases, they are quite expensive.
 	std::string lineAtPosition(int _position) const;
+	/// Takes O(log(number of lines)), so it can be used for every AST node.
 	std::tuple<int, int> translatePositionToLineColumn(int _position) const;
 	///@}
 
 private:
+	void computeLineStarts();
+	/// Moves the position by @a _chars and @returns the character there (0 at the end of input).
+	char skip(size_t _chars);
+
 	std::string m_source;
 	std::string m_name;
 	size_t m_position{0};
+	/// Positions of the first characters of lines, sorted.
+	std::vector<size_t> m_lineStarts{0};
 };
 
 }
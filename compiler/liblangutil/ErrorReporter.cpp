@@ -36,6 +36,12 @@ ErrorReporter& ErrorReporter::operator=(ErrorReporter const& _errorReporter)
 	return *this;
 }
 
+void ErrorReporter::merge(ErrorList const& _errorList)
+{
+	for (auto const& error: _errorList)
+		if (!checkForExcessiveErrors(error->type()))
+			m_errorList.push_back(error);
+}
 
 void ErrorReporter::warning(string const& _description)
 {
@@ -50,6 +50,10 @@ public:
 		m_errorList += _errorList;
 	}
 
+	/// Appends errors collected by another reporter, counting them towards the limits
+	/// like errors reported here directly. Throws a FatalError if there are too many errors.
+	void merge(ErrorList const& _errorList);
+
 	void warning(std::string const& _description);
 
 	void warning(SourceLocation const& _location, std::string const& _description);
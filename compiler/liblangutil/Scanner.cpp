@@ -261,8 +261,13 @@ Token Scanner::selectToken(char _next, Token _then, Token _else)
 bool Scanner::skipWhitespace()
 {
 	int const startPosition = sourcePos();
-	while (isWhiteSpace(m_char))
+	// m_char may be a whitespace that stands for a just skipped comment, so
+	// it is consumed separately before the run in the source.
+	if (isWhiteSpace(m_char))
+	{
 		advance();
+		m_char = m_source->advanceWhileWhiteSpace();
+	}
 	// Return whether or not we skipped any characters.
 	return sourcePos() != startPosition;
 }
@@ -277,8 +282,12 @@ Token Scanner::skipSingleLineComment()
 {
 	// Line terminator is not part of the comment. If it is a
 	// non-ascii line terminator, it will result in a parser error.
-	while (!isUnicodeLinebreak())
-		if (!advance()) break;
+	while (true)
+	{
+		m_char = m_source->advanceToLineTerminatorCandidate();
+		if (isUnicodeLinebreak() || !advance())
+			break;
+	}
 
 	return Token::Whitespace;
 }
@@ -315,6 +324,12 @@ Token Scanner::scanSingleLineDocComment()
 
 	while (!isSourcePastEndOfInput())
 	{
+		int const runStart = sourcePos();
+		m_char = m_source->advanceToLineTerminatorCandidate();
+		addCommentLiteralChars(runStart);
+		if (isSourcePastEndOfInput())
+			break;
+
 		if (tryScanEndOfLine())
 		{
 			// check if next line is also a documentation comment
@@ -346,6 +361,9 @@ Token Scanner::skipMultiLineComment()
 	advance();
 	while (!isSourcePastEndOfInput())
 	{
+		m_char = m_source->advanceTo('*');
+		if (isSourcePastEndOfInput())
+			break;
 		char ch = m_char;
 		advance();
 
@@ -428,7 +446,7 @@ Token Scanner::scanSlash()
 			// doxygen style /// comment
 			Token comment;
 			m_skippedComments[NextNext].location.start = firstSlashPosition;
-			m_skippedComments[NextNext].location.source = m_source;
+			m_skippedComments[NextNext].location.source = m_source.get();
 			comment = scanSingleLineDocComment();
 			m_skippedComments[NextNext].location.end = sourcePos();
 			m_skippedComments[NextNext].token = comment;
@@ -455,7 +473,7 @@ Token Scanner::scanSlash()
 			// we actually have a multiline documentation comment
 			Token comment;
 			m_skippedComments[NextNext].location.start = firstSlashPosition;
-			m_skippedComments[NextNext].location.source = m_source;
+			m_skippedComments[NextNext].location.source = m_source.get();
 			comment = scanMultiLineDocComment();
 			m_skippedComments[NextNext].location.end = sourcePos();
 			m_skippedComments[NextNext].token = comment;
@@ -681,7 +699,7 @@ void Scanner::scanToken()
 	}
 	while (token == Token::Whitespace);
 	m_tokens[NextNext].location.end = sourcePos();
-	m_tokens[NextNext].location.source = m_source;
+	m_tokens[NextNext].location.source = m_source.get();
 	m_tokens[NextNext].token = token;
 	m_tokens[NextNext].extendedTokenInfo = make_tuple(m, n);
 }
@@ -789,6 +807,26 @@ Token Scanner::scanHexString()
 	bool allowUnderscore = false;
 	while (m_char != quote && !isSourcePastEndOfInput())
 	{
+		// Decode the run of complete hex bytes in one go.
+		int const runStart = sourcePos();
+		m_source->advanceWhileHexDigit();
+		int const byteCount = (sourcePos() - runStart) / 2;
+		m_char = m_source->setPosition(runStart + 2 * byteCount);
+		if (byteCount > 0)
+		{
+			// The digits are known to be valid, so they can be decoded without branches:
+			// the low nibble of '0'-'9', 'a'-'f' and 'A'-'F' plus 9 for letters.
+			auto nibble = [](char _c) { return (_c & 0xf) + 9 * ((_c >> 6) & 1); };
+			char const* digits = m_source->source().data() + runStart;
+			string& bytes = m_tokens[NextNext].literal;
+			size_t const offset = bytes.size();
+			bytes.resize(offset + size_t(byteCount));
+			for (int i = 0; i < byteCount; ++i)
+				bytes[offset + size_t(i)] = char(nibble(digits[2 * i]) << 4 | nibble(digits[2 * i + 1]));
+			allowUnderscore = true;
+			continue;
+		}
+
 		char c = m_char;
 
 		if (scanHexByte(c))
@@ -928,10 +966,17 @@ tuple<Token, unsigned, unsigned> Scanner::scanIdentifierOrKeyword()
 {
 	solAssert(isIdentifierStart(m_char), "");
 	LiteralScope literal(this, LITERAL_TYPE_STRING);
-	addLiteralCharAndAdvance();
+	int const start = sourcePos();
+	advance();
 	// Scan the rest of the identifier characters.
-	while (isIdentifierPart(m_char) || (m_char == '.' && m_supportPeriodInIdentifier))
-		addLiteralCharAndAdvance();
+	while (true)
+	{
+		m_char = m_source->advanceWhileIdentifierPart();
+		if (m_char != '.' || !m_supportPeriodInIdentifier)
+			break;
+		advance();
+	}
+	addLiteralChars(start);
 	literal.complete();
 	return TokenTraits::fromIdentifierOrKeyword(m_tokens[NextNext].literal);
 }
@@ -191,6 +191,9 @@ private:
 	inline void addLiteralChar(char c) { m_tokens[NextNext].literal.push_back(c); }
 	inline void addCommentLiteralChar(char c) { m_skippedComments[NextNext].literal.push_back(c); }
 	inline void addLiteralCharAndAdvance() { addLiteralChar(m_char); advance(); }
+	/// Appends the source characters from @a _start up to the current position.
+	inline void addLiteralChars(int _start) { m_tokens[NextNext].literal.append(m_source->source(), _start, sourcePos() - _start); }
+	inline void addCommentLiteralChars(int _start) { m_skippedComments[NextNext].literal.append(m_source->source(), _start, sourcePos() - _start); }
 	void addUnicodeAsUTF8(unsigned codepoint);
 	///@}
 
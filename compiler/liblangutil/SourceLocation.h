@@ -42,7 +42,7 @@ struct SourceLocation
 {
 	bool operator==(SourceLocation const& _other) const
 	{
-		return source.get() == _other.source.get() && start == _other.start && end == _other.end;
+		return source == _other.source && start == _other.start && end == _other.end;
 	}
 	bool operator!=(SourceLocation const& _other) const { return !operator==(_other); }
 
@@ -56,14 +56,14 @@ struct SourceLocation
 
 	inline bool contains(SourceLocation const& _other) const
 	{
-		if (!hasText() || !_other.hasText() || source.get() != _other.source.get())
+		if (!hasText() || !_other.hasText() || source != _other.source)
 			return false;
 		return start <= _other.start && _other.end <= end;
 	}
 
 	inline bool intersects(SourceLocation const& _other) const
 	{
-		if (!hasText() || !_other.hasText() || source.get() != _other.source.get())
+		if (!hasText() || !_other.hasText() || source != _other.source)
 			return false;
 		return _other.start < end && start < _other.end;
 	}
@@ -110,10 +110,13 @@ struct SourceLocation
 
 	int start = -1;
 	int end = -1;
-	std::shared_ptr<CharStream> source;
+	/// Not owned, the character stream is kept alive by the scanner of the source
+	/// or, for an imported AST, by the compiler stack.
+	CharStream const* source = nullptr;
 };
 
-SourceLocation const parseSourceLocation(std::string const& _input, std::string const& _sourceName, size_t _maxIndex = -1);
+/// @a _source is not owned and has to outlive the location.
+SourceLocation const parseSourceLocation(std::string const& _input, CharStream const* _source, size_t _maxIndex = -1);
 
 /// Stream output for Location (used e.g. in boost exceptions).
 inline std::ostream& operator<<(std::ostream& _out, SourceLocation const& _location)
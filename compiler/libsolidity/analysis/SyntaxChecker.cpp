@@ -147,6 +147,10 @@ bool SyntaxChecker::visit(PragmaDirective const& _pragma)
 	{
 		return true;
 	}
+	else if (_pragma.literals()[0] == "optimizeStorageLayout")
+	{
+		return true;
+	}
 	else if (_pragma.literals()[0] == "msgValue")
 	{
 		if (m_msgValuePragmaFound) {
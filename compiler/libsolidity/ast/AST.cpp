@@ -161,6 +161,7 @@ FunctionDefinition const* ContractDefinition::onBounceFunction() const
 
 vector<EventDefinition const*> const& ContractDefinition::interfaceEvents() const
 {
+	lock_guard<recursive_mutex> lock(TypeProvider::mutex());
 	if (!m_interfaceEvents)
 	{
 		set<string> eventsSeen;
@@ -186,6 +187,7 @@ vector<EventDefinition const*> const& ContractDefinition::interfaceEvents() cons
 
 vector<pair<util::FixedHash<4>, FunctionTypePointer>> const& ContractDefinition::interfaceFunctionList() const
 {
+	lock_guard<recursive_mutex> lock(TypeProvider::mutex());
 	if (!m_interfaceFunctionList)
 	{
 		set<string> signaturesSeen;
@@ -37,6 +37,7 @@ namespace solidity::frontend
 {
 
 class Type;
+class FunctionType;
 using TypePointer = Type const*;
 
 struct ASTAnnotation
@@ -108,6 +109,18 @@ struct ContractDefinitionAnnotation: TypeDeclarationAnnotation, StructurallyDocu
 	/// Mapping containing the nodes that define the arguments for base constructors.
 	/// These can either be inheritance specifiers or modifier invocations.
 	std::map<FunctionDefinition const*, ASTNode const*> baseConstructorArguments;
+
+	struct UsingForFunction
+	{
+		/// Type of the `using for` directive, nullptr for `using L for *`.
+		TypePointer type;
+		FunctionDefinition const* function;
+		/// Type of the function bound to its first parameter.
+		FunctionType const* boundType;
+	};
+	/// Library functions of the `using for` directives of @a linearizedBaseContracts in the order of lookup.
+	/// It's filled on the first lookup of bound functions and is shared by all types.
+	std::optional<std::vector<UsingForFunction>> usingForFunctions;
 };
 
 struct CallableDeclarationAnnotation: DeclarationAnnotation
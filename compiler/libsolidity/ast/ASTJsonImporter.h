@@ -39,8 +39,10 @@ namespace solidity::frontend
 class ASTJsonImporter
 {
 public:
-	ASTJsonImporter(langutil::EVMVersion _evmVersion)
-		:m_evmVersion(_evmVersion)
+	/// @a _sourceNames are the streams that the source locations of the nodes refer to,
+	/// one per source name. They are not owned and have to outlive the ASTs.
+	ASTJsonImporter(langutil::EVMVersion _evmVersion, std::map<std::string, langutil::CharStream const*> _sourceNames)
+		:m_evmVersion(_evmVersion), m_sourceNames(std::move(_sourceNames))
 	{}
 
 	/// Converts the AST from JSON-format to ASTPointer
@@ -157,6 +159,8 @@ private:
 	std::set<int64_t> m_usedIDs;
 	/// Configured EVM version
 	langutil::EVMVersion m_evmVersion;
+	/// Streams that name the sources in the source locations
+	std::map<std::string, langutil::CharStream const*> m_sourceNames;
 };
 
 }
@@ -35,7 +35,8 @@ namespace solidity::frontend
 class AsmJsonImporter
 {
 public:
-	explicit AsmJsonImporter(std::string _sourceName) : m_sourceName(_sourceName) {}
+	/// @a _source names the source in the source locations, it is not owned.
+	explicit AsmJsonImporter(langutil::CharStream const* _source) : m_source(_source) {}
 	yul::Block createBlock(Json::Value const& _node);
 
 private:
@@ -67,7 +68,7 @@ private:
 	yul::Break createBreak(Json::Value const& _node);
 	yul::Continue createContinue(Json::Value const& _node);
 
-	std::string m_sourceName;
+	langutil::CharStream const* m_source;
 
 };
 
@@ -187,6 +187,7 @@ inline void clearCaches(Container& container)
 
 void TypeProvider::reset()
 {
+	lock_guard<recursive_mutex> lock(mutex());
 	clearCache(m_boolean);
 	clearCache(m_inaccessibleDynamic);
 	clearCache(m_bytesStorage);
@@ -202,6 +203,21 @@ void TypeProvider::reset()
 	clearCaches(instance().m_magics);
 
 	instance().m_generalTypes.clear();
+	instance().m_tuples.clear();
+	instance().m_locationCopies.clear();
+	instance().m_arrays.clear();
+	instance().m_arraySlices.clear();
+	instance().m_contracts.clear();
+	instance().m_declaredTypes.clear();
+	instance().m_typeTypes.clear();
+	instance().m_metaTypes.clear();
+	instance().m_mappings.clear();
+	instance().m_optionals.clear();
+	instance().m_tvmVectors.clear();
+	instance().m_rationalNumbers.clear();
+	instance().m_functionsByTypeNames.clear();
+	instance().m_functions.clear();
+	instance().m_extraCurrencyCollection = nullptr;
 	instance().m_stringLiteralTypes.clear();
 	instance().m_ufixedMxN.clear();
 	instance().m_fixedMxN.clear();
@@ -210,10 +226,21 @@ void TypeProvider::reset()
 template <typename T, typename... Args>
 inline T const* TypeProvider::createAndGet(Args&& ... _args)
 {
+	lock_guard<recursive_mutex> lock(mutex());
 	instance().m_generalTypes.emplace_back(make_unique<T>(std::forward<Args>(_args)...));
 	return static_cast<T const*>(instance().m_generalTypes.back().get());
 }
 
+template <typename T, typename Key, typename... Args>
+inline T const* TypeProvider::createAndGetUnique(map<Key, Type const*>& _cache, Key _key, Args&& ... _args)
+{
+	lock_guard<recursive_mutex> lock(mutex());
+	auto it = _cache.find(_key);
+	if (it == _cache.end())
+		it = _cache.emplace(move(_key), createAndGet<T>(std::forward<Args>(_args)...)).first;
+	return static_cast<T const*>(it->second);
+}
+
 Type const* TypeProvider::fromElementaryTypeName(ElementaryTypeNameToken const& _type)
 {
 	solAssert(
@@ -305,6 +332,7 @@ TypePointer TypeProvider::fromElementaryTypeName(string const& _name)
 
 ArrayType const* TypeProvider::bytesStorage()
 {
+	lock_guard<recursive_mutex> lock(mutex());
 	if (!m_bytesStorage)
 		m_bytesStorage = make_unique<ArrayType>(false);
 	return m_bytesStorage.get();
@@ -312,6 +340,7 @@ ArrayType const* TypeProvider::bytesStorage()
 
 ArrayType const* TypeProvider::bytesMemory()
 {
+	lock_guard<recursive_mutex> lock(mutex());
 	if (!m_bytesMemory)
 		m_bytesMemory = make_unique<ArrayType>(false);
 	return m_bytesMemory.get();
@@ -319,6 +348,7 @@ ArrayType const* TypeProvider::bytesMemory()
 
 ArrayType const* TypeProvider::bytesCalldata()
 {
+	lock_guard<recursive_mutex> lock(mutex());
 	if (!m_bytesCalldata)
 		m_bytesCalldata = make_unique<ArrayType>(false);
 	return m_bytesCalldata.get();
@@ -326,6 +356,7 @@ ArrayType const* TypeProvider::bytesCalldata()
 
 ArrayType const* TypeProvider::stringStorage()
 {
+	lock_guard<recursive_mutex> lock(mutex());
 	if (!m_stringStorage)
 		m_stringStorage = make_unique<ArrayType>(true);
 	return m_stringStorage.get();
@@ -333,6 +364,7 @@ ArrayType const* TypeProvider::stringStorage()
 
 ArrayType const* TypeProvider::stringMemory()
 {
+	lock_guard<recursive_mutex> lock(mutex());
 	if (!m_stringMemory)
 		m_stringMemory = make_unique<ArrayType>(true);
 	return m_stringMemory.get();
@@ -378,6 +410,7 @@ RationalNumberType const* TypeProvider::rationalNumber(Literal const& _literal)
 
 StringLiteralType const* TypeProvider::stringLiteral(string const& literal)
 {
+	lock_guard<recursive_mutex> lock(mutex());
 	auto i = instance().m_stringLiteralTypes.find(literal);
 	if (i != instance().m_stringLiteralTypes.end())
 		return i->second.get();
@@ -387,6 +420,7 @@ StringLiteralType const* TypeProvider::stringLiteral(string const& literal)
 
 FixedPointType const* TypeProvider::fixedPoint(unsigned m, unsigned n, FixedPointType::Modifier _modifier)
 {
+	lock_guard<recursive_mutex> lock(mutex());
 	auto& map = _modifier == FixedPointType::Modifier::Unsigned ? instance().m_ufixedMxN : instance().m_fixedMxN;
 
 	auto i = map.find(make_pair(m, n));
@@ -404,7 +438,8 @@ TupleType const* TypeProvider::tuple(vector<Type const*> members)
 	if (members.empty())
 		return &m_emptyTuple;
 
-	return createAndGet<TupleType>(move(members));
+	vector<Type const*> key = members;
+	return createAndGetUnique<TupleType>(instance().m_tuples, move(key), move(members));
 }
 
 ReferenceType const* TypeProvider::withLocation(ReferenceType const* _type, bool _isPointer)
@@ -412,8 +447,15 @@ ReferenceType const* TypeProvider::withLocation(ReferenceType const* _type, bool
 	if (_type->isPointer() == _isPointer)
 		return _type;
 
-	instance().m_generalTypes.emplace_back(_type->copyForLocation(_isPointer));
-	return static_cast<ReferenceType const*>(instance().m_generalTypes.back().get());
+	lock_guard<recursive_mutex> lock(mutex());
+	auto& cache = instance().m_locationCopies;
+	auto it = cache.find({_type, _isPointer});
+	if (it == cache.end())
+	{
+		instance().m_generalTypes.emplace_back(_type->copyForLocation(_isPointer));
+		it = cache.emplace(make_pair(_type, _isPointer), instance().m_generalTypes.back().get()).first;
+	}
+	return static_cast<ReferenceType const*>(it->second);
 }
 
 FunctionType const* TypeProvider::function(FunctionDefinition const& _function, FunctionType::Kind _kind)
@@ -444,7 +486,9 @@ FunctionType const* TypeProvider::function(
 	StateMutability _stateMutability
 )
 {
-	return createAndGet<FunctionType>(
+	return createAndGetUnique<FunctionType>(
+		instance().m_functionsByTypeNames,
+		make_tuple(_parameterTypes, _returnParameterTypes, _kind, _arbitraryParameters, _stateMutability),
 		_parameterTypes, _returnParameterTypes,
 		_kind, _arbitraryParameters, _stateMutability
 	);
@@ -462,7 +506,12 @@ FunctionType const* TypeProvider::function(
 	bool _bound
 )
 {
-	return createAndGet<FunctionType>(
+	return createAndGetUnique<FunctionType>(
+		instance().m_functions,
+		make_tuple(
+			_parameterTypes, _returnParameterTypes, _parameterNames, _returnParameterNames,
+			_kind, _arbitraryParameters, _stateMutability, _declaration, _bound
+		),
 		_parameterTypes,
 		_returnParameterTypes,
 		_parameterNames,
@@ -477,7 +526,10 @@ FunctionType const* TypeProvider::function(
 
 RationalNumberType const* TypeProvider::rationalNumber(rational const& _value, Type const* _compatibleBytesType)
 {
-	return createAndGet<RationalNumberType>(_value, _compatibleBytesType);
+	return createAndGetUnique<RationalNumberType>(
+		instance().m_rationalNumbers, make_pair(_value, _compatibleBytesType),
+		_value, _compatibleBytesType
+	);
 }
 
 ArrayType const* TypeProvider::array(bool _isString)
@@ -487,42 +539,42 @@ ArrayType const* TypeProvider::array(bool _isString)
 
 ArrayType const* TypeProvider::array(Type const* _baseType)
 {
-	return createAndGet<ArrayType>(_baseType);
+	return createAndGetUnique<ArrayType>(instance().m_arrays, make_tuple(_baseType, true, u256(0)), _baseType);
 }
 
 ArrayType const* TypeProvider::array(Type const* _baseType, u256 const& _length)
 {
-	return createAndGet<ArrayType>(_baseType, _length);
+	return createAndGetUnique<ArrayType>(instance().m_arrays, make_tuple(_baseType, false, _length), _baseType, _length);
 }
 
 ArraySliceType const* TypeProvider::arraySlice(ArrayType const& _arrayType)
 {
-	return createAndGet<ArraySliceType>(_arrayType);
+	return createAndGetUnique<ArraySliceType>(instance().m_arraySlices, static_cast<Type const*>(&_arrayType), _arrayType);
 }
 
 ContractType const* TypeProvider::contract(ContractDefinition const& _contractDef, bool _isSuper)
 {
-	return createAndGet<ContractType>(_contractDef, _isSuper);
+	return createAndGetUnique<ContractType>(instance().m_contracts, make_pair(&_contractDef, _isSuper), _contractDef, _isSuper);
 }
 
 EnumType const* TypeProvider::enumType(EnumDefinition const& _enumDef)
 {
-	return createAndGet<EnumType>(_enumDef);
+	return createAndGetUnique<EnumType>(instance().m_declaredTypes, static_cast<ASTNode const*>(&_enumDef), _enumDef);
 }
 
 ModuleType const* TypeProvider::module(SourceUnit const& _source)
 {
-	return createAndGet<ModuleType>(_source);
+	return createAndGetUnique<ModuleType>(instance().m_declaredTypes, static_cast<ASTNode const*>(&_source), _source);
 }
 
 TypeType const* TypeProvider::typeType(Type const* _actualType)
 {
-	return createAndGet<TypeType>(_actualType);
+	return createAndGetUnique<TypeType>(instance().m_typeTypes, _actualType, _actualType);
 }
 
 StructType const* TypeProvider::structType(StructDefinition const& _struct)
 {
-	return createAndGet<StructType>(_struct);
+	return createAndGetUnique<StructType>(instance().m_declaredTypes, static_cast<ASTNode const*>(&_struct), _struct);
 }
 
 ModifierType const* TypeProvider::modifier(ModifierDefinition const& _def)
@@ -539,25 +591,28 @@ MagicType const* TypeProvider::magic(MagicType::Kind _kind)
 MagicType const* TypeProvider::meta(Type const* _type)
 {
 	solAssert(_type && _type->category() == Type::Category::Contract, "Only contracts supported for now.");
-	return createAndGet<MagicType>(_type);
+	return createAndGetUnique<MagicType>(instance().m_metaTypes, _type, _type);
 }
 
 MappingType const* TypeProvider::mapping(Type const* _keyType, Type const* _valueType)
 {
-	return createAndGet<MappingType>(_keyType, _valueType);
+	return createAndGetUnique<MappingType>(instance().m_mappings, make_pair(_keyType, _valueType), _keyType, _valueType);
 }
 
 ExtraCurrencyCollectionType const *TypeProvider::extraCurrencyCollection()
 {
-	return createAndGet<ExtraCurrencyCollectionType>();
+	lock_guard<recursive_mutex> lock(mutex());
+	if (!instance().m_extraCurrencyCollection)
+		instance().m_extraCurrencyCollection = createAndGet<ExtraCurrencyCollectionType>();
+	return static_cast<ExtraCurrencyCollectionType const*>(instance().m_extraCurrencyCollection);
 }
 
 OptionalType const* TypeProvider::optional(Type const* _type)
 {
-	return createAndGet<OptionalType>(_type);
+	return createAndGetUnique<OptionalType>(instance().m_optionals, _type, _type);
 }
 
 TvmVectorType const* TypeProvider::tvmtuple(Type const* _type)
 {
-	return createAndGet<TvmVectorType>(_type);
+	return createAndGetUnique<TvmVectorType>(instance().m_tvmVectors, _type, _type);
 }
@@ -22,7 +22,9 @@
 #include <array>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <optional>
+#include <tuple>
 #include <utility>
 
 namespace solidity::frontend
@@ -51,6 +53,15 @@ public:
 	/// This invalidates all dangling pointers to types provided by this TypeProvider.
 	static void reset();
 
+	/// Guards the creation of types and the parts of types and AST nodes that are computed
+	/// on first use (member lists, interface function lists), so that analysis can run
+	/// on several threads. Recursive, because creating a type may create other types.
+	static std::recursive_mutex& mutex()
+	{
+		static std::recursive_mutex s_mutex;
+		return s_mutex;
+	}
+
 	/// @name Factory functions
 	/// Factory functions that convert an AST @ref TypeName to a Type.
 	static Type const* fromElementaryTypeName(ElementaryTypeNameToken const& _type);
@@ -211,6 +222,11 @@ private:
 	template <typename T, typename... Args>
 	static inline T const* createAndGet(Args&& ... _args);
 
+	/// @returns the type stored in @a _cache for @a _key or creates it from @a _args.
+	/// The types that are created from equal arguments are equal, so they are shared.
+	template <typename T, typename Key, typename... Args>
+	static inline T const* createAndGetUnique(std::map<Key, Type const*>& _cache, Key _key, Args&& ... _args);
+
 	static BoolType const m_boolean;
 	static NullType const m_nullType;
 	static TvmCellType const m_tvmcell;
@@ -241,6 +257,29 @@ private:
 	std::map<std::pair<unsigned, unsigned>, std::unique_ptr<FixedPointType>> m_fixedMxN{};
 	std::map<std::string, std::unique_ptr<StringLiteralType>> m_stringLiteralTypes{};
 	std::vector<std::unique_ptr<Type>> m_generalTypes{};
+
+	/// Caches of m_generalTypes by the arguments they are created from
+	std::map<std::vector<Type const*>, Type const*> m_tuples{};
+	std::map<std::pair<Type const*, bool>, Type const*> m_locationCopies{};
+	std::map<std::tuple<Type const*, bool, u256>, Type const*> m_arrays{};
+	std::map<Type const*, Type const*> m_arraySlices{};
+	std::map<std::pair<ContractDefinition const*, bool>, Type const*> m_contracts{};
+	std::map<ASTNode const*, Type const*> m_declaredTypes{}; ///< enums, structs and modules
+	std::map<Type const*, Type const*> m_typeTypes{};
+	std::map<Type const*, Type const*> m_metaTypes{};
+	std::map<std::pair<Type const*, Type const*>, Type const*> m_mappings{};
+	std::map<Type const*, Type const*> m_optionals{};
+	std::map<Type const*, Type const*> m_tvmVectors{};
+	std::map<std::pair<rational, Type const*>, Type const*> m_rationalNumbers{};
+	std::map<
+		std::tuple<strings, strings, FunctionType::Kind, bool, StateMutability>,
+		Type const*
+	> m_functionsByTypeNames{};
+	std::map<
+		std::tuple<TypePointers, TypePointers, strings, strings, FunctionType::Kind, bool, StateMutability, Declaration const*, bool>,
+		Type const*
+	> m_functions{};
+	Type const* m_extraCurrencyCollection{};
 };
 
 }
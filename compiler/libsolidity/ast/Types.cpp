@@ -214,6 +214,7 @@ void MemberList::combine(MemberList const & _other)
 
 pair<u256, unsigned> const* MemberList::memberStorageOffset(string const& _name) const
 {
+	lock_guard<recursive_mutex> lock(TypeProvider::mutex());
 	if (!m_storageOffsets)
 	{
 		TypePointers memberTypes;
@@ -317,6 +318,7 @@ TypePointer Type::commonType(Type const* _a, Type const* _b)
 
 MemberList const& Type::members(ContractDefinition const* _currentScope) const
 {
+	lock_guard<recursive_mutex> lock(TypeProvider::mutex());
 	if (!m_members[_currentScope])
 	{
 		MemberList::MemberMap members = nativeMembers(_currentScope);
@@ -346,34 +348,55 @@ TypePointer Type::fullEncodingType(bool _inLibraryCall, bool _encoderV2, bool) c
 	return encodingType;
 }
 
+namespace
+{
+
+vector<ContractDefinitionAnnotation::UsingForFunction> const& usingForFunctions(ContractDefinition const& _scope)
+{
+	lock_guard<recursive_mutex> lock(TypeProvider::mutex());
+	auto& functions = _scope.annotation().usingForFunctions;
+	if (!functions)
+	{
+		functions.emplace();
+		for (ContractDefinition const* contract: _scope.annotation().linearizedBaseContracts)
+			for (UsingForDirective const* ufd: contract->usingForDirectives())
+			{
+				// Normalise data location of type.
+				TypePointer type = ufd->typeName() ?
+					TypeProvider::withLocationIfReference(ufd->typeName()->annotation().type) :
+					nullptr;
+				auto const& library = dynamic_cast<ContractDefinition const&>(
+					*ufd->libraryName().annotation().referencedDeclaration
+				);
+				for (FunctionDefinition const* function: library.definedFunctions())
+				{
+					if (!function->isVisibleAsLibraryMember() || function->parameters().empty())
+						continue;
+					FunctionTypePointer fun = FunctionType(*function, FunctionType::Kind::External).asCallableFunction(true, true);
+					functions->push_back({type, function, fun});
+				}
+			}
+	}
+	return *functions;
+}
+
+}
+
 MemberList::MemberMap Type::boundFunctions(Type const& _type, ContractDefinition const& _scope)
 {
 	// Normalise data location of type.
 	TypePointer type = TypeProvider::withLocationIfReference(&_type);
 	set<Declaration const*> seenFunctions;
 	MemberList::MemberMap members;
-	for (ContractDefinition const* contract: _scope.annotation().linearizedBaseContracts)
-		for (UsingForDirective const* ufd: contract->usingForDirectives())
-		{
-			if (ufd->typeName() && *type != *TypeProvider::withLocationIfReference(
-				ufd->typeName()->annotation().type
-			))
-				continue;
-			auto const& library = dynamic_cast<ContractDefinition const&>(
-				*ufd->libraryName().annotation().referencedDeclaration
-			);
-			for (FunctionDefinition const* function: library.definedFunctions())
-			{
-				if (!function->isVisibleAsLibraryMember() || seenFunctions.count(function))
-					continue;
-				seenFunctions.insert(function);
-				if (function->parameters().empty())
-					continue;
-				FunctionTypePointer fun = FunctionType(*function, FunctionType::Kind::External).asCallableFunction(true, true);
-				if (_type.isImplicitlyConvertibleTo(*fun->selfType()))
-					members.emplace_back(function->name(), fun, function);
-			}
-		}
+	for (ContractDefinitionAnnotation::UsingForFunction const& bound: usingForFunctions(_scope))
+	{
+		if (bound.type && *type != *bound.type)
+			continue;
+		if (!seenFunctions.insert(bound.function).second)
+			continue;
+		if (_type.isImplicitlyConvertibleTo(*bound.boundType->selfType()))
+			members.emplace_back(bound.function->name(), bound.boundType, bound.function);
+	}
 	return members;
 }
 
@@ -1653,6 +1676,8 @@ string ArrayType::richIdentifier() const
 
 bool ArrayType::operator==(Type const& _other) const
 {
+	if (this == &_other)
+		return true;
 	if (_other.category() != category())
 		return false;
 	ArrayType const& other = dynamic_cast<ArrayType const&>(_other);
@@ -2136,6 +2161,7 @@ MemberList::MemberMap ContractType::nativeMembers(ContractDefinition const* _con
 
 FunctionType const* ContractType::newExpressionType() const
 {
+	lock_guard<recursive_mutex> lock(TypeProvider::mutex());
 	if (!m_constructorType)
 		m_constructorType = FunctionType::newExpressionType(m_contract);
 	return m_constructorType;
@@ -2485,6 +2511,8 @@ string TupleType::richIdentifier() const
 
 bool TupleType::operator==(Type const& _other) const
 {
+	if (this == &_other)
+		return true;
 	if (auto tupleOther = dynamic_cast<TupleType const*>(&_other)) {
 		if (components().size() == tupleOther->components().size()) {
 			bool ok = true;
@@ -2947,6 +2975,8 @@ string FunctionType::richIdentifier() const
 
 bool FunctionType::operator==(Type const& _other) const
 {
+	if (this == &_other)
+		return true;
 	if (_other.category() != category())
 		return false;
 	FunctionType const& other = dynamic_cast<FunctionType const&>(_other);
@@ -3514,6 +3544,8 @@ string OptionalType::richIdentifier() const
 
 bool MappingType::operator==(Type const& _other) const
 {
+	if (this == &_other)
+		return true;
 	if (_other.category() != category())
 		return false;
 	MappingType const& other = dynamic_cast<MappingType const&>(_other);
@@ -3522,6 +3554,8 @@ bool MappingType::operator==(Type const& _other) const
 
 bool OptionalType::operator==(Type const& _other) const
 {
+	if (this == &_other)
+		return true;
 	if (_other.category() != category())
 		return false;
 	OptionalType const& other = dynamic_cast<OptionalType const&>(_other);
@@ -29,7 +29,7 @@ DictOperation::DictOperation(StackPusher& pusher, Type const& keyType, Type cons
 		valueCategory{valueType.category()} {
 }
 
-void DictMinMax::minOrMax(bool saveOrigKeyAndNoTuple) {
+void DictMinMax::minOrMax() {
 	// stack: dict
 	pusher.pushInt(lengthOfDictKey(&keyType)); // dict nbits
 
@@ -44,16 +44,12 @@ void DictMinMax::minOrMax(bool saveOrigKeyAndNoTuple) {
 			&valueType,
 			haveKey,
 			isInRef,
-			StackPusher::DecodeType::DecodeValueOrPushNull,
-			saveOrigKeyAndNoTuple
+			StackPusher::DecodeType::DecodeValueOrPushNull
 	);
-	if (saveOrigKeyAndNoTuple)
-		pusher.endOpaque(2, 3);
-	else
-		pusher.endOpaque(2, 1);
+	pusher.endOpaque(2, 1);
 }
 
-void DictPrevNext::prevNext(bool saveOrigKeyAndNoTuple) {
+void DictPrevNext::prevNext() {
 	// stack: index dict nbits
 	std::string dictOpcode = std::string{"DICT"} + typeToDictChar(&keyType) + "GET";
 	if (oper == "next"){
@@ -77,16 +73,11 @@ void DictPrevNext::prevNext(bool saveOrigKeyAndNoTuple) {
 			&valueType,
 			true,
 			false,
-			StackPusher::DecodeType::DecodeValueOrPushNull,
-			saveOrigKeyAndNoTuple
+			StackPusher::DecodeType::DecodeValueOrPushNull
 	);
-	pusher.endOpaque(3, saveOrigKeyAndNoTuple ? 3 : 1);
+	pusher.endOpaque(3, 1);
 
-	if (saveOrigKeyAndNoTuple) {
-		pusher.ensureSize(ss - 3 + 3);
-	} else {
-		pusher.ensureSize(ss - 3 + 1);
-	}
+	pusher.ensureSize(ss - 3 + 1);
 }
 
 GetFromDict::GetFromDict(StackPusher &pusher, const Type &keyType, const Type &valueType,
@@ -103,6 +94,7 @@ void GetFromDict::getDict() {
 	pusher.pushInt(keyLength); // push keyLength on stack
 	// if op == GetSetFromMapping than stack: value key dict keyLength
 	// else                            stack: key dict keyLength
+	// GetSet*/GetAnd* ops return: dict value
 
 	const int saveStake = pusher.stackSize();
 	std::string opcode = "DICT" + typeToDictChar(&keyType);
@@ -154,6 +146,34 @@ void GetFromDict::getDict() {
 			break;
 		}
 
+		case GetDictOperation::GetAndSetFromMapping:
+		case GetDictOperation::GetAndDeleteFromMapping: {
+			bool isInRef{};
+			if (op == GetDictOperation::GetAndSetFromMapping) {
+				take = 4;
+				opcode += "SETGET";
+				if (dataType == DataType::Builder) {
+					opcode += "B";
+				} else if (dataType == DataType::Cell) {
+					opcode += "REF";
+					isInRef = true;
+				}
+			} else {
+				take = 3;
+				opcode += "DELGET";
+				isInRef = pusher.doesDictStoreValueInRef(&keyType, &valueType);
+				if (isInRef) {
+					opcode += "REF";
+				}
+			}
+			ret = 2;
+			pusher.pushAsym(opcode);
+			int ss = pusher.stackSize();
+			pusher.recoverKeyAndValueAfterDictOperation(&keyType, &valueType, false, isInRef, StackPusher::DecodeType::DecodeValueOrPushDefault);
+			solAssert(ss == pusher.stackSize(), "");
+			break;
+		}
+
 		case GetDictOperation::Exist: {
 			take = 3;
 			ret = 1;
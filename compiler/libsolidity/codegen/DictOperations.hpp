@@ -56,7 +56,7 @@ public:
 
 	}
 
-	void minOrMax(bool saveOrigKeyAndNoTuple = false);
+	void minOrMax();
 
 private:
 	const bool isMin{};
@@ -71,7 +71,7 @@ public:
 	{
 	}
 
-	void prevNext(bool saveOrigKeyAndNoTuple = false);
+	void prevNext();
 
 private:
 	const std::string oper;
@@ -734,7 +734,10 @@ Result PrivatePeepholeOptimizer::optimizeAt2(Pointer<TvmAstNode> cmd1, Pointer<T
 				std::vector<Pointer<TvmAstNode>> const& cmds = ifRef->trueBody()->instructions();
 				if (cmds.size() == 1) {
 					if (auto gen = to<GenOpcode>(cmds.at(0).get())) {
-						if (gen->fullOpcode() == "CALL $c7_to_c4$") {
+						if (gen->fullOpcode() == "CALL $c7_to_c4$" ||
+							(boost::starts_with(gen->fullOpcode(), "CALL $c7_to_c4_for_") &&
+							 boost::ends_with(gen->fullOpcode(), "_cells$"))
+						) {
 							return Result{2, cmd2};
 						}
 					}
@@ -30,6 +30,9 @@ void TVMCompilerProceedContract(
 	std::vector<PragmaDirective const *> const* pragmaDirectives,
 	bool generateAbi,
 	bool generateCode,
+	bool generateBoc,
+	bool generateSourceMap,
+	const std::string& tvmLibraryPath,
 	const std::string& solFileName,
 	const std::string& outputFolder,
 	const std::string& filePrefix,
@@ -65,8 +68,15 @@ void TVMCompilerProceedContract(
 	if (doPrintFunctionIds) {
 		TVMContractCompiler::printFunctionIds(_contract, pragmaHelper);
 	} else {
-		if (generateCode) {
-			TVMContractCompiler::generateCode(pathToFiles + ".code", _contract, pragmaHelper);
+		if (generateCode || generateBoc || generateSourceMap) {
+			TVMContractCompiler::generateCode(
+				generateCode ? pathToFiles + ".code" : "",
+				generateBoc ? pathToFiles + ".code.boc" : "",
+				generateSourceMap ? pathToFiles + ".map.json" : "",
+				tvmLibraryPath,
+				_contract,
+				pragmaHelper
+			);
 		}
 		if (generateAbi) {
 			TVMContractCompiler::generateABI(pathToFiles + ".abi.json", &_contract, *pragmaDirectives);
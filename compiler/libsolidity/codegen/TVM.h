@@ -33,6 +33,9 @@ void TVMCompilerProceedContract(
 	std::vector<solidity::frontend::PragmaDirective const *> const* pragmaDirectives,
 	bool generateAbi,
 	bool generateCode,
+	bool generateBoc,
+	bool generateSourceMap,
+	const std::string& tvmLibraryPath,
 	const std::string& solFileName,
 	const std::string& outputFolder,
 	const std::string& filePrefix,
@@ -196,7 +196,7 @@ void TVMABI::generateABI(
 				fields.append(field);
 			}
 
-			for (VariableDeclaration const* stateVar : ctx.notConstantStateVariables()) {
+			for (VariableDeclaration const* stateVar : ctx.storageLayout()) {
 				Json::Value cur = setupNameTypeComponents(stateVar->name(), stateVar->type());
 				fields.append(cur);
 			}
@@ -18,7 +18,9 @@
 
 #include "TVMAnalyzer.hpp"
 #include <liblangutil/ErrorReporter.h>
+#include <libsolidity/codegen/TVMABI.hpp>
 #include <libsolidity/codegen/TVMConstants.hpp>
+#include <libsolidity/codegen/TVMExpressionCompiler.hpp>
 
 using namespace solidity::frontend;
 using namespace solidity::langutil;
@@ -244,6 +246,9 @@ bool ContactsUsageScanner::visit(FunctionCall const& _functionCall) {
 }
 
 bool ContactsUsageScanner::visit(const MemberAccess &_node) {
+	if (auto fd = to<FunctionDefinition>(_node.annotation().referencedDeclaration)) {
+		m_usedFunctionNames.insert(fd->name());
+	}
 	if (getType(&_node.expression())->category() == Type::Category::Magic) {
 		auto identifier = to<Identifier>(&_node.expression());
 		if (identifier) {
@@ -255,12 +260,457 @@ bool ContactsUsageScanner::visit(const MemberAccess &_node) {
 	return true;
 }
 
+bool ContactsUsageScanner::visit(Identifier const& _identifier) {
+	// calls of virtual functions are resolved by name, that's why we store names
+	if (auto fd = to<FunctionDefinition>(_identifier.annotation().referencedDeclaration)) {
+		m_usedFunctionNames.insert(fd->name());
+	}
+	return true;
+}
+
 bool ContactsUsageScanner::visit(const FunctionDefinition &fd) {
 	if (fd.isResponsible())
 		m_hasResponsibleFunction = true;
 	return true;
 }
 
+StateVariableCacheScanner::StateVariableCacheScanner(FunctionDefinition const& f) {
+	f.body().accept(*this);
+	solAssert(m_loopDepth == 0, "");
+}
+
+std::vector<VariableDeclaration const*> StateVariableCacheScanner::cachedVariables() const {
+	std::vector<VariableDeclaration const*> res;
+	if (m_mayWriteState) {
+		return res;
+	}
+	for (VariableDeclaration const* vd : m_variables) {
+		if (isWritten(vd) && m_mayReadState) {
+			continue;
+		}
+		if (m_accessQty.at(vd) >= TvmConst::StateVarCache::MinAccessQty || m_accessedInLoop.count(vd)) {
+			res.push_back(vd);
+			if (static_cast<int>(res.size()) == TvmConst::StateVarCache::MaxVariableQty) {
+				break;
+			}
+		}
+	}
+	return res;
+}
+
+bool StateVariableCacheScanner::visit(ForEachStatement const&) {
+	++m_loopDepth;
+	return true;
+}
+
+bool StateVariableCacheScanner::visit(WhileStatement const&) {
+	++m_loopDepth;
+	return true;
+}
+
+bool StateVariableCacheScanner::visit(ForStatement const&) {
+	++m_loopDepth;
+	return true;
+}
+
+void StateVariableCacheScanner::endVisit(ForEachStatement const&) {
+	--m_loopDepth;
+}
+
+void StateVariableCacheScanner::endVisit(WhileStatement const&) {
+	--m_loopDepth;
+}
+
+void StateVariableCacheScanner::endVisit(ForStatement const&) {
+	--m_loopDepth;
+}
+
+bool StateVariableCacheScanner::visit(Identifier const& _identifier) {
+	auto vd = to<VariableDeclaration>(_identifier.annotation().referencedDeclaration);
+	if (vd && vd->isStateVariable() && !vd->isConstant()) {
+		if (!m_accessQty.count(vd)) {
+			m_variables.push_back(vd);
+		}
+		++m_accessQty[vd];
+		if (m_loopDepth > 0) {
+			m_accessedInLoop.insert(vd);
+		}
+	}
+	return true;
+}
+
+bool StateVariableCacheScanner::visit(Assignment const& _assignment) {
+	markWritten(_assignment.leftHandSide());
+	return true;
+}
+
+bool StateVariableCacheScanner::visit(UnaryOperation const& _node) {
+	if (isIn(_node.getOperator(), Token::Inc, Token::Dec, Token::Delete)) {
+		markWritten(_node.subExpression());
+	}
+	return true;
+}
+
+bool StateVariableCacheScanner::visit(FunctionCall const& _functionCall) {
+	if (_functionCall.isAwait()) {
+		m_mayWriteState = true;
+	}
+	auto funType = to<FunctionType>(getType(&_functionCall.expression()));
+	if (funType == nullptr) {
+		return true;
+	}
+	switch (funType->kind()) {
+		case FunctionType::Kind::Internal:
+		case FunctionType::Kind::DelegateCall:
+			// the callee works with globals directly
+			if (funType->stateMutability() >= StateMutability::NonPayable) {
+				m_mayWriteState = true;
+			} else if (funType->stateMutability() == StateMutability::View) {
+				m_mayReadState = true;
+			}
+			break;
+		case FunctionType::Kind::TVMCommit:
+		case FunctionType::Kind::TVMExit:
+		case FunctionType::Kind::TVMExit1:
+		case FunctionType::Kind::TVMResetStorage:
+			m_mayWriteState = true;
+			break;
+		default:
+			break;
+	}
+	// methods (e.g. array.push(), mapping.delMin(), slice.decode()) may change the object they are called on,
+	// except the ones that only read it. optional.get() is not one of them, it can be an lvalue.
+	auto memberAccess = to<MemberAccess>(&_functionCall.expression());
+	if (memberAccess &&
+		(funType->bound() || !isIn(funType->kind(), FunctionType::Kind::Internal, FunctionType::Kind::DelegateCall, FunctionType::Kind::External)) &&
+		!isIn(funType->kind(),
+			FunctionType::Kind::ArrayEmpty,
+			FunctionType::Kind::MappingAt,
+			FunctionType::Kind::MappingGetNextKey,
+			FunctionType::Kind::MappingGetPrevKey,
+			FunctionType::Kind::MappingGetMinMax,
+			FunctionType::Kind::MappingFetch,
+			FunctionType::Kind::MappingExists,
+			FunctionType::Kind::MappingEmpty,
+			FunctionType::Kind::OptionalHasValue)
+	) {
+		markWritten(memberAccess->expression());
+	}
+	return true;
+}
+
+void StateVariableCacheScanner::markWritten(Expression const& _expression) {
+	if (auto identifier = to<Identifier>(&_expression)) {
+		auto vd = to<VariableDeclaration>(identifier->annotation().referencedDeclaration);
+		if (vd && vd->isStateVariable() && !vd->isConstant()) {
+			m_written.insert(vd);
+		}
+	} else if (auto indexAccess = to<IndexAccess>(&_expression)) {
+		markWritten(indexAccess->baseExpression());
+	} else if (auto indexRangeAccess = to<IndexRangeAccess>(&_expression)) {
+		markWritten(indexRangeAccess->baseExpression());
+	} else if (auto memberAccess = to<MemberAccess>(&_expression)) {
+		markWritten(memberAccess->expression());
+	} else if (auto tuple = to<TupleExpression>(&_expression)) {
+		for (const ASTPointer<Expression>& component : tuple->components()) {
+			if (component) {
+				markWritten(*component);
+			}
+		}
+	} else if (auto conditional = to<Conditional>(&_expression)) {
+		markWritten(conditional->trueExpression());
+		markWritten(conditional->falseExpression());
+	}
+}
+
+LoopInvariantConstantScanner::LoopInvariantConstantScanner(std::vector<ASTNode const*> const& loopParts) {
+	for (ASTNode const* node : loopParts) {
+		if (node) {
+			node->accept(*this);
+		}
+	}
+	for (auto const& [value, useQty] : m_uses) {
+		if (useQty >= TvmConst::LoopInvariant::MinUseQty &&
+			static_cast<int>(m_constants.size()) < TvmConst::LoopInvariant::MaxConstantQty
+		) {
+			m_constants.push_back(value);
+		}
+	}
+}
+
+bool LoopInvariantConstantScanner::visit(IfStatement const& _node) {
+	_node.condition().accept(*this);
+	acceptInBranch(&_node.trueStatement());
+	acceptInBranch(_node.falseStatement());
+	return false;
+}
+
+bool LoopInvariantConstantScanner::visit(Conditional const& _node) {
+	if (addUse(_node)) {
+		_node.condition().accept(*this);
+		acceptInBranch(&_node.trueExpression());
+		acceptInBranch(&_node.falseExpression());
+	}
+	return false;
+}
+
+bool LoopInvariantConstantScanner::visit(BinaryOperation const& _node) {
+	if (!addUse(_node)) {
+		return false;
+	}
+	if (!isIn(_node.getOperator(), Token::And, Token::Or)) {
+		return true;
+	}
+	_node.leftExpression().accept(*this);
+	acceptInBranch(&_node.rightExpression());
+	return false;
+}
+
+bool LoopInvariantConstantScanner::visit(WhileStatement const& _node) {
+	++m_loopDepth;
+	_node.condition().accept(*this);
+	_node.body().accept(*this);
+	--m_loopDepth;
+	return false;
+}
+
+bool LoopInvariantConstantScanner::visit(ForStatement const& _node) {
+	if (_node.initializationExpression()) {
+		_node.initializationExpression()->accept(*this);
+	}
+	++m_loopDepth;
+	if (_node.condition()) {
+		_node.condition()->accept(*this);
+	}
+	_node.body().accept(*this);
+	if (_node.loopExpression()) {
+		_node.loopExpression()->accept(*this);
+	}
+	--m_loopDepth;
+	return false;
+}
+
+bool LoopInvariantConstantScanner::visit(ForEachStatement const& _node) {
+	_node.rangeExpression()->accept(*this);
+	++m_loopDepth;
+	_node.body().accept(*this);
+	--m_loopDepth;
+	return false;
+}
+
+bool LoopInvariantConstantScanner::visitNode(ASTNode const& _node) {
+	auto expr = dynamic_cast<Expression const*>(&_node);
+	return expr == nullptr || addUse(*expr);
+}
+
+bool LoopInvariantConstantScanner::addUse(Expression const& _expr) {
+	std::optional<bigint> val = TVMExpressionCompiler::constValue(_expr);
+	if (!val.has_value()) {
+		return true;
+	}
+	// PUSHINT of a value from this range is not more expensive than PUSH s(i)
+	bool isCheap = -TvmConst::LoopInvariant::MaxCheapConstant <= *val && *val <= TvmConst::LoopInvariant::MaxCheapConstant;
+	if (!isCheap && m_branchDepth == 0) {
+		auto it = std::find_if(m_uses.begin(), m_uses.end(), [&](auto const& use) { return use.first == *val; });
+		if (it == m_uses.end()) {
+			it = m_uses.insert(m_uses.end(), {*val, 0});
+		}
+		// A nested loop can push the constant many times per iteration
+		it->second += m_loopDepth > 0 ? TvmConst::LoopInvariant::MinUseQty : 1;
+	}
+	return false;
+}
+
+void LoopInvariantConstantScanner::acceptInBranch(ASTNode const* _node) {
+	if (_node) {
+		++m_branchDepth;
+		_node->accept(*this);
+		--m_branchDepth;
+	}
+}
+
+StringAppendScanner::StringAppendScanner(std::vector<ASTNode const*> const& loopParts) {
+	for (ASTNode const* node : loopParts) {
+		if (node) {
+			node->accept(*this);
+		}
+	}
+}
+
+std::vector<VariableDeclaration const*> StringAppendScanner::variables() const {
+	std::vector<VariableDeclaration const*> res;
+	if (m_hasReturn) {
+		return res;
+	}
+	for (VariableDeclaration const* vd : m_appended) {
+		if (!m_used.count(vd)) {
+			res.push_back(vd);
+		}
+	}
+	return res;
+}
+
+std::optional<std::pair<VariableDeclaration const*, Expression const*>>
+StringAppendScanner::stringAppend(ExpressionStatement const& _statement) {
+	Expression const* str{};
+	Expression const* tail{};
+	if (auto assignment = to<Assignment>(&_statement.expression())) {
+		if (assignment->assignmentOperator() == Token::AssignAdd &&
+			isString(assignment->leftHandSide().annotation().type) &&
+			isString(assignment->rightHandSide().annotation().type)
+		) {
+			str = &assignment->leftHandSide();
+			tail = &assignment->rightHandSide();
+		}
+	} else if (auto functionCall = to<FunctionCall>(&_statement.expression())) {
+		auto memberAccess = to<MemberAccess>(&functionCall->expression());
+		if (memberAccess && memberAccess->memberName() == "append" &&
+			isByteArrayOrString(memberAccess->expression().annotation().type) &&
+			functionCall->arguments().size() == 1
+		) {
+			str = &memberAccess->expression();
+			tail = functionCall->arguments().at(0).get();
+		}
+	}
+	auto identifier = to<Identifier>(str);
+	if (identifier == nullptr) {
+		return {};
+	}
+	auto vd = to<VariableDeclaration>(identifier->annotation().referencedDeclaration);
+	if (vd == nullptr || !vd->isLocalVariable()) {
+		return {};
+	}
+	return std::make_pair(vd, tail);
+}
+
+bool StringAppendScanner::visit(ExpressionStatement const& _statement) {
+	std::optional<std::pair<VariableDeclaration const*, Expression const*>> append = stringAppend(_statement);
+	if (!append) {
+		return true;
+	}
+	auto [vd, tail] = *append;
+	if (std::find(m_appended.begin(), m_appended.end(), vd) == m_appended.end()) {
+		m_appended.push_back(vd);
+	}
+	tail->accept(*this);
+	return false;
+}
+
+bool StringAppendScanner::visit(Identifier const& _identifier) {
+	if (auto vd = to<VariableDeclaration>(_identifier.annotation().referencedDeclaration)) {
+		m_used.insert(vd);
+	}
+	return true;
+}
+
+bool StringAppendScanner::visit(Return const&) {
+	m_hasReturn = true;
+	return true;
+}
+
+MessageTailScanner::MessageTailScanner(std::vector<ASTNode const*> const& loopParts, Statement const* loopVarDecl) {
+	if (auto decl = to<VariableDeclarationStatement>(loopVarDecl)) {
+		for (ASTPointer<VariableDeclaration> const& vd : decl->declarations()) {
+			if (vd) {
+				m_written.insert(vd.get());
+			}
+		}
+	}
+	for (ASTNode const* node : loopParts) {
+		if (node) {
+			node->accept(*this);
+		}
+	}
+}
+
+std::vector<FunctionCall const*> MessageTailScanner::messages() const {
+	std::vector<FunctionCall const*> res;
+	for (FunctionCall const* call : m_transfers) {
+		bool isInvariant = true;
+		for (Expression const* arg : transferTailArguments(*call)) {
+			auto identifier = to<Identifier>(arg);
+			auto vd = identifier ? to<VariableDeclaration>(identifier->annotation().referencedDeclaration) : nullptr;
+			isInvariant &= vd != nullptr && vd->isLocalVariable() && m_written.count(vd) == 0;
+		}
+		if (isInvariant) {
+			res.push_back(call);
+		}
+	}
+	return res;
+}
+
+std::vector<Expression const*> MessageTailScanner::transferTailArguments(FunctionCall const& _functionCall) {
+	auto memberAccess = to<MemberAccess>(&_functionCall.expression());
+	if (memberAccess == nullptr || memberAccess->memberName() != "transfer" ||
+		memberAccess->expression().annotation().type->category() != Type::Category::Address
+	) {
+		return {};
+	}
+	std::vector<Expression const*> args;
+	std::vector<ASTPointer<Expression const>> const& arguments = _functionCall.arguments();
+	std::vector<ASTPointer<ASTString>> const& names = _functionCall.names();
+	for (size_t i = 0; i < arguments.size(); ++i) {
+		if (names.empty() ? i >= 3 : isIn(*names.at(i), "body", "currencies", "stateInit")) {
+			args.push_back(arguments.at(i).get());
+		}
+	}
+	return args;
+}
+
+bool MessageTailScanner::visit(VariableDeclaration const& _variable) {
+	// variables declared in the loop get new values on each iteration
+	m_written.insert(&_variable);
+	return true;
+}
+
+bool MessageTailScanner::visit(Assignment const& _assignment) {
+	markWritten(_assignment.leftHandSide());
+	return true;
+}
+
+bool MessageTailScanner::visit(UnaryOperation const& _node) {
+	if (isIn(_node.getOperator(), Token::Inc, Token::Dec, Token::Delete)) {
+		markWritten(_node.subExpression());
+	}
+	return true;
+}
+
+bool MessageTailScanner::visit(FunctionCall const& _functionCall) {
+	if (!transferTailArguments(_functionCall).empty()) {
+		m_transfers.push_back(&_functionCall);
+	}
+	// methods like `push` change the object
+	if (auto memberAccess = to<MemberAccess>(&_functionCall.expression())) {
+		markWritten(memberAccess->expression());
+	}
+	return true;
+}
+
+void MessageTailScanner::markWritten(Expression const& _expression) {
+	Expression const* expr = &_expression;
+	while (true) {
+		if (auto indexAccess = to<IndexAccess>(expr)) {
+			expr = &indexAccess->baseExpression();
+		} else if (auto memberAccess = to<MemberAccess>(expr)) {
+			expr = &memberAccess->expression();
+		} else if (auto tuple = to<TupleExpression>(expr)) {
+			for (ASTPointer<Expression> const& component : tuple->components()) {
+				if (component) {
+					markWritten(*component);
+				}
+			}
+			return;
+		} else {
+			break;
+		}
+	}
+	if (auto identifier = to<Identifier>(expr)) {
+		if (auto vd = to<VariableDeclaration>(identifier->annotation().referencedDeclaration)) {
+			m_written.insert(vd);
+		}
+	}
+}
+
 bool withPrelocatedRetValues(const FunctionDefinition *f) {
 	LocationReturn locationReturn = ::notNeedsPushContWhenInlining(f->body());
 	if (!f->returnParameters().empty() && isIn(locationReturn, LocationReturn::noReturn, LocationReturn::Anywhere)) {
@@ -293,3 +743,627 @@ LocationReturn notNeedsPushContWhenInlining(const Block &_block) {
 	bool isLastStatementReturn = to<Return>(statements.back().get()) != nullptr;
 	return isLastStatementReturn ? LocationReturn::Last : LocationReturn::Anywhere;
 }
+
+namespace {
+	class SideEffectFreeExprChecker : public ASTConstVisitor {
+	public:
+		SideEffectFreeExprChecker(Expression const& _expr, std::function<bool(VariableDeclaration const&)> _canRead) :
+			m_canRead{std::move(_canRead)}
+		{
+			_expr.accept(*this);
+		}
+		bool isOk() const { return m_isOk; }
+	private:
+		bool visitNode(ASTNode const&) override {
+			m_isOk = false;
+			return false;
+		}
+		bool visit(Literal const&) override { return true; }
+		bool visit(ElementaryTypeNameExpression const&) override { return true; }
+		bool visit(TupleExpression const& _node) override { return !_node.isInlineArray(); }
+		bool visit(Conditional const&) override { return true; }
+		bool visit(BinaryOperation const&) override { return true; }
+		bool visit(IndexAccess const&) override { return true; }
+		bool visit(MemberAccess const&) override { return true; }
+		bool visit(UnaryOperation const& _node) override {
+			if (isIn(_node.getOperator(), Token::Inc, Token::Dec, Token::Delete)) {
+				m_isOk = false;
+			}
+			return m_isOk;
+		}
+		bool visit(Identifier const& _node) override {
+			auto vd = to<VariableDeclaration>(_node.annotation().referencedDeclaration);
+			if (vd && !m_canRead(*vd)) {
+				m_isOk = false;
+			}
+			return m_isOk;
+		}
+		bool visit(FunctionCall const& _node) override {
+			if (isIn(_node.annotation().kind, FunctionCallKind::TypeConversion, FunctionCallKind::StructConstructorCall)) {
+				return true;
+			}
+			auto funType = to<FunctionType>(getType(&_node.expression()));
+			if (funType == nullptr || _node.isAwait()) {
+				m_isOk = false;
+				return false;
+			}
+			switch (funType->kind()) {
+				case FunctionType::Kind::Internal:
+				case FunctionType::Kind::DelegateCall:
+					m_isOk = funType->stateMutability() <= StateMutability::View;
+					break;
+				case FunctionType::Kind::AddressIsZero:
+				case FunctionType::Kind::AddressType:
+				case FunctionType::Kind::ArrayEmpty:
+				case FunctionType::Kind::MappingEmpty:
+				case FunctionType::Kind::MappingExists:
+				case FunctionType::Kind::MsgPubkey:
+				case FunctionType::Kind::OptionalHasValue:
+				case FunctionType::Kind::TVMPubkey:
+					break;
+				default:
+					m_isOk = false;
+					break;
+			}
+			return m_isOk;
+		}
+	private:
+		std::function<bool(VariableDeclaration const&)> m_canRead;
+		bool m_isOk{true};
+	};
+}
+
+bool isSideEffectFree(Expression const& expr, std::function<bool(VariableDeclaration const&)> const& canRead) {
+	return SideEffectFreeExprChecker{expr, canRead}.isOk();
+}
+
+namespace {
+	class TupleArrayUsageChecker : public ASTConstVisitor {
+	public:
+		explicit TupleArrayUsageChecker(VariableDeclaration const& _variable) : m_variable{_variable} {
+			m_variable.scope()->accept(*this);
+		}
+		bool isOk() const { return m_hasInlineArrayInit && !m_hasOtherUsage; }
+	private:
+		bool visit(VariableDeclarationStatement const& _node) override {
+			if (_node.declarations().size() == 1 && _node.declarations().at(0).get() == &m_variable) {
+				auto init = to<TupleExpression>(_node.initialValue());
+				auto arrayType = to<ArrayType>(m_variable.type());
+				m_hasInlineArrayInit = init != nullptr && init->isInlineArray() &&
+					init->components().size() == arrayType->length();
+			}
+			return true;
+		}
+		bool visit(IndexAccess const& _node) override {
+			m_allowedUsages.insert(&_node.baseExpression());
+			return true;
+		}
+		bool visit(MemberAccess const& _node) override {
+			if (_node.memberName() == "length") {
+				m_allowedUsages.insert(&_node.expression());
+			}
+			return true;
+		}
+		bool visit(Identifier const& _node) override {
+			if (_node.annotation().referencedDeclaration == &m_variable && m_allowedUsages.count(&_node) == 0) {
+				m_hasOtherUsage = true;
+			}
+			return true;
+		}
+	private:
+		VariableDeclaration const& m_variable;
+		std::set<Expression const*> m_allowedUsages;
+		bool m_hasInlineArrayInit{};
+		bool m_hasOtherUsage{};
+	};
+}
+
+bool canBeTupleArray(VariableDeclaration const& vd) {
+	auto arrayType = to<ArrayType>(vd.type());
+	if (!vd.isLocalVariable() || vd.isCallableOrCatchParameter() || vd.scope() == nullptr ||
+		arrayType == nullptr || arrayType->isByteArray() ||
+		arrayType->length() == 0 || arrayType->length() > TvmConst::TupleArray::MaxLength
+	) {
+		return false;
+	}
+	return TupleArrayUsageChecker{vd}.isOk();
+}
+
+int checkQtyBeforeParamDecoding(FunctionDefinition const& f, ContactsUsageScanner const& usage) {
+	auto contract = to<ContractDefinition>(f.scope());
+	if (!f.isPublic() || !f.isImplemented() || f.isConstructor() || f.isReceive() || f.isFallback() ||
+		f.isOnBounce() || f.isOnTickTock() || f.name() == "onCodeUpgrade" || isMacro(f.name()) ||
+		!f.modifiers().empty() || f.externalMsg() || f.internalMsg() ||
+		contract == nullptr || contract->isLibrary() ||
+		// the macro of the function is shared with internal calls
+		usage.isFunctionNameUsed(f.name())
+	) {
+		return 0;
+	}
+	int qty = 0;
+	for (ASTPointer<Statement> const& statement : f.body().statements()) {
+		auto exprStatement = to<ExpressionStatement>(statement.get());
+		auto call = exprStatement ? to<FunctionCall>(&exprStatement->expression()) : nullptr;
+		auto funType = call ? to<FunctionType>(getType(&call->expression())) : nullptr;
+		if (funType == nullptr || !isIn(funType->kind(), FunctionType::Kind::Require, FunctionType::Kind::Revert)) {
+			break;
+		}
+		bool isOk = true;
+		for (ASTPointer<Expression const> const& arg : call->arguments()) {
+			isOk &= isSideEffectFree(*arg, [](VariableDeclaration const& vd) { return vd.isStateVariable(); });
+		}
+		if (!isOk) {
+			break;
+		}
+		++qty;
+	}
+	return qty;
+}
+
+namespace {
+	class StateVariableUsersScanner : public ASTConstVisitor {
+	public:
+		explicit StateVariableUsersScanner(ContractDefinition const& _contract) {
+			for (ContractDefinition const* c : _contract.annotation().linearizedBaseContracts) {
+				c->accept(*this);
+			}
+		}
+		int userQty(VariableDeclaration const* vd) const {
+			auto it = m_users.find(vd);
+			return it == m_users.end() ? 0 : it->second.size();
+		}
+	private:
+		bool visit(FunctionDefinition const& _node) override {
+			m_currentCallable = &_node;
+			return true;
+		}
+		bool visit(ModifierDefinition const& _node) override {
+			m_currentCallable = &_node;
+			return true;
+		}
+		bool visit(Identifier const& _node) override {
+			auto vd = to<VariableDeclaration>(_node.annotation().referencedDeclaration);
+			if (vd && vd->isStateVariable() && m_currentCallable) {
+				m_users[vd].insert(m_currentCallable);
+			}
+			return true;
+		}
+	private:
+		CallableDeclaration const* m_currentCallable{};
+		std::map<VariableDeclaration const*, std::set<CallableDeclaration const*>> m_users;
+	};
+
+	std::vector<Type const*> typesOf(std::vector<VariableDeclaration const*> const& variables) {
+		std::vector<Type const*> types;
+		for (VariableDeclaration const* vd : variables) {
+			types.push_back(vd->type());
+		}
+		return types;
+	}
+}
+
+std::vector<VariableDeclaration const*> optimizeStorageLayout(
+	ContractDefinition const& contract,
+	std::vector<VariableDeclaration const*> const& variables,
+	int usedBits,
+	int usedRefs
+) {
+	if (variables.size() < 2) {
+		return variables;
+	}
+
+	struct Item {
+		int index{};
+		int userQty{};
+		ABITypeSize size;
+	};
+	StateVariableUsersScanner scanner{contract};
+	std::vector<Item> items;
+	for (int i = 0; i < static_cast<int>(variables.size()); ++i) {
+		items.push_back(Item{i, scanner.userQty(variables[i]), ABITypeSize{variables[i]->type()}});
+	}
+	std::stable_sort(items.begin(), items.end(), [](Item const& a, Item const& b) {
+		if (a.userQty != b.userQty) {
+			return a.userQty > b.userQty;
+		}
+		return a.size.maxBits + a.size.maxRefs * TvmConst::CellBitLength >
+			b.size.maxBits + b.size.maxRefs * TvmConst::CellBitLength;
+	});
+
+	// First fit: the last reference of a cell is reserved for the next cell of the chain.
+	struct Cell {
+		int bits{};
+		int refs{};
+		std::vector<int> indexes;
+	};
+	std::vector<Cell> cells{Cell{usedBits, usedRefs, {}}};
+	for (Item const& item : items) {
+		auto fits = [&](Cell const& cell) {
+			return cell.bits + item.size.maxBits <= TvmConst::CellBitLength && cell.refs + item.size.maxRefs <= 3;
+		};
+		auto it = std::find_if(cells.begin(), cells.end(), fits);
+		if (it == cells.end()) {
+			cells.emplace_back();
+			it = std::prev(cells.end());
+		}
+		it->bits += item.size.maxBits;
+		it->refs += item.size.maxRefs;
+		it->indexes.push_back(item.index);
+	}
+
+	std::vector<VariableDeclaration const*> layout;
+	for (Cell& cell : cells) {
+		std::sort(cell.indexes.begin(), cell.indexes.end());
+		for (int index : cell.indexes) {
+			layout.push_back(variables.at(index));
+		}
+	}
+
+	// the encoder fills cells one by one, so check that the new order doesn't take more cells
+	int newCellQty = EncodePosition{usedBits, typesOf(layout), usedRefs}.countOfCreatedBuilders();
+	int oldCellQty = EncodePosition{usedBits, typesOf(variables), usedRefs}.countOfCreatedBuilders();
+	return newCellQty <= oldCellQty ? layout : variables;
+}
+
+namespace {
+	class LocalVariableUsageScanner : public ASTConstVisitor {
+	public:
+		LocalVariableUsageScanner(VariableDeclaration const& _variable, ASTNode const& _node) :
+			m_variable{_variable}
+		{
+			_node.accept(*this);
+		}
+		bool isUsed() const { return m_isUsed; }
+		bool isChanged() const { return m_isChanged; }
+	private:
+		bool visit(Identifier const& _node) override {
+			m_isUsed |= _node.annotation().referencedDeclaration == &m_variable;
+			return true;
+		}
+		bool visit(Assignment const& _node) override {
+			markChanged(_node.leftHandSide());
+			return true;
+		}
+		bool visit(UnaryOperation const& _node) override {
+			if (isIn(_node.getOperator(), Token::Inc, Token::Dec, Token::Delete)) {
+				markChanged(_node.subExpression());
+			}
+			return true;
+		}
+		bool visit(FunctionCall const& _node) override {
+			if (auto memberAccess = to<MemberAccess>(&_node.expression())) {
+				markChanged(memberAccess->expression());
+			}
+			return true;
+		}
+		void markChanged(Expression const& _expression) {
+			Expression const* expr = &_expression;
+			while (true) {
+				if (auto indexAccess = to<IndexAccess>(expr)) {
+					expr = &indexAccess->baseExpression();
+				} else if (auto memberAccess = to<MemberAccess>(expr)) {
+					expr = &memberAccess->expression();
+				} else if (auto tuple = to<TupleExpression>(expr)) {
+					for (ASTPointer<Expression> const& component : tuple->components()) {
+						if (component) {
+							markChanged(*component);
+						}
+					}
+					return;
+				} else {
+					break;
+				}
+			}
+			if (auto identifier = to<Identifier>(expr)) {
+				m_isChanged |= identifier->annotation().referencedDeclaration == &m_variable;
+			}
+		}
+	private:
+		VariableDeclaration const& m_variable;
+		bool m_isUsed{};
+		bool m_isChanged{};
+	};
+}
+
+bool isVariableUsed(VariableDeclaration const& vd, ASTNode const& node) {
+	return LocalVariableUsageScanner{vd, node}.isUsed();
+}
+
+bool isVariableChanged(VariableDeclaration const& vd, ASTNode const& node) {
+	return LocalVariableUsageScanner{vd, node}.isChanged();
+}
+
+namespace {
+	using KnownOptionals = std::set<VariableDeclaration const*>;
+
+	// @returns the local optional variable `x` if the expression is `x.<memberName>(...)`
+	VariableDeclaration const* optionalMethodObject(Expression const& _expr, std::string const& _memberName) {
+		auto call = to<FunctionCall>(&_expr);
+		auto memberAccess = call ? to<MemberAccess>(&call->expression()) : nullptr;
+		if (memberAccess == nullptr || memberAccess->memberName() != _memberName) {
+			return nullptr;
+		}
+		auto identifier = to<Identifier>(&memberAccess->expression());
+		auto vd = identifier ? to<VariableDeclaration>(identifier->annotation().referencedDeclaration) : nullptr;
+		if (vd == nullptr || !vd->isLocalVariable() || vd->type()->category() != Type::Category::Optional) {
+			return nullptr;
+		}
+		return vd;
+	}
+
+	// @returns true if the optional variable has a value after it is assigned the expression,
+	// i.e. the expression is a value of the optional and not null or another optional
+	bool isAssignedValue(VariableDeclaration const& _vd, Expression const& _value) {
+		auto optType = to<OptionalType>(_vd.type());
+		return optType && _value.annotation().type->isImplicitlyConvertibleTo(*optType->valueType());
+	}
+
+	// @returns variables that have a value if the condition is equal to @param _isTrue
+	KnownOptionals conditionFacts(Expression const& _cond, bool _isTrue) {
+		if (auto tuple = to<TupleExpression>(&_cond)) {
+			if (!tuple->isInlineArray() && tuple->components().size() == 1 && tuple->components().at(0)) {
+				return conditionFacts(*tuple->components().at(0), _isTrue);
+			}
+		} else if (auto unary = to<UnaryOperation>(&_cond)) {
+			if (unary->getOperator() == Token::Not) {
+				return conditionFacts(unary->subExpression(), !_isTrue);
+			}
+		} else if (auto binary = to<BinaryOperation>(&_cond)) {
+			if (binary->getOperator() == (_isTrue ? Token::And : Token::Or)) {
+				KnownOptionals res = conditionFacts(binary->leftExpression(), _isTrue);
+				KnownOptionals right = conditionFacts(binary->rightExpression(), _isTrue);
+				res.insert(right.begin(), right.end());
+				return res;
+			}
+		} else if (_isTrue) {
+			if (VariableDeclaration const* vd = optionalMethodObject(_cond, "hasValue")) {
+				return {vd};
+			}
+		}
+		return {};
+	}
+
+	// Collects local optional variables that can be reset or assigned in the node
+	class ChangedOptionalsCollector : public ASTConstVisitor {
+	public:
+		explicit ChangedOptionalsCollector(ASTNode const& _node) {
+			_node.accept(*this);
+		}
+		KnownOptionals changed() const { return m_changed; }
+	private:
+		bool visit(Assignment const& _node) override {
+			markChanged(_node.leftHandSide());
+			return true;
+		}
+		bool visit(UnaryOperation const& _node) override {
+			if (_node.getOperator() == Token::Delete) {
+				markChanged(_node.subExpression());
+			}
+			return true;
+		}
+		bool visit(VariableDeclaration const& _node) override {
+			m_changed.insert(&_node);
+			return true;
+		}
+		bool visit(FunctionCall const& _node) override {
+			for (char const* method : {"set", "reset"}) {
+				if (VariableDeclaration const* vd = optionalMethodObject(_node, method)) {
+					m_changed.insert(vd);
+				}
+			}
+			return true;
+		}
+		void markChanged(Expression const& _expr) {
+			if (auto tuple = to<TupleExpression>(&_expr)) {
+				for (ASTPointer<Expression> const& component : tuple->components()) {
+					if (component) {
+						markChanged(*component);
+					}
+				}
+			} else if (auto identifier = to<Identifier>(&_expr)) {
+				if (auto vd = to<VariableDeclaration>(identifier->annotation().referencedDeclaration)) {
+					m_changed.insert(vd);
+				}
+			}
+		}
+	private:
+		KnownOptionals m_changed;
+	};
+
+	// Collects `x.get()` calls of the expression where `x` is known to have a value. Takes into account
+	// branches of `?:`. Right operands of `&&` and `||` are not, because cheap ones are evaluated unconditionally.
+	class OptionalGetCollector : public ASTConstVisitor {
+	public:
+		OptionalGetCollector(KnownOptionals _known, KnownOptionals const& _changed, std::set<FunctionCall const*>& _gets) :
+			m_known{std::move(_known)},
+			m_changed{_changed},
+			m_gets{_gets}
+		{
+		}
+	private:
+		bool visit(FunctionCall const& _node) override {
+			VariableDeclaration const* vd = optionalMethodObject(_node, "get");
+			if (vd && m_known.count(vd)) {
+				m_gets.insert(&_node);
+			}
+			return true;
+		}
+		bool visit(Conditional const& _node) override {
+			_node.condition().accept(*this);
+			acceptWithFacts(_node.trueExpression(), conditionFacts(_node.condition(), true));
+			acceptWithFacts(_node.falseExpression(), conditionFacts(_node.condition(), false));
+			return false;
+		}
+		void acceptWithFacts(Expression const& _expr, KnownOptionals const& _facts) {
+			KnownOptionals saved = m_known;
+			for (VariableDeclaration const* vd : _facts) {
+				if (m_changed.count(vd) == 0) {
+					m_known.insert(vd);
+				}
+			}
+			_expr.accept(*this);
+			m_known = std::move(saved);
+		}
+	private:
+		KnownOptionals m_known;
+		KnownOptionals const& m_changed;
+		std::set<FunctionCall const*>& m_gets;
+	};
+
+	class OptionalValueScanner {
+	public:
+		explicit OptionalValueScanner(CallableDeclaration const& _function) {
+			KnownOptionals known;
+			if (auto f = to<FunctionDefinition>(&_function)) {
+				if (f->isImplemented()) {
+					scan(f->body(), known);
+				}
+			} else if (auto m = to<ModifierDefinition>(&_function)) {
+				scan(m->body(), known);
+			}
+		}
+		std::set<FunctionCall const*> const& gets() const { return m_gets; }
+	private:
+		// @returns false if the end of the statement is unreachable
+		bool scan(Statement const& _statement, KnownOptionals& _known) {
+			if (auto block = to<Block>(&_statement)) {
+				for (ASTPointer<Statement> const& statement : block->statements()) {
+					if (!scan(*statement, _known)) {
+						return false;
+					}
+				}
+				return true;
+			}
+			if (auto vds = to<VariableDeclarationStatement>(&_statement)) {
+				if (vds->initialValue()) {
+					scanExpression(*vds->initialValue(), _known);
+				}
+				for (ASTPointer<VariableDeclaration> const& decl : vds->declarations()) {
+					if (decl) {
+						_known.erase(decl.get());
+					}
+				}
+				if (vds->declarations().size() == 1 && vds->declarations().at(0) && vds->initialValue() &&
+					isAssignedValue(*vds->declarations().at(0), *vds->initialValue())
+				) {
+					_known.insert(vds->declarations().at(0).get());
+				}
+				return true;
+			}
+			if (auto exprStatement = to<ExpressionStatement>(&_statement)) {
+				return scanExpressionStatement(exprStatement->expression(), _known);
+			}
+			if (auto ifStatement = to<IfStatement>(&_statement)) {
+				scanExpression(ifStatement->condition(), _known);
+				KnownOptionals trueKnown = withFacts(_known, ifStatement->condition(), true);
+				KnownOptionals falseKnown = withFacts(_known, ifStatement->condition(), false);
+				bool trueReachable = scan(ifStatement->trueStatement(), trueKnown);
+				bool falseReachable = ifStatement->falseStatement() ? scan(*ifStatement->falseStatement(), falseKnown) : true;
+				if (trueReachable && falseReachable) {
+					_known.clear();
+					std::set_intersection(trueKnown.begin(), trueKnown.end(), falseKnown.begin(), falseKnown.end(),
+						std::inserter(_known, _known.end()));
+				} else if (trueReachable) {
+					_known = trueKnown;
+				} else if (falseReachable) {
+					_known = falseKnown;
+				}
+				return trueReachable || falseReachable;
+			}
+			if (auto forStatement = to<ForStatement>(&_statement)) {
+				if (forStatement->initializationExpression()) {
+					scan(*forStatement->initializationExpression(), _known);
+				}
+				forgetChanged(_statement, _known);
+				if (forStatement->condition()) {
+					scanExpression(*forStatement->condition(), _known);
+				}
+				KnownOptionals bodyKnown = forStatement->condition() ?
+					withFacts(_known, *forStatement->condition(), true) : _known;
+				scan(forStatement->body(), bodyKnown);
+				if (forStatement->loopExpression()) {
+					KnownOptionals loopKnown = _known;
+					scan(*forStatement->loopExpression(), loopKnown);
+				}
+				return true;
+			}
+			if (auto whileStatement = to<WhileStatement>(&_statement)) {
+				forgetChanged(_statement, _known);
+				scanExpression(whileStatement->condition(), _known);
+				KnownOptionals bodyKnown = whileStatement->loopType() == WhileStatement::LoopType::WHILE_DO ?
+					withFacts(_known, whileStatement->condition(), true) : _known;
+				scan(whileStatement->body(), bodyKnown);
+				return true;
+			}
+			if (auto ret = to<Return>(&_statement)) {
+				if (ret->expression()) {
+					scanExpression(*ret->expression(), _known);
+				}
+				return false;
+			}
+			if (to<Break>(&_statement) || to<Continue>(&_statement)) {
+				return false;
+			}
+			// other statements are scanned without flow information
+			KnownOptionals changed = ChangedOptionalsCollector{_statement}.changed();
+			forgetChanged(_statement, _known);
+			OptionalGetCollector collector{_known, changed, m_gets};
+			_statement.accept(collector);
+			return true;
+		}
+
+		bool scanExpressionStatement(Expression const& _expr, KnownOptionals& _known) {
+			scanExpression(_expr, _known);
+			if (VariableDeclaration const* vd = optionalMethodObject(_expr, "set")) {
+				_known.insert(vd);
+			} else if (auto assignment = to<Assignment>(&_expr)) {
+				auto identifier = to<Identifier>(&assignment->leftHandSide());
+				auto vd = identifier ? to<VariableDeclaration>(identifier->annotation().referencedDeclaration) : nullptr;
+				if (vd && vd->isLocalVariable() && assignment->assignmentOperator() == Token::Assign &&
+					isAssignedValue(*vd, assignment->rightHandSide())
+				) {
+					_known.insert(vd);
+				}
+			} else if (auto call = to<FunctionCall>(&_expr)) {
+				auto funType = to<FunctionType>(getType(&call->expression()));
+				if (funType && funType->kind() == FunctionType::Kind::Require && !call->arguments().empty()) {
+					_known = withFacts(_known, *call->arguments().at(0), true);
+				} else if (funType && funType->kind() == FunctionType::Kind::Revert) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		// Collects gets of the expression and forgets variables changed by it
+		void scanExpression(Expression const& _expr, KnownOptionals& _known) {
+			forgetChanged(_expr, _known);
+			KnownOptionals changed = ChangedOptionalsCollector{_expr}.changed();
+			OptionalGetCollector collector{_known, changed, m_gets};
+			_expr.accept(collector);
+		}
+
+		static void forgetChanged(ASTNode const& _node, KnownOptionals& _known) {
+			KnownOptionals changed = ChangedOptionalsCollector{_node}.changed();
+			for (VariableDeclaration const* vd : changed) {
+				_known.erase(vd);
+			}
+		}
+
+		static KnownOptionals withFacts(KnownOptionals _known, Expression const& _cond, bool _isTrue) {
+			KnownOptionals changed = ChangedOptionalsCollector{_cond}.changed();
+			for (VariableDeclaration const* vd : conditionFacts(_cond, _isTrue)) {
+				if (changed.count(vd) == 0) {
+					_known.insert(vd);
+				}
+			}
+			return _known;
+		}
+	private:
+		std::set<FunctionCall const*> m_gets;
+	};
+}
+
+std::set<FunctionCall const*> optionalGetsWithValue(CallableDeclaration const& f) {
+	return OptionalValueScanner{f}.gets();
+}
@@ -18,6 +18,8 @@
 
 #pragma once
 
+#include <functional>
+
 #include <libsolidity/ast/ASTVisitor.h>
 
 #include <libsolidity/codegen/TVMCommons.hpp>
@@ -70,6 +72,7 @@ public:
 	explicit ContactsUsageScanner(ContractDefinition const& cd);
 	bool visit(FunctionCall const& _functionCall) override;
 	bool visit(MemberAccess const &_node) override;
+	bool visit(Identifier const& _identifier) override;
 	bool visit(FunctionDefinition const& fd) override;
 
 	bool hasMsgPubkey() const { return m_hasMsgPubkey; }
@@ -78,6 +81,7 @@ public:
 	bool hasAwaitCall() const { return m_hasAwaitCall; }
 	bool hasTvmCode() const { return m_hasTvmCode; }
 	set<FunctionDefinition const *> const& awaitFunctions() const { return m_awaitFunctions; }
+	bool isFunctionNameUsed(std::string const& name) const { return m_usedFunctionNames.count(name) != 0; }
 
 private:
 	bool m_hasMsgPubkey{};
@@ -87,6 +91,7 @@ private:
 	bool m_hasTvmCode{};
 	std::set<Declaration const*> m_usedFunctions;
 	std::set<FunctionDefinition const*> m_awaitFunctions;
+	std::set<std::string> m_usedFunctionNames;
 };
 
 class LoopScanner: public ASTConstVisitor
@@ -150,8 +155,162 @@ public:
 	ContInfo m_info;
 };
 
+/// Collects state variables that are accessed often enough inside a function body to be kept on the
+/// stack instead of calling GETGLOB/SETGLOB on every access. A variable is loaded once at the function
+/// entry and, if it is changed, saved back before each exit from the function.
+class StateVariableCacheScanner: public ASTConstVisitor
+{
+public:
+	explicit StateVariableCacheScanner(FunctionDefinition const& f);
+
+	/// @returns variables that should be kept on the stack, sorted by the order of the first access.
+	std::vector<VariableDeclaration const*> cachedVariables() const;
+	bool isWritten(VariableDeclaration const* vd) const { return m_written.count(vd) != 0; }
+
+private:
+	bool visit(ForEachStatement const&) override;
+	bool visit(WhileStatement const&) override;
+	bool visit(ForStatement const&) override;
+	void endVisit(ForEachStatement const&) override;
+	void endVisit(WhileStatement const&) override;
+	void endVisit(ForStatement const&) override;
+	bool visit(Identifier const& _identifier) override;
+	bool visit(Assignment const& _assignment) override;
+	bool visit(UnaryOperation const& _node) override;
+	bool visit(FunctionCall const& _functionCall) override;
+
+	void markWritten(Expression const& _expression);
+
+private:
+	int m_loopDepth{};
+	bool m_mayReadState{};
+	bool m_mayWriteState{};
+	std::vector<VariableDeclaration const*> m_variables;
+	std::map<VariableDeclaration const*, int> m_accessQty;
+	std::set<VariableDeclaration const*> m_accessedInLoop;
+	std::set<VariableDeclaration const*> m_written;
+};
+
+/// Collects compile-time integer constants of a loop (condition, body, loop expression)
+/// that are worth pushing once before the loop instead of on each iteration.
+/// A constant is hoisted if it is pushed at least twice on every iteration or is used in a nested loop.
+/// Uses in branches (if/else, ?:, the right operand of && and ||) are not counted,
+/// as the branch can be skipped and then PUSHINT before the loop and DROP after it are wasted.
+class LoopInvariantConstantScanner: public ASTConstVisitor
+{
+public:
+	explicit LoopInvariantConstantScanner(std::vector<ASTNode const*> const& loopParts);
+
+	/// @returns constants sorted by the order of the first use.
+	std::vector<bigint> const& constants() const { return m_constants; }
+
+protected:
+	bool visit(IfStatement const& _node) override;
+	bool visit(Conditional const& _node) override;
+	bool visit(BinaryOperation const& _node) override;
+	bool visit(WhileStatement const& _node) override;
+	bool visit(ForStatement const& _node) override;
+	bool visit(ForEachStatement const& _node) override;
+	bool visitNode(ASTNode const& _node) override;
+
+private:
+	/// @returns false if the expression is a constant, it's counted then
+	bool addUse(Expression const& _expr);
+	void acceptInBranch(ASTNode const* _node);
+
+	std::vector<bigint> m_constants;
+	/// Constants in the order of the first use with the number of uses per iteration
+	std::vector<std::pair<bigint, int>> m_uses;
+	int m_branchDepth{};
+	int m_loopDepth{};
+};
+
+/// Collects local string variables that are only extended in a loop by `str += tail;` or `str.append(tail);`.
+/// Such variables can be kept in the builder list during the loop and be assembled once after it.
+class StringAppendScanner: public ASTConstVisitor
+{
+public:
+	explicit StringAppendScanner(std::vector<ASTNode const*> const& loopParts);
+
+	/// @returns variables sorted by the order of the first append.
+	std::vector<VariableDeclaration const*> variables() const;
+
+	/// @returns the extended variable and the tail if the statement is `str += tail;` or `str.append(tail);`.
+	static std::optional<std::pair<VariableDeclaration const*, Expression const*>> stringAppend(ExpressionStatement const& _statement);
+
+private:
+	bool visit(ExpressionStatement const& _statement) override;
+	bool visit(Identifier const& _identifier) override;
+	bool visit(Return const&) override;
+
+private:
+	bool m_hasReturn{};
+	std::vector<VariableDeclaration const*> m_appended;
+	std::set<VariableDeclaration const*> m_used;
+};
+
+/// Collects `addr.transfer(...)` calls of a loop whose body, currencies and stateInit are local variables
+/// not changed in the loop. The part of such messages after the value can be built once before the loop.
+/// The variables declared by @a loopVarDecl, e.g. the range declaration of for-each, get new values too.
+class MessageTailScanner: public ASTConstVisitor
+{
+public:
+	MessageTailScanner(std::vector<ASTNode const*> const& loopParts, Statement const* loopVarDecl);
+
+	/// @returns calls sorted by the order in the loop.
+	std::vector<FunctionCall const*> messages() const;
+
+	/// @returns body, currencies and stateInit of `addr.transfer(...)` or empty vector if it's not such a call.
+	static std::vector<Expression const*> transferTailArguments(FunctionCall const& _functionCall);
+
+private:
+	bool visit(VariableDeclaration const& _variable) override;
+	bool visit(Assignment const& _assignment) override;
+	bool visit(UnaryOperation const& _node) override;
+	bool visit(FunctionCall const& _functionCall) override;
+
+	void markWritten(Expression const& _expression);
+
+private:
+	std::vector<FunctionCall const*> m_transfers;
+	std::set<VariableDeclaration const*> m_written;
+};
+
 }
 
 LocationReturn notNeedsPushContWhenInlining(Block const &_block);
 
 bool withPrelocatedRetValues(FunctionDefinition const* f);
+
+/// @returns true if the expression doesn't change anything and reads only variables allowed by canRead.
+bool isSideEffectFree(Expression const& expr, std::function<bool(VariableDeclaration const&)> const& canRead);
+
+/// @returns quantity of first statements in the body of the public function that are require/revert checks
+/// not depending on the function parameters. Such checks are done before decoding of the parameters.
+int checkQtyBeforeParamDecoding(FunctionDefinition const& f, ContactsUsageScanner const& usage);
+
+/// @returns true if the local fixed-size array can be kept on the stack as a tuple instead of PAIR(size, dict).
+/// The array must be initialized by an inline array and be used only in index accesses and `.length`.
+bool canBeTupleArray(VariableDeclaration const& vd);
+
+/// @returns state variables of the contract reordered to be packed into fewer cells of c4. Variables used by
+/// more functions go first to get into the root cell. The order of variables inside a cell is the declaration order.
+/// @param usedBits and @param usedRefs are taken in the root cell by the fields preceding state variables.
+std::vector<VariableDeclaration const*> optimizeStorageLayout(
+	ContractDefinition const& contract,
+	std::vector<VariableDeclaration const*> const& variables,
+	int usedBits,
+	int usedRefs
+);
+
+/// @returns true if the local variable is referenced in the node.
+bool isVariableUsed(VariableDeclaration const& vd, ASTNode const& node);
+
+/// @returns true if the local variable may be changed in the node: assigned, incremented, deleted or used as
+/// the object of a member function call.
+bool isVariableChanged(VariableDeclaration const& vd, ASTNode const& node);
+
+/// @returns `x.get()` calls of local optional variables that are known to have a value at the point of the call:
+/// after `x.set(...)`, an assignment of a non-optional value, `require(x.hasValue())` or in the branch of
+/// `if (x.hasValue())`. Such calls don't need to check the value for null.
+std::set<FunctionCall const*> optionalGetsWithValue(CallableDeclaration const& f);
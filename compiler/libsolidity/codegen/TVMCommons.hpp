@@ -272,6 +272,12 @@ public:
 		});
 	}
 
+	bool haveOptimizeStorageLayout() const {
+		return std::any_of(pragmaDirectives.begin(), pragmaDirectives.end(), [](const auto& pd){
+			return pd->literals().size() == 1 && pd->literals()[0] == "optimizeStorageLayout";
+		});
+	}
+
 	ASTPointer<Expression> haveMsgValue() const {
 		for (PragmaDirective const *pd : pragmaDirectives) {
 			if (pd->literals().size() == 1 &&
@@ -400,6 +406,8 @@ enum class GetDictOperation {
 	GetSetFromMapping,
 	GetAddFromMapping,
 	GetReplaceFromMapping,
+	GetAndSetFromMapping, // returns value or default value, if key doesn't exist
+	GetAndDeleteFromMapping, // returns value or default value, if key doesn't exist
 	GetFromArray,
 	Fetch,
 	Exist
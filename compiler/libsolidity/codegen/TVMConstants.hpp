@@ -105,6 +105,7 @@ namespace TvmConst {
 		const int dest = 4;
 		const int tons = 5;
 		const int currency = 6;
+		const int fieldQty = 11;
 	}
 
 	namespace ext_msg_info {
@@ -125,5 +126,34 @@ namespace TvmConst {
 	}
 
 	const int IterStackOptQty = 10;
+
+	// Gas of an instruction is 10 + its length in bits + 5 per reference, loading a cell costs 100
+	// the first time in a transaction and 25 after that. So PUSHSLICE of n data bits costs about n + 35,
+	// PUSHREFSLICE costs 23 + 100 on the first load and 23 + 25 on the next ones.
+	namespace ConstantPool {
+		// PUSHSLICE of 100 bits costs 130, of 96-99 bits 122, so from 100 bits on PUSHREFSLICE is cheaper
+		// even if the cell is loaded for the first time
+		const int MinSliceBitQty = 100;
+		// A literal used once gains only the difference above on the first load and costs a cell of its own.
+		// Used several times, it is stored in one cell, the next loads cost 25 and the code is shorter.
+		const int MinUseQty = 2;
+	}
+
+	namespace StateVarCache {
+		const int MinAccessQty = 4; // GETGLOB is cheaper than PUSH s(i) + initial GETGLOB for fewer accesses
+		const int MaxVariableQty = 8;
+	}
+
+	namespace LoopInvariant {
+		const int MaxCheapConstant = 32767; // bigger values are pushed by PUSHINT LONG
+		const int MaxConstantQty = 4;
+		// A hoisted constant costs PUSHINT LONG before the loop, DROP after it and PUSH s(i) for each use,
+		// so it pays off only if it is pushed at least twice per iteration
+		const int MinUseQty = 2;
+	}
+
+	namespace TupleArray {
+		const int MaxLength = 15; // INDEX, SETINDEX and TUPLE take the length as an immediate value
+	}
 	const int TvmTupleLen = 255;
 }
@@ -17,13 +17,17 @@
  */
 
 #include <boost/algorithm/string/replace.hpp>
+#include <boost/filesystem.hpp>
 #include <boost/range/adaptor/map.hpp>
 
 #include <libsolidity/interface/Version.h>
+#include <libsolutil/CommonIO.h>
 
 #include "TVMABI.hpp"
+#include "TvmAssembler.hpp"
 #include "TvmAst.hpp"
 #include "TvmAstVisitor.hpp"
+#include "TvmSourceMap.hpp"
 #include "TVMConstants.hpp"
 #include "TVMContractCompiler.hpp"
 #include "TVMExpressionCompiler.hpp"
@@ -199,20 +203,63 @@ void TVMContractCompiler::generateABI(
 
 void TVMContractCompiler::generateCode(
 	const std::string& fileName,
+	const std::string& bocFileName,
+	const std::string& sourceMapFileName,
+	const std::string& tvmLibraryPath,
 	ContractDefinition const& contract,
 	PragmaDirectiveHelper const &pragmaHelper
 ) {
 	Pointer<Contract> codeContract = generateContractCode(&contract, pragmaHelper);
+	TvmSourceMap sourceMap;
+	if (!sourceMapFileName.empty()) {
+		sourceMap.addContract(*codeContract);
+	}
 
-    ofstream ofile;
-    ofile.open(fileName);
-    if (!ofile) {
-		fatal_error("Failed to open the output file: " + fileName);
+	if (!fileName.empty()) {
+		ofstream ofile;
+		ofile.open(fileName);
+		if (!ofile) {
+			fatal_error("Failed to open the output file: " + fileName);
+		}
+		Printer p{ofile};
+		codeContract->accept(p);
+		p.flush();
+		ofile.close();
+		cout << "Code was generated and saved to file " << fileName << endl;
+	}
+
+	if (!bocFileName.empty()) {
+		TvmAssembler assembler{sourceMap};
+		if (!tvmLibraryPath.empty()) {
+			std::string const library = solidity::util::readFileAsString(tvmLibraryPath);
+			if (library.empty()) {
+				fatal_error("Failed to read the library: " + tvmLibraryPath);
+			}
+			assembler.addLibrary(library);
+		}
+		bytes const boc = serializeBagOfCells(assembler.assemble(*codeContract));
+		sourceMap.setCodeFile(boost::filesystem::path(bocFileName).filename().string());
+
+		ofstream ofile;
+		ofile.open(bocFileName, ios::binary);
+		if (!ofile) {
+			fatal_error("Failed to open the output file: " + bocFileName);
+		}
+		ofile.write(reinterpret_cast<char const*>(boc.data()), boc.size());
+		ofile.close();
+		cout << "Code cell was assembled and saved to file " << bocFileName << endl;
+	}
+
+	if (!sourceMapFileName.empty()) {
+		ofstream ofile;
+		ofile.open(sourceMapFileName);
+		if (!ofile) {
+			fatal_error("Failed to open the output file: " + sourceMapFileName);
+		}
+		sourceMap.print(ofile);
+		ofile.close();
+		cout << "Source map was generated and saved to file " << sourceMapFileName << endl;
 	}
-	Printer p{ofile};
-	codeContract->accept(p);
-    ofile.close();
-    cout << "Code was generated and saved to file " << fileName << endl;
 }
 
 Pointer<Contract>
@@ -222,6 +269,7 @@ TVMContractCompiler::generateContractCode(
 ) {
 	std::vector<std::string> pragmas;
 	std::vector<Pointer<Function>> functions;
+	std::vector<Pointer<Function>> publicFunctions;
 
 	TVMCompilerContext ctx{contract, pragmaHelper};
 	{
@@ -292,6 +340,7 @@ TVMContractCompiler::generateContractCode(
 						StackPusher pusher{&ctx};
 						Pointer<Function> f = TVMFunctionCompiler::generatePublicFunction(pusher, _function);
 						functions.push_back(f);
+						publicFunctions.push_back(f);
 
 						ChainDataEncoder encoder{&pusher};
 						uint32_t functionId = encoder.calculateFunctionIDWithReason(_function,
@@ -418,12 +467,21 @@ TVMContractCompiler::generateContractCode(
 		}
 	}
 
+	if (ctx.isAppendStringToBuildersUsed()) {
+		StackPusher pusher{&ctx};
+		functions.emplace_back(pusher.generateAppendStringToBuildersMacro());
+	}
+
 	if (!ctx.isStdlib()) {
 		StackPusher pusher{&ctx};
 		Pointer<Function> f = TVMFunctionCompiler::generatePublicFunctionSelector(pusher, contract);
 		functions.emplace_back(f);
 	}
 
+	if (!ctx.isStdlib()) {
+		updateOnlyChangedC4Cells(ctx, functions, publicFunctions);
+	}
+
 	if (ctx.usage().hasTvmCode()) {
 		pragmas.emplace_back(".pragma selector-save-my-code");
 	}
@@ -441,6 +499,91 @@ TVMContractCompiler::generateContractCode(
 	return c;
 }
 
+void TVMContractCompiler::updateOnlyChangedC4Cells(
+	TVMCompilerContext& ctx,
+	std::vector<Pointer<Function>>& functions,
+	std::vector<Pointer<Function>> const& publicFunctions
+) {
+	const std::map<int, int> cellStarts = ctx.storageCellStarts();
+	if (cellStarts.empty() || ctx.usage().hasAwaitCall()) {
+		return;
+	}
+
+	std::map<std::string, GlobWriteScanner> scanners;
+	for (Pointer<Function> const& f : functions) {
+		f->accept(scanners[f->name()]);
+	}
+	// @returns GLOB variables that can be set by the functions and all functions they call
+	// or nullopt if c4 or c7 can be changed as a whole
+	auto setGlobs = [&](std::vector<std::string> const& names) -> std::optional<std::set<int>> {
+		// loading of c4 doesn't make state variables differ from c4, the selector leads to other public functions
+		std::set<std::string> visited{"c4_to_c7", "c4_to_c7_with_init_storage", "c7_to_c4", "public_function_selector"};
+		std::vector<std::string> queue = names;
+		std::set<int> res;
+		while (!queue.empty()) {
+			std::string name = queue.back();
+			queue.pop_back();
+			if (!visited.insert(name).second || scanners.count(name) == 0) {
+				continue; // functions of stdlib don't know about state variables
+			}
+			GlobWriteScanner const& scanner = scanners.at(name);
+			if (scanner.hasUnknownWrite()) {
+				return std::nullopt;
+			}
+			res.insert(scanner.setGlobs().begin(), scanner.setGlobs().end());
+			queue.insert(queue.end(), scanner.callees().begin(), scanner.callees().end());
+		}
+		return res;
+	};
+
+	// state variables can be changed before the selector is called, e.g. in afterSignatureCheck
+	const std::optional<std::set<int>> beforeSelector = setGlobs({"main_internal", "main_external"});
+	if (!beforeSelector) {
+		return;
+	}
+	const int varQty = ctx.notConstantStateVariables().size();
+	std::set<int> cellQtys;
+	for (Pointer<Function> const& f : publicFunctions) {
+		std::optional<std::set<int>> globs = setGlobs({f->name()});
+		if (!globs) {
+			continue;
+		}
+		globs->insert(beforeSelector->begin(), beforeSelector->end());
+		int changedVarQty = 0;
+		for (int index : *globs) {
+			if (TvmConst::C7::FirstIndexForVariables <= index && index < TvmConst::C7::FirstIndexForVariables + varQty) {
+				changedVarQty = std::max(changedVarQty, index - TvmConst::C7::FirstIndexForVariables + 1);
+			}
+		}
+		auto it = std::find_if(cellStarts.begin(), cellStarts.end(), [&](auto const& cellStart) {
+			return cellStart.second >= changedVarQty;
+		});
+		if (it == cellStarts.end()) {
+			continue;
+		}
+		const int cellQty = it->first;
+		for (Pointer<TvmAstNode> const& node : f->block()->instructions()) {
+			Pointer<CodeBlock> block;
+			if (auto subProgram = to<SubProgram>(node.get())) {
+				block = subProgram->block();
+			} else if (auto ifElse = to<TvmIfElse>(node.get())) {
+				block = ifElse->trueBody();
+			}
+			if (block && block->instructions().size() == 1) {
+				auto gen = to<GenOpcode>(block->instructions().at(0).get());
+				if (gen && gen->fullOpcode() == "CALL $c7_to_c4$") {
+					block->upd({createNode<GenOpcode>("CALL $c7_to_c4_for_" + toString(cellQty) + "_cells$", 0, 0)});
+					cellQtys.insert(cellQty);
+				}
+			}
+		}
+	}
+	for (int cellQty : cellQtys) {
+		StackPusher pusher{&ctx};
+		functions.emplace_back(pusher.generateC7ToT4MacroForCells(cellQty));
+	}
+}
+
 void TVMContractCompiler::optimizeCode(Pointer<Contract>& c) {
 	DeleterCallX dc;
 	c->accept(dc);
@@ -457,6 +600,9 @@ void TVMContractCompiler::optimizeCode(Pointer<Contract>& c) {
 	peepHole = PeepholeOptimizer{true};
 	c->accept(peepHole);
 
+	ConstantPool pool;
+	c->accept(pool);
+
 	LocSquasher sq = LocSquasher{};
 	c->accept(sq);
 }
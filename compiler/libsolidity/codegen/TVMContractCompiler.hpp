@@ -49,8 +49,13 @@ public:
 		ContractDefinition const* contract,
 		std::vector<PragmaDirective const *> const& pragmaDirectives
 	);
+	// Saves the textual assembly to fileName, the assembled code cell to bocFileName
+	// and the source map to sourceMapFileName, empty names are skipped
 	static void generateCode(
 		const std::string& fileName,
+		const std::string& bocFileName,
+		const std::string& sourceMapFileName,
+		const std::string& tvmLibraryPath,
 		ContractDefinition const& contract,
 		PragmaDirectiveHelper const &pragmaHelper
 	);
@@ -58,6 +63,13 @@ public:
 	static void optimizeCode(Pointer<Contract>& c);
 private:
 	static void fillInlineFunctions(TVMCompilerContext& ctx, ContractDefinition const* contract);
+	// Public functions that can change only state variables from the first cells of c4 save only these cells
+	// and keep the rest of the chain from the current c4
+	static void updateOnlyChangedC4Cells(
+		TVMCompilerContext& ctx,
+		std::vector<Pointer<Function>>& functions,
+		std::vector<Pointer<Function>> const& publicFunctions
+	);
 };
 
 }	// end solidity::frontend
@@ -18,7 +18,10 @@
 
 #include  <boost/core/ignore_unused.hpp>
 
+#include <libsolidity/ast/TypeProvider.h>
+
 #include "DictOperations.hpp"
+#include "TVMABI.hpp"
 #include "TVMExpressionCompiler.hpp"
 #include "TVMFunctionCall.hpp"
 #include "TVMStructCompiler.hpp"
@@ -479,6 +482,28 @@ void TVMExpressionCompiler::visitBinaryOperationForString(
 	}
 }
 
+void TVMExpressionCompiler::concatenateStrings(std::vector<Expression const*> const& parts, Type const* commonType) {
+	// a + b + c + ... is stored into one builder list instead of calling concatenateStrings_macro
+	// for each '+' that walks through the whole accumulated string again
+	m_pusher.pushDefaultValue(TypeProvider::tvmtuple(TypeProvider::tvmbuilder()));
+	m_pusher.push(+1, "NEWC");
+	for (Expression const* part : parts) {
+		appendToStringBuilders(part, commonType);
+	}
+	m_pusher.pushMacroCallInCallRef(2, 1, "assembleList_macro");
+}
+
+void TVMExpressionCompiler::appendToStringBuilders(Expression const* str, Type const* strType) {
+	auto literal = to<Literal>(str);
+	if (literal && getType(literal)->category() == Type::Category::StringLiteral) {
+		m_pusher.appendStringToBuilders(literal->value());
+	} else {
+		compileNewExpr(str);
+		m_pusher.hardConvert(strType, getType(str));
+		m_pusher.appendStringToBuilders();
+	}
+}
+
 void TVMExpressionCompiler::visitBinaryOperationForTvmCell(
 	const std::function<void()>& pushLeft,
 	const std::function<void()>& pushRight,
@@ -541,6 +566,13 @@ void TVMExpressionCompiler::visit2(BinaryOperation const &_binaryOperation) {
 	};
 
 	if (isString(lt) && isString(rt)) {
+		if (op == Token::Add) {
+			std::vector<Expression const*> parts = unroll(_binaryOperation);
+			if (parts.size() > 2) {
+				concatenateStrings(parts, commonType);
+				return;
+			}
+		}
 		visitBinaryOperationForString(acceptLeft, acceptRight, op);
 		return;
 	}
@@ -880,6 +912,10 @@ bool TVMExpressionCompiler::checkForAddressMemberAccess(MemberAccess const &_nod
 void TVMExpressionCompiler::visitMemberAccessArray(MemberAccess const &_node) {
 	auto arrayType = to<ArrayType>(_node.expression().annotation().type);
 	if (_node.memberName() == "length") {
+		if (isTupleArray(_node.expression())) {
+			m_pusher.pushInt(static_cast<int>(arrayType->length()));
+			return;
+		}
 		compileNewExpr(&_node.expression());
 		if (arrayType->isByteArray()) {
 			m_pusher.byteLengthOfCell();
@@ -959,6 +995,15 @@ void TVMExpressionCompiler::visit2(IndexAccess const &indexAccess) {
 			m_pusher.push(-1 + 1, "PLDU 8");
 			m_pusher.callRef(2, 1);
 			return;
+		} else if (isTupleArray(indexAccess.baseExpression())) {
+			acceptExpr(&indexAccess.baseExpression()); // tuple
+			if (std::optional<int> index = pushTupleArrayIndex(indexAccess)) {
+				m_pusher.indexNoexcep(*index); // value
+			} else {
+				// tuple index
+				m_pusher.push(-2 + 1, "INDEXVAR"); // value
+			}
+			return;
 		} else {
 			compileNewExpr(indexAccess.indexExpression()); // index
 			acceptExpr(&indexAccess.baseExpression()); // index array
@@ -1025,6 +1070,36 @@ void TVMExpressionCompiler::visit2(Conditional const &_conditional) {
 	solAssert(stackSize + paramQty == m_pusher.stackSize(), "");
 }
 
+bool TVMExpressionCompiler::isTupleArray(Expression const& _expr) {
+	auto identifier = to<Identifier>(&_expr);
+	auto vd = identifier ? to<VariableDeclaration>(identifier->annotation().referencedDeclaration) : nullptr;
+	return vd != nullptr && m_pusher.ctx().isTupleArray(vd);
+}
+
+std::optional<int> TVMExpressionCompiler::constTupleArrayIndex(IndexAccess const& indexAccess) {
+	auto arrayType = to<ArrayType>(indexAccess.baseExpression().annotation().type);
+	std::optional<bigint> index = constValue(*indexAccess.indexExpression());
+	if (index.has_value() && 0 <= *index && *index < bigint(arrayType->length())) {
+		return static_cast<int>(*index);
+	}
+	return std::nullopt;
+}
+
+// Pushes the index if it's not a compile-time constant and checks that the index is in range.
+// @returns the index if it's a compile-time constant
+std::optional<int> TVMExpressionCompiler::pushTupleArrayIndex(IndexAccess const& indexAccess) {
+	if (std::optional<int> index = constTupleArrayIndex(indexAccess)) {
+		return index;
+	}
+	auto arrayType = to<ArrayType>(indexAccess.baseExpression().annotation().type);
+	compileNewExpr(indexAccess.indexExpression()); // index
+	m_pusher.pushS(0);
+	m_pusher.pushInt(static_cast<int>(arrayType->length()));
+	m_pusher.push(-2 + 1, "LESS");
+	m_pusher._throw("THROWIFNOT " + toString(TvmConst::RuntimeException::ArrayIndexOutOfRange));
+	return std::nullopt;
+}
+
 bool TVMExpressionCompiler::isOptionalGet(Expression const* expr) {
 	auto funCall = to<FunctionCall>(expr);
 	if (!funCall) {
@@ -1103,6 +1178,19 @@ TVMExpressionCompiler::expandLValue(
 				                 *StackPusher::parseValueType(*index),
 				                 GetDictOperation::GetFromMapping);
 				// index dict1 dict2
+			} else if (isTupleArray(index->baseExpression())) {
+				// tuple
+				std::optional<int> constIndex = pushTupleArrayIndex(*index); // tuple [index]
+				if (isLast && !withExpandLastValue) {
+					break;
+				}
+				if (constIndex) {
+					m_pusher.pushS(0); // tuple tuple
+					m_pusher.indexNoexcep(*constIndex); // tuple value
+				} else {
+					m_pusher.pushS2(1, 0); // tuple index tuple index
+					m_pusher.push(-2 + 1, "INDEXVAR"); // tuple index value
+				}
 			} else if (index->baseExpression().annotation().type->category() == Type::Category::Array) {
 				// array
 				m_pusher.push(-1 + 2, "UNPAIR"); // size dict
@@ -1131,6 +1219,12 @@ TVMExpressionCompiler::expandLValue(
 			m_pusher.pushS(0);
 			structCompiler.pushMember(memberName);
 		} else if (isOptionalGet(lValueInfo.expressions[i])) {
+			if (m_pusher.ctx().isOptionalGetWithValue(to<FunctionCall>(lValueInfo.expressions[i]))) {
+				if (isLast && !withExpandLastValue) {
+					m_pusher.drop();
+				}
+				continue;
+			}
 			if (!isLast || withExpandLastValue) {
 				m_pusher.pushS(0);
 			}
@@ -1193,6 +1287,21 @@ TVMExpressionCompiler::collectLValue(
 					m_pusher.rotRev(); // value index dict
 					m_pusher.setDict(*keyType, *valueDictType, dataType); // dict'
 				}
+			} else if (isTupleArray(indexAccess->baseExpression())) {
+				std::optional<int> constIndex = constTupleArrayIndex(*indexAccess);
+				if (isLast && !haveValueOnStackTop) {
+					// tuple [index]
+					if (!constIndex) {
+						m_pusher.drop(); // tuple
+					}
+				} else if (constIndex) {
+					// tuple value
+					m_pusher.setIndex(*constIndex); // tuple'
+				} else {
+					// tuple index value
+					m_pusher.exchange(1); // tuple value index
+					m_pusher.push(-3 + 1, "SETINDEXVAR"); // tuple'
+				}
 			} else if (indexAccess->baseExpression().annotation().type->category() == Type::Category::Array) {
 				//					pushLog("colArrIndex");
 				if (isLast && !haveValueOnStackTop) {
@@ -1266,6 +1375,151 @@ private:
 	bool m_hasSideEffects = false;
 };
 
+// @returns bit length of the type if the type is encoded with fixed number of bits and without references
+static std::optional<int> fixedBitLength(Type const* type) {
+	if (auto structType = to<StructType>(type)) {
+		int sum = 0;
+		for (ASTPointer<VariableDeclaration> const& member : structType->structDefinition().members()) {
+			std::optional<int> bits = fixedBitLength(member->type());
+			if (!bits) {
+				return {};
+			}
+			sum += *bits;
+		}
+		return sum;
+	}
+	if (isIn(type->category(), Type::Category::Integer, Type::Category::Enum, Type::Category::Bool,
+		Type::Category::FixedPoint, Type::Category::FixedBytes)
+	) {
+		return TypeInfo{type}.numBits;
+	}
+	return {};
+}
+
+bool TVMExpressionCompiler::tryAssignMappingStructMember(Assignment const& _assignment) {
+	// m[k].a.b = x
+	// m[k].a.b += x
+	// If all members of the struct have fixed bit length, the member is replaced directly
+	// in the slice stored in the mapping. The struct isn't decoded and encoded again.
+	const auto& lhs = _assignment.leftHandSide();
+	const auto& rhs = _assignment.rightHandSide();
+	const Token op = _assignment.assignmentOperator();
+	if (op != Token::Assign && isCurrentResultNeeded()) {
+		return false;
+	}
+
+	std::vector<std::string> path;
+	Expression const* expr = &lhs;
+	while (auto memberAccess = to<MemberAccess>(expr)) {
+		if (getType(&memberAccess->expression())->category() != Type::Category::Struct) {
+			return false;
+		}
+		path.push_back(memberAccess->memberName());
+		expr = &memberAccess->expression();
+	}
+	std::reverse(path.begin(), path.end());
+	auto indexAccess = to<IndexAccess>(expr);
+	if (path.empty() || indexAccess == nullptr ||
+		getType(&indexAccess->baseExpression())->category() != Type::Category::Mapping
+	) {
+		return false;
+	}
+
+	Type const* keyType = StackPusher::parseIndexType(indexAccess->baseExpression().annotation().type);
+	Type const* valueType = StackPusher::parseValueType(*indexAccess);
+	std::optional<int> structBitLength = fixedBitLength(valueType);
+	if (!structBitLength || EncodePosition{0, {valueType}}.countOfCreatedBuilders() != 0) {
+		return false;
+	}
+	int offset = 0;
+	Type const* memberType = valueType;
+	for (const std::string& name : path) {
+		auto structType = to<StructType>(memberType);
+		for (ASTPointer<VariableDeclaration> const& member : structType->structDefinition().members()) {
+			if (member->name() == name) {
+				memberType = member->type();
+				break;
+			}
+			offset += *fixedBitLength(member->type());
+		}
+	}
+	if (memberType->category() == Type::Category::Struct) {
+		return false;
+	}
+	const int memberBitLength = *fixedBitLength(memberType);
+
+	// value
+	compileNewExpr(&rhs);
+	m_pusher.hardConvert(memberType, getType(&rhs));
+	const int saveStackSize = m_pusher.stackSize();
+
+	// value lValue... index dict
+	LValueInfo lValueInfo = expandLValue(indexAccess, false, true, nullptr);
+	const bool isInRef = m_pusher.doesDictStoreValueInRef(keyType, valueType);
+	m_pusher.pushS2(1, 0);
+	m_pusher.pushInt(lengthOfDictKey(keyType));
+	m_pusher.startOpaque();
+	m_pusher.pushAsym("DICT" + typeToDictChar(keyType) + "GET" + (isInRef ? "REF" : ""));
+	if (isInRef) {
+		m_pusher.startContinuation();
+		m_pusher.push(0, "CTOS");
+		m_pusher.endContinuation();
+	}
+	// the struct has default value: all bits are zeros
+	m_pusher.startContinuation();
+	m_pusher.push(+1, "NEWC");
+	m_pusher.stzeroes(*structBitLength);
+	m_pusher.push(0, "ENDC");
+	m_pusher.push(0, "CTOS");
+	m_pusher.endContinuation();
+	if (isInRef) {
+		m_pusher.ifElse();
+	} else {
+		m_pusher._ifNot();
+	}
+	m_pusher.endOpaque(3, 1);
+	// value lValue... index dict slice
+
+	if (offset > 0) {
+		m_pusher.push(-1 + 2, "LDSLICE " + toString(offset)); // value lValue... index dict prefix slice
+	}
+	if (op == Token::Assign) {
+		m_pusher.pushInt(memberBitLength);
+		m_pusher.push(-2 + 1, "SDSKIPFIRST"); // value lValue... index dict [prefix] rest
+		if (isCurrentResultNeeded()) {
+			m_pusher.pushS(m_pusher.stackSize() - saveStackSize);
+		} else {
+			m_pusher.blockSwap(1, m_pusher.stackSize() - saveStackSize);
+		}
+		// [value] lValue... index dict [prefix] rest value
+	} else {
+		m_pusher.load(memberType, true); // value lValue... index dict [prefix] rest oldValue
+		m_pusher.blockSwap(1, m_pusher.stackSize() - saveStackSize);
+		// lValue... index dict [prefix] rest oldValue value
+		visitMathBinaryOperation(TokenTraits::AssignmentToBinaryOp(op), memberType, nullptr, nullopt);
+		// lValue... index dict [prefix] rest newValue
+	}
+
+	if (offset > 0) {
+		m_pusher.rot(); // ... rest newValue prefix
+		m_pusher.push(+1, "NEWC");
+		m_pusher.push(-2 + 1, "STSLICE"); // ... rest newValue builder
+	} else {
+		m_pusher.push(+1, "NEWC"); // ... rest newValue builder
+	}
+	m_pusher.store(memberType, false); // ... rest builder
+	m_pusher.push(-2 + 1, "STSLICE"); // ... index dict builder
+	if (isInRef) {
+		m_pusher.push(0, "ENDC");
+	}
+	m_pusher.rotRev(); // ... builder index dict
+	m_pusher.setDict(*keyType, *valueType, isInRef ? DataType::Cell : DataType::Builder); // ... dict'
+
+	lValueInfo.expressions.pop_back();
+	collectLValue(lValueInfo, true, false);
+	return true;
+}
+
 bool TVMExpressionCompiler::tryAssignLValue(Assignment const &_assignment) {
 	const auto& lhs = _assignment.leftHandSide();
 	const auto& rhs = _assignment.rightHandSide();
@@ -1366,6 +1620,7 @@ void TVMExpressionCompiler::visit2(Assignment const &_assignment) {
 		cast_error(_assignment, "Unsupported operation.");
 	}
 	if (tryAssignTuple(_assignment) ||
+	    tryAssignMappingStructMember(_assignment) ||
 	    tryAssignLValue(_assignment))  {
 		return;
 	}
@@ -1376,7 +1631,11 @@ void TVMExpressionCompiler::visit2(Assignment const &_assignment) {
 bool TVMExpressionCompiler::fold_constants(const Expression *expr) {
 	const auto& val = constValue(*expr);
 	if (val.has_value()) {
-		m_pusher.push(+1, "PUSHINT " + val.value().str());
+		if (std::optional<int> offset = m_pusher.getStack().getConstantOffset(val.value())) {
+			m_pusher.pushS(*offset);
+		} else {
+			m_pusher.push(+1, "PUSHINT " + val.value().str());
+		}
 		return true;
 	}
 
@@ -38,6 +38,8 @@ public:
 			Type const* rightType
 	);
 	void collectLValue(const LValueInfo &lValueInfo, bool haveValueOnStackTop, bool isValueBuilder);
+	// stack: BldrList builder -> BldrList builder
+	void appendToStringBuilders(Expression const* str, Type const* strType);
 
 protected:
 	bool acceptExpr(const Expression* expr);
@@ -66,6 +68,7 @@ protected:
 		const std::function<void()>& pushRight,
 		const Token op
 	);
+	void concatenateStrings(std::vector<Expression const*> const& parts, Type const* commonType);
 	void visitLogicalShortCircuiting(BinaryOperation const &_binaryOperation);
 	void visit2(BinaryOperation const& _node);
 	static bool isCheckFitUseless(Type const* type, Token op);
@@ -84,11 +87,15 @@ protected:
 	static void indexTypeCheck(IndexAccess const& _node);
 	void visit2(IndexRangeAccess const& indexRangeAccess);
 	void visit2(IndexAccess const& indexAccess);
+	bool isTupleArray(Expression const& _expr);
+	static std::optional<int> constTupleArrayIndex(IndexAccess const& indexAccess);
+	std::optional<int> pushTupleArrayIndex(IndexAccess const& indexAccess);
 	void visit2(FunctionCall const& _functionCall);
 	void visit2(Conditional const& _conditional);
 	bool fold_constants(const Expression *expr);
 	static bool isOptionalGet(Expression const* expr);
 
+	bool tryAssignMappingStructMember(Assignment const& _assignment);
 	bool tryAssignLValue(Assignment const& _assignment);
 	bool tryAssignTuple(Assignment const& _assignment);
 	void visit2(Assignment const& _assignment);
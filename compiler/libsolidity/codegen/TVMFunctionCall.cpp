@@ -365,27 +365,49 @@ bool FunctionCallCompiler::libraryCall(MemberAccess const& ma) {
 
 std::function<void()> FunctionCallCompiler::generateDataSection(
 	const std::function<void()>& pushKey,
+	Expression const* pubkey,
 	bool & hasVars,
 	Expression const* vars,
 	bool & isNew,
 	const ASTPointer<Expression const>& contr
 ) {
-	return [pushKey, this, hasVars, vars, isNew, contr]() {
-		// creat dict with variable values
-		m_pusher.push(+1, "NEWDICT");
-		// stake: builder dict
-
+	return [pushKey, pubkey, this, hasVars, vars, isNew, contr]() {
 		IntegerType keyType = getKeyTypeOfC4();
 		TypePointer valueType = TypeProvider::uint256();
 
-		pushKey();
-		const DataType& dataType = m_pusher.prepareValueForDictOperations(&keyType, valueType, false);
-		m_pusher.pushInt(0); // index of pubkey
-		// stack: dict value key
-		m_pusher.rot();
-		// stack: value key dict
-		m_pusher.setDict(getKeyTypeOfC4(), *valueType, dataType);
-		// stack: dict'
+		std::optional<bigint> pubkeyValue = pubkey == nullptr ? bigint{0} : TVMExpressionCompiler::constValue(*pubkey);
+		if (pubkeyValue.has_value() && 0 <= *pubkeyValue && *pubkeyValue < (bigint(1) << 256)) {
+			// The dictionary with only one key (the index of pubkey) is built at compile time.
+			// Root of the dictionary: label hml_same$11 v:0 n:KeyLength and pubkey as the value
+			int lengthBitQty = 0;
+			while ((1 << lengthBitQty) <= TvmConst::C4::KeyLength) {
+				++lengthBitQty;
+			}
+			std::string root = "110";
+			StackPusher::addBinaryNumberToString(root, TvmConst::C4::KeyLength, lengthBitQty);
+			StackPusher::addBinaryNumberToString(root, *pubkeyValue);
+			if (!hasVars) {
+				// data: dict is not empty, so it's stored as bit '1' and ref to the root
+				auto rootCell = createNode<PushCellOrSlice>(PushCellOrSlice::Type::CELL, ".blob x" + StackPusher::binaryStringToSlice(root), nullptr);
+				m_pusher.pushCellOrSlice(createNode<PushCellOrSlice>(PushCellOrSlice::Type::PUSHREF, ".blob xc_", rootCell));
+				return;
+			}
+			m_pusher.pushCellOrSlice(createNode<PushCellOrSlice>(PushCellOrSlice::Type::PUSHREF, ".blob x" + StackPusher::binaryStringToSlice(root), nullptr));
+			// stack: dict
+		} else {
+			// creat dict with variable values
+			m_pusher.push(+1, "NEWDICT");
+			// stake: builder dict
+
+			pushKey();
+			const DataType& dataType = m_pusher.prepareValueForDictOperations(&keyType, valueType, false);
+			m_pusher.pushInt(0); // index of pubkey
+			// stack: dict value key
+			m_pusher.rot();
+			// stack: value key dict
+			m_pusher.setDict(getKeyTypeOfC4(), *valueType, dataType);
+			// stack: dict'
+		}
 		if (hasVars) {
 			const Type * type;
 			if (!isNew) {
@@ -398,10 +420,8 @@ std::function<void()> FunctionCallCompiler::generateDataSection(
 				type = newExpr->typeName().annotation().type;
 			}
 			auto ct = dynamic_cast<const ContractType*>(type);
-			std::vector<PragmaDirective const *> _pragmaDirectives;
-			PragmaDirectiveHelper pragmaHelper{_pragmaDirectives};
-			TVMCompilerContext cc{&ct->contractDefinition(), pragmaHelper};
-			std::vector<std::pair<VariableDeclaration const*, int>> staticVars = cc.getStaticVariables();
+			std::vector<std::pair<VariableDeclaration const*, int>> staticVars =
+				TVMCompilerContext::getStaticVariables(&ct->contractDefinition());
 			auto getDeclAndIndex = [&](const std::string& name) {
 				auto pos = find_if(staticVars.begin(), staticVars.end(), [&](auto v) { return v.first->name() == name; });
 				solAssert(pos != staticVars.end(), "");
@@ -1107,7 +1127,9 @@ bool FunctionCallCompiler::checkForTvmDeployMethods(MemberAccess const &_node, T
 					}
 				};
 				hasVars = (varArg != -1);
-				exprs[StateInitMembers::Data] = generateDataSection(pushKey, hasVars,
+				exprs[StateInitMembers::Data] = generateDataSection(pushKey,
+																	keyArg == -1 ? nullptr : m_arguments[keyArg].get(),
+																	hasVars,
 																	hasVars ? m_arguments[varArg].get() : nullptr,
 																	isNew,
 																	hasVars ? m_arguments[contrArg] : nullptr);
@@ -1695,8 +1717,10 @@ bool FunctionCallCompiler::checkForOptionalMethods(MemberAccess const &_node) {
 
 	if (_node.memberName() == "get") {
 		acceptExpr(&_node.expression());
-		m_pusher.pushS(0);
-		m_pusher.checkOptionalValue();
+		if (!m_pusher.ctx().isOptionalGetWithValue(&m_functionCall)) {
+			m_pusher.pushS(0);
+			m_pusher.checkOptionalValue();
+		}
 		if (auto tt = to<TupleType>(m_retType)) {
 			m_pusher.untuple(tt->components().size());
 		} else if (optValueAsTuple(m_retType)) {
@@ -1747,107 +1771,140 @@ void FunctionCallCompiler::cellMethods(MemberAccess const &_node) {
 	}
 }
 
-void FunctionCallCompiler::addressMethod() {
+void FunctionCallCompiler::transferParams(
+	std::map<int, Expression const *>& exprs,
+	std::map<int, std::string>& constParams,
+	std::function<void(int)>& appendBody,
+	std::function<void()>& pushSendrawmsgFlag,
+	std::function<void()>& appendStateInit
+) {
 	auto _node = to<MemberAccess>(&m_functionCall.expression());
 	const std::vector<ASTPointer<ASTString>>& names = m_functionCall.names();
-	if (_node->memberName() == "transfer") { // addr.transfer(...)
-		std::map<int, Expression const *> exprs;
-		std::map<int, std::string> constParams{{TvmConst::int_msg_info::ihr_disabled, "1"}, {TvmConst::int_msg_info::bounce, "1"}};
-		std::function<void(int)> appendBody;
-		std::function<void()> pushSendrawmsgFlag;
-		std::function<void()> appendStateInit;
+	constParams = {{TvmConst::int_msg_info::ihr_disabled, "1"}, {TvmConst::int_msg_info::bounce, "1"}};
 
-		auto setValue = [&](Expression const* expr) {
-			const auto& value = TVMExpressionCompiler::constValue(*expr);
-			if (value.has_value()) {
-				constParams[TvmConst::int_msg_info::tons] = StackPusher::tonsToBinaryString(u256(value.value()));
-			} else {
-				exprs[TvmConst::int_msg_info::tons] = expr;
-			}
-		};
+	auto setValue = [&](Expression const* expr) {
+		const auto& value = TVMExpressionCompiler::constValue(*expr);
+		if (value.has_value()) {
+			constParams[TvmConst::int_msg_info::tons] = StackPusher::tonsToBinaryString(u256(value.value()));
+		} else {
+			exprs[TvmConst::int_msg_info::tons] = expr;
+		}
+	};
 
-		auto setBounce = [&](auto expr){
-			const std::optional<bool> value = TVMExpressionCompiler::constBool(*expr);
-			if (value.has_value()) {
-				constParams[TvmConst::int_msg_info::bounce] = value.value() ? "1" : "0";
-			} else {
-				exprs[TvmConst::int_msg_info::bounce] = expr;
-				constParams.erase(TvmConst::int_msg_info::bounce);
-			}
-		};
+	auto setBounce = [&](auto expr){
+		const std::optional<bool> value = TVMExpressionCompiler::constBool(*expr);
+		if (value.has_value()) {
+			constParams[TvmConst::int_msg_info::bounce] = value.value() ? "1" : "0";
+		} else {
+			exprs[TvmConst::int_msg_info::bounce] = expr;
+			constParams.erase(TvmConst::int_msg_info::bounce);
+		}
+	};
 
-		auto setAppendStateInit = [&](Expression const* expr) {
-			appendStateInit = [expr, this](){
-				// Either StateInit ^StateInit
-				m_pusher.push(-1 + 1, "STONE"); // ^StateInit
-				acceptExpr(expr);
-				m_pusher.push(-2 + 1, "STREFR");
-			};
+	auto setAppendStateInit = [&](Expression const* expr) {
+		appendStateInit = [expr, this](){
+			// Either StateInit ^StateInit
+			m_pusher.push(-1 + 1, "STONE"); // ^StateInit
+			acceptExpr(expr);
+			m_pusher.push(-2 + 1, "STREFR");
 		};
+	};
 
-		exprs[TvmConst::int_msg_info::dest] = &_node->expression();
+	exprs[TvmConst::int_msg_info::dest] = &_node->expression();
 
-		int argumentQty = static_cast<int>(m_arguments.size());
-		if (!m_functionCall.names().empty() || argumentQty == 0) {
-			// string("value"), string("bounce"), string("flag"), string("body"), string("currencies")
-			for (int arg = 0; arg < argumentQty; ++arg) {
-				switch (str2int(names[arg]->c_str())) {
-					case str2int("value"):
-						setValue(m_arguments[arg].get());
-						break;
-					case str2int("bounce"):
-						setBounce(m_arguments[arg].get());
-						break;
-					case str2int("flag"):
-						pushSendrawmsgFlag = [e = m_arguments[arg], this](){
-							acceptExpr(e.get());
-						};
-						break;
-					case str2int("body"):
-						appendBody = [e = m_arguments[arg], this](int /*size*/){
-							m_pusher.stones(1);
-							acceptExpr(e.get());
-							m_pusher.push(-1, "STREFR");
-							return false;
-						};
-						break;
-					case str2int("currencies"):
-						exprs[TvmConst::int_msg_info::currency] = m_arguments[arg].get();
-						break;
-					case str2int("stateInit"):
-						setAppendStateInit(m_arguments[arg].get());
-						break;
-					default:
-						solUnimplemented("");
-				}
+	int argumentQty = static_cast<int>(m_arguments.size());
+	if (!m_functionCall.names().empty() || argumentQty == 0) {
+		// string("value"), string("bounce"), string("flag"), string("body"), string("currencies")
+		for (int arg = 0; arg < argumentQty; ++arg) {
+			switch (str2int(names[arg]->c_str())) {
+				case str2int("value"):
+					setValue(m_arguments[arg].get());
+					break;
+				case str2int("bounce"):
+					setBounce(m_arguments[arg].get());
+					break;
+				case str2int("flag"):
+					pushSendrawmsgFlag = [e = m_arguments[arg], this](){
+						acceptExpr(e.get());
+					};
+					break;
+				case str2int("body"):
+					appendBody = [e = m_arguments[arg], this](int /*size*/){
+						m_pusher.stones(1);
+						acceptExpr(e.get());
+						m_pusher.push(-1, "STREFR");
+						return false;
+					};
+					break;
+				case str2int("currencies"):
+					exprs[TvmConst::int_msg_info::currency] = m_arguments[arg].get();
+					break;
+				case str2int("stateInit"):
+					setAppendStateInit(m_arguments[arg].get());
+					break;
+				default:
+					solUnimplemented("");
 			}
+		}
+	} else {
+		solAssert(1 <= argumentQty && argumentQty <= 6, "");
+		setValue(m_arguments[0].get());
+		if (argumentQty >= 2) {
+			setBounce(m_arguments[1].get());
+		}
+		if (argumentQty >= 3) {
+			pushSendrawmsgFlag = [this]() {
+				pushArgAndConvert(2);
+			};
+		}
+		if (argumentQty >= 4) {
+			appendBody = [this](int /*size*/) {
+				m_pusher.stones(1);
+				pushArgAndConvert(3);
+				m_pusher.push(-1, "STREFR");
+				return false;
+			};
+		}
+		if (argumentQty >= 5) {
+			exprs[TvmConst::int_msg_info::currency] = m_arguments[4].get();
+		}
+		if (argumentQty >= 6) {
+			setAppendStateInit(m_arguments.at(5).get());
+		}
+	}
+}
+
+void FunctionCallCompiler::pushTransferTail() {
+	std::map<int, Expression const *> exprs;
+	std::map<int, std::string> constParams;
+	std::function<void(int)> appendBody;
+	std::function<void()> pushSendrawmsgFlag;
+	std::function<void()> appendStateInit;
+	transferParams(exprs, constParams, appendBody, pushSendrawmsgFlag, appendStateInit);
+
+	std::set<int> isParamOnStack;
+	if (exprs.count(TvmConst::int_msg_info::currency)) {
+		isParamOnStack.insert(TvmConst::int_msg_info::currency);
+		acceptExpr(exprs.at(TvmConst::int_msg_info::currency));
+	}
+	m_pusher.pushIntMsgTail(isParamOnStack, constParams, appendBody, appendStateInit);
+}
+
+void FunctionCallCompiler::addressMethod() {
+	auto _node = to<MemberAccess>(&m_functionCall.expression());
+	if (_node->memberName() == "transfer") { // addr.transfer(...)
+		std::map<int, Expression const *> exprs;
+		std::map<int, std::string> constParams;
+		std::function<void(int)> appendBody;
+		std::function<void()> pushSendrawmsgFlag;
+		std::function<void()> appendStateInit;
+		transferParams(exprs, constParams, appendBody, pushSendrawmsgFlag, appendStateInit);
+		if (m_pusher.getStack().getMessageTailOffset(&m_functionCall).has_value()) {
+			exprs.erase(TvmConst::int_msg_info::currency);
+			m_pusher.sendIntMsgWithTail(exprs, constParams, &m_functionCall, pushSendrawmsgFlag);
 		} else {
-			solAssert(1 <= argumentQty && argumentQty <= 6, "");
-			setValue(m_arguments[0].get());
-			if (argumentQty >= 2) {
-				setBounce(m_arguments[1].get());
-			}
-			if (argumentQty >= 3) {
-				pushSendrawmsgFlag = [&]() {
-					pushArgAndConvert(2);
-				};
-			}
-			if (argumentQty >= 4) {
-				appendBody = [&](int /*size*/) {
-					m_pusher.stones(1);
-					pushArgAndConvert(3);
-					m_pusher.push(-1, "STREFR");
-					return false;
-				};
-			}
-			if (argumentQty >= 5) {
-				exprs[TvmConst::int_msg_info::currency] = m_arguments[4].get();
-			}
-			if (argumentQty >= 6) {
-				setAppendStateInit(m_arguments.at(5).get());
-			}
+			m_pusher.sendIntMsg(exprs, constParams, appendBody, pushSendrawmsgFlag, false, 0, appendStateInit);
 		}
-		m_pusher.sendIntMsg(exprs, constParams, appendBody, pushSendrawmsgFlag, false, 0, appendStateInit);
 	} else if (_node->memberName() == "isStdZero") {
 		acceptExpr(&_node->expression());
 		m_pusher.pushZeroAddress();
@@ -2806,25 +2863,37 @@ bool FunctionCallCompiler::checkSolidityUnits() {
 				formatStr = formatStr.substr(close_pos + 1);
 				pos = 0;
 			}
+			// arguments known at compile time are rendered into the string literal
+			std::vector<std::optional<std::string>> constArgs;
+			bool isConstResult = true;
+			std::string result;
+			for (size_t it = 0; it < substrings.size(); it++) {
+				constArgs.emplace_back(formatConstantArgument(*m_arguments[it + 1], substrings[it].second));
+				isConstResult &= constArgs.back().has_value();
+				if (isConstResult) {
+					result += substrings[it].first + *constArgs.back();
+				}
+			}
+			if (isConstResult) {
+				m_pusher.pushString(result + formatStr, false);
+				return true;
+			}
+
 			// create new vector(TvmBuilder)
 			m_pusher.pushDefaultValue(TypeProvider::tvmtuple(TypeProvider::tvmbuilder()));
 			// create new builder to store data in it
 			m_pusher.push(+1, "NEWC");
 
-			auto pushConstStr = [&](const string& constStr) {
-				if (!constStr.empty()) {
-					size_t maxSlice = TvmConst::CellBitLength / 8;
-					for(size_t i = 0; i  < constStr.length(); i += maxSlice) {
-						m_pusher.pushString(constStr.substr(i, min(maxSlice, constStr.length() - i)), true);
-						// stack: BldrList builder Slice
-						m_pusher.pushMacroCallInCallRef(3, 2, "storeStringInBuilders_macro");
-					}
-					// stack: BldrList builder
-				}
-			};
+			std::string constStr;
 			for (size_t it = 0; it < substrings.size(); it++) {
 				// stack: vector(TvmBuilder) builder
-				pushConstStr(substrings[it].first);
+				constStr += substrings[it].first;
+				if (constArgs[it].has_value()) {
+					constStr += *constArgs[it];
+					continue;
+				}
+				m_pusher.appendStringToBuilders(constStr);
+				constStr.clear();
 
 				Type::Category cat = m_arguments[it + 1]->annotation().type->category();
 				Type const *argType = m_arguments[it + 1]->annotation().type;
@@ -2898,7 +2967,7 @@ bool FunctionCallCompiler::checkSolidityUnits() {
 					cast_error(*m_arguments[it + 1].get(), "Unsupported argument type");
 				}
 			}
-			pushConstStr(formatStr);
+			m_pusher.appendStringToBuilders(constStr + formatStr);
 
 			m_pusher.pushMacroCallInCallRef(2, 1, "assembleList_macro");
 			return true;
@@ -2914,6 +2983,53 @@ bool FunctionCallCompiler::checkSolidityUnits() {
 	return false;
 }
 
+std::optional<std::string> FunctionCallCompiler::formatConstantArgument(Expression const& arg, std::string format) {
+	Type const* argType = arg.annotation().type;
+	if (argType->category() == Type::Category::StringLiteral) {
+		if (auto literal = to<Literal>(&arg)) {
+			return literal->value();
+		}
+		return {};
+	}
+	if (argType->category() != Type::Category::Integer && argType->category() != Type::Category::RationalNumber) {
+		return {};
+	}
+	std::optional<bigint> value = TVMExpressionCompiler::constValue(arg);
+	bool isTon = !format.empty() && format.back() == 't';
+	if (!value.has_value() || isTon) {
+		return {};
+	}
+
+	// the same rules as in convertIntToDecStr_macro and convertIntToHexStr_macro
+	bool leadingZeroes = !format.empty() && (format[0] == '0');
+	bool isHex = !format.empty() && (format.back() == 'x' || format.back() == 'X');
+	bool isLower = isHex && (format.back() == 'x');
+	while (!format.empty() && (format.back() < '0' || format.back() > '9')) {
+		format.erase(format.size() - 1, 1);
+	}
+	size_t width = format.empty() ? 0 : std::stoi(format);
+
+	const int base = isHex ? 16 : 10;
+	const std::string symbols = isLower ? "0123456789abcdef" : "0123456789ABCDEF";
+	std::string digits;
+	bigint number = *value < 0 ? -*value : *value;
+	do {
+		digits += symbols.at(static_cast<size_t>(number % base));
+		number /= base;
+	} while (number != 0);
+	std::reverse(digits.begin(), digits.end());
+
+	std::string str = *value < 0 ? "-" : "";
+	if (width != 0) {
+		if (width < digits.size() || width > 127) {
+			// it throws an exception at runtime
+			return {};
+		}
+		str += std::string(width - digits.size(), leadingZeroes ? '0' : ' ');
+	}
+	return str + digits;
+}
+
 bool FunctionCallCompiler::checkLocalFunctionOrLibCallOrFuncVarCall() {
 	auto expr = &m_functionCall.expression();
 	if (auto identifier = to<Identifier>(expr); identifier && checkLocalFunctionOrLibCall(identifier)) {
@@ -2977,7 +3093,7 @@ bool FunctionCallCompiler::createNewContract() {
 		bool hasVars = varInit != nullptr;
 		bool isNew = true;
 		stateInitExprs[StateInitMembers::Data] = generateDataSection(
-			pushKey, hasVars,
+			pushKey, findOption("pubkey"), hasVars,
 			hasVars ? varInit : nullptr,
 			isNew,
 			nullptr
@@ -35,6 +35,7 @@ public:
 	);
 	void structConstructorCall();
 	void compile();
+	void pushTransferTail();
 
 protected:
 	bool checkForMappingOrCurrenciesMethods();
@@ -56,6 +57,13 @@ protected:
 	bool checkForTvmBuilderMethods(MemberAccess const& _node, Type::Category category);
 	bool checkForTvmVectorMethods(MemberAccess const& _node, Type::Category category);
 	void cellMethods(MemberAccess const& _node);
+	void transferParams(
+		std::map<int, Expression const *>& exprs,
+		std::map<int, std::string>& constParams,
+		std::function<void(int)>& appendBody,
+		std::function<void()>& pushSendrawmsgFlag,
+		std::function<void()>& appendStateInit
+	);
 	void addressMethod();
 	bool checkForTvmConfigParamFunction(MemberAccess const& _node);
 	bool checkForTvmSendFunction(MemberAccess const& _node);
@@ -91,6 +99,7 @@ protected:
 	void buildStateInit(std::map<StateInitMembers, std::function<void()>> exprs);
 	std::function<void()> generateDataSection(
 		const std::function<void()>& pushKey,
+		Expression const* pubkey,
 		bool &hasVars,
 		Expression const* vars,
 		bool &isNew,
@@ -100,6 +109,7 @@ protected:
 	void checkExtMsgSend();
 	std::string getDefaultMsgValue();
 	static const FunctionDefinition* getRemoteFunctionDefinition(const MemberAccess* memberAccess);
+	static std::optional<std::string> formatConstantArgument(Expression const& arg, std::string format);
 	void generateExtInboundMsg(
 		bool addSignature,
 		const Expression * destination,
@@ -18,17 +18,19 @@
 
 #include <boost/algorithm/string/replace.hpp>
 
-#include <liblangutil/SourceReferenceExtractor.h>
+#include <liblangutil/CharStream.h>
+#include <libsolidity/ast/TypeProvider.h>
 
 #include "DictOperations.hpp"
 #include "TVMABI.hpp"
 #include "TVMAnalyzer.hpp"
 #include "TVMExpressionCompiler.hpp"
+#include "TVMFunctionCall.hpp"
 #include "TVMFunctionCompiler.hpp"
+#include "TVMStructCompiler.hpp"
 #include "TVMConstants.hpp"
 
 using namespace solidity::frontend;
-namespace fs = boost::filesystem;
 
 
 ContInfo getInfo(const Statement &statement) {
@@ -172,10 +174,13 @@ TVMFunctionCompiler::generateC4ToC7WithInitMemory(StackPusher& pusher) {
 			++varQty;
 		}
 	}
-	int shift = 0;
-	for (VariableDeclaration const* v : pusher.ctx().notConstantStateVariables()) {
+	std::map<VariableDeclaration const*, int> staticVarKeys;
+	for (const auto& [v, key] : pusher.ctx().getStaticVariables()) {
+		staticVarKeys[v] = key;
+	}
+	for (VariableDeclaration const* v : pusher.ctx().storageLayout()) {
 		if (v->isStatic()) {
-			pusher.pushInt(TvmConst::C4::PersistenceMembersStartIndex + shift++); // dict vars... index dict
+			pusher.pushInt(staticVarKeys.at(v)); // dict vars... index dict
 			pusher.pushS(1 + (tooMuchStateVars ? varQty : 0)); // dict vars... index dict
 			pusher.getDict(getKeyTypeOfC4(), *v->type(), GetDictOperation::GetFromMapping);
 		} else {
@@ -313,6 +318,13 @@ TVMFunctionCompiler::generatePublicFunction(StackPusher& pusher, FunctionDefinit
 		pusher.setGlob(TvmConst::C7::ReturnParams); // slice
 		solAssert(saveStakeSize == pusher.stackSize(), "");
 	}
+	// checks that don't use function parameters are done before decoding, so failed calls don't pay for it
+	const int checkQty = ::checkQtyBeforeParamDecoding(*function, pusher.ctx().usage());
+	for (int i = 0; i < checkQty; ++i) {
+		Statement const& check = *function->body().statements().at(i);
+		funCompiler.pushLocation(check);
+		check.accept(funCompiler);
+	}
 	funCompiler.decodeFunctionParams(isResponsible);
     funCompiler.pushLocation(*function, true);
 
@@ -572,10 +584,11 @@ void TVMFunctionCompiler::visitModifierOrFunctionBlock(Block const &body, int ar
 	if (m_currentModifier == static_cast<int>(m_function->modifiers().size()) && withPrelocatedRetValues(m_function)) {
 		pushDefaultParameters(m_function->returnParameters());
 	}
+	pushCachedStateVariables();
 	acceptBody(body, {{argQty, nameRetQty}});
 	if (locationReturn == LocationReturn::Last) {
-        m_pusher.pollLastRetOpcode();
-    }
+		m_pusher.pollLastRetOpcode();
+	}
 	if (doPushContinuation) {
 		pushLocation(*m_function);
 		if (m_isLibraryWithObj && m_currentModifier == static_cast<int>(m_function->modifiers().size())) {
@@ -583,7 +596,7 @@ void TVMFunctionCompiler::visitModifierOrFunctionBlock(Block const &body, int ar
 			solAssert(argQty > 0, "");
 		}
 		m_pusher.callX(argQty, retQty);
-        pushLocation(*m_function, true);
+		pushLocation(*m_function, true);
 	}
 }
 
@@ -689,6 +702,121 @@ void TVMFunctionCompiler::pushDefaultParameters(const ast_vec<VariableDeclaratio
 	}
 }
 
+void TVMFunctionCompiler::pushCachedStateVariables() {
+	if (m_currentModifier != static_cast<int>(functionModifiers().size()) ||
+		!functionModifiers().empty() ||
+		m_isLibraryWithObj ||
+		m_function->isConstructor()
+	) {
+		return;
+	}
+	StateVariableCacheScanner scanner{*m_function};
+	for (VariableDeclaration const* vd : scanner.cachedVariables()) {
+		m_pusher.getGlob(vd);
+		m_pusher.getStack().add(vd, false);
+		if (scanner.isWritten(vd)) {
+			m_writtenCachedStateVariables.push_back(vd);
+		}
+	}
+}
+
+void TVMFunctionCompiler::saveCachedStateVariables() {
+	for (VariableDeclaration const* vd : m_writtenCachedStateVariables) {
+		m_pusher.pushS(m_pusher.getStack().getOffset(vd));
+		m_pusher.setGlob(vd);
+	}
+}
+
+std::vector<bigint> TVMFunctionCompiler::pushLoopInvariantConstants(std::vector<ASTNode const*> const& loopParts) {
+	std::vector<bigint> hoistedConstants;
+	LoopInvariantConstantScanner scanner{loopParts};
+	for (bigint const& value : scanner.constants()) {
+		if (!m_pusher.getStack().getConstantOffset(value).has_value()) {
+			m_pusher.push(+1, "PUSHINT " + value.str());
+			m_pusher.getStack().addConstant(value);
+			hoistedConstants.push_back(value);
+		}
+	}
+	return hoistedConstants;
+}
+
+void TVMFunctionCompiler::dropLoopInvariantConstants(std::vector<bigint> const& hoistedConstants) {
+	for (bigint const& value : hoistedConstants) {
+		m_pusher.getStack().removeConstant(value);
+	}
+	m_pusher.drop(hoistedConstants.size());
+}
+
+std::vector<FunctionCall const*> TVMFunctionCompiler::pushMessageTails(std::vector<ASTNode const*> const& loopParts, Statement const* loopVarDecl) {
+	std::vector<FunctionCall const*> messages;
+	MessageTailScanner scanner{loopParts, loopVarDecl};
+	for (FunctionCall const* call : scanner.messages()) {
+		// the arguments must be on the stack before the loop
+		std::vector<Expression const*> const args = MessageTailScanner::transferTailArguments(*call);
+		bool const isOnStack = std::all_of(args.begin(), args.end(), [&](Expression const* arg) {
+			auto vd = to<VariableDeclaration>(to<Identifier>(arg)->annotation().referencedDeclaration);
+			return m_pusher.getStack().isParam(vd);
+		});
+		if (isOnStack && !m_pusher.getStack().getMessageTailOffset(call).has_value()) {
+			TVMExpressionCompiler ec{m_pusher};
+			FunctionCallCompiler{m_pusher, &ec, *call, true}.pushTransferTail();
+			m_pusher.getStack().addMessageTail(call);
+			messages.push_back(call);
+		}
+	}
+	return messages;
+}
+
+void TVMFunctionCompiler::dropMessageTails(std::vector<FunctionCall const*> const& messages) {
+	for (FunctionCall const* call : messages) {
+		m_pusher.getStack().removeMessageTail(call);
+	}
+	m_pusher.drop(messages.size());
+}
+
+std::vector<VariableDeclaration const*> TVMFunctionCompiler::pushStringBuilders(std::vector<ASTNode const*> const& loopParts) {
+	std::vector<VariableDeclaration const*> stringBuilders;
+	StringAppendScanner scanner{loopParts};
+	for (VariableDeclaration const* vd : scanner.variables()) {
+		if (!m_pusher.getStack().isParam(vd) || m_stringBuilders.count(vd)) {
+			continue;
+		}
+		m_pusher.pushDefaultValue(TypeProvider::tvmtuple(TypeProvider::tvmbuilder()));
+		m_pusher.push(+1, "NEWC");
+		m_pusher.pushS(m_pusher.getStack().getOffset(vd));
+		m_pusher.appendStringToBuilders();
+		// stack: BldrList builder
+		m_stringBuilders[vd] = m_pusher.stackSize() - 1;
+		stringBuilders.push_back(vd);
+	}
+	return stringBuilders;
+}
+
+void TVMFunctionCompiler::assembleStringBuilders(std::vector<VariableDeclaration const*> const& stringBuilders) {
+	for (VariableDeclaration const* vd : stringBuilders | boost::adaptors::reversed) {
+		solAssert(m_stringBuilders.at(vd) == m_pusher.stackSize() - 1, "");
+		m_stringBuilders.erase(vd);
+		m_pusher.pushMacroCallInCallRef(2, 1, "assembleList_macro");
+		m_pusher.popS(m_pusher.getStack().getOffset(vd));
+	}
+}
+
+bool TVMFunctionCompiler::tryAppendToStringBuilder(ExpressionStatement const& _statement) {
+	std::optional<std::pair<VariableDeclaration const*, Expression const*>> append = StringAppendScanner::stringAppend(_statement);
+	if (!append || !m_stringBuilders.count(append->first)) {
+		return false;
+	}
+	auto [vd, tail] = *append;
+	const int builderPos = m_stringBuilders.at(vd);
+	m_pusher.pushS(m_pusher.getStack().getOffset(builderPos - 1));
+	m_pusher.pushS(m_pusher.getStack().getOffset(builderPos));
+	TVMExpressionCompiler{m_pusher}.appendToStringBuilders(tail, vd->type());
+	// stack: ... BldrList builder ... BldrList' builder'
+	m_pusher.popS(m_pusher.getStack().getOffset(builderPos));
+	m_pusher.popS(m_pusher.getStack().getOffset(builderPos - 1));
+	return true;
+}
+
 void TVMFunctionCompiler::acceptExpr(const Expression *expr, const bool isResultNeeded) {
 	solAssert(expr, "");
 	TVMExpressionCompiler(m_pusher).acceptExpr(expr, isResultNeeded);
@@ -714,7 +842,16 @@ bool TVMFunctionCompiler::visit(VariableDeclarationStatement const &_variableDec
 
 	if (auto init = _variableDeclarationStatement.initialValue()) {
 		auto tupleExpression = to<TupleExpression>(init);
-		if (tupleExpression && !tupleExpression->isInlineArray()) {
+		if (n == 1 && decls.at(0) != nullptr && m_pusher.ctx().isTupleArray(decls.at(0).get())) {
+			// inline array is stored in tuple
+			Type const* baseType = to<ArrayType>(decls.at(0)->type())->baseType();
+			ast_vec<Expression> const& components = tupleExpression->components();
+			for (ASTPointer<Expression> const& component : components) {
+				acceptExpr(component.get());
+				m_pusher.hardConvert(baseType, component->annotation().type);
+			}
+			m_pusher.tuple(components.size());
+		} else if (tupleExpression && !tupleExpression->isInlineArray()) {
 			ast_vec<Expression> const&  tuple = tupleExpression->components();
 			for (std::size_t i = 0; i < tuple.size(); ++i) {
 				acceptExpr(tuple[i].get());
@@ -764,14 +901,24 @@ bool TVMFunctionCompiler::visit(VariableDeclarationStatement const &_variableDec
 void TVMFunctionCompiler::acceptBody(Block const& _block, std::optional<std::tuple<int, int>> functionBlock) {
 	const int startStackSize = m_pusher.stackSize();
 
-	for (const ASTPointer<Statement> &s: _block.statements()) {
-		pushLocation(*s.get());
-		s->accept(*this);
+	// these checks are done in the public function before decoding of parameters
+	const int skippedQty = functionBlock ? ::checkQtyBeforeParamDecoding(*m_function, m_pusher.ctx().usage()) : 0;
+	ast_vec<Statement> const& statements = _block.statements();
+	for (size_t i = skippedQty; i < statements.size(); ++i) {
+		pushLocation(*statements[i]);
+		if (i + 1 < statements.size() && tryFuseDictReadAndChange(*statements[i], *statements[i + 1])) {
+			++i;
+			continue;
+		}
+		statements[i]->accept(*this);
 	}
 
 	bool lastIsRet = !_block.statements().empty() && to<Return>(_block.statements().back().get()) != nullptr;
 
 	if (functionBlock) {
+		if (!lastIsRet) {
+			saveCachedStateVariables();
+		}
 		auto [argQty, nameRetQty] = functionBlock.value();
 		int funTrash = m_pusher.stackSize() - m_startStackSize - argQty - nameRetQty;
 		solAssert(funTrash >= 0, "");
@@ -799,6 +946,121 @@ void TVMFunctionCompiler::acceptBody(Block const& _block, std::optional<std::tup
 	pushLocation(_block, true);
 }
 
+bool TVMFunctionCompiler::tryFuseDictReadAndChange(Statement const& first, Statement const& second) {
+	// v = m[k]; delete m[k];  =>  DICTDELGET
+	// v = m[k]; m[k] = e;     =>  DICTSETGET
+	VariableDeclaration const* newVar{};
+	Declaration const* var{};
+	Type const* varType{};
+	Expression const* read{};
+	if (auto declStatement = to<VariableDeclarationStatement>(&first)) {
+		if (declStatement->declarations().size() != 1 || declStatement->declarations().at(0) == nullptr) {
+			return false;
+		}
+		newVar = declStatement->declarations().at(0).get();
+		var = newVar;
+		varType = newVar->type();
+		read = declStatement->initialValue();
+	} else if (auto exprStatement = to<ExpressionStatement>(&first)) {
+		auto assignment = to<Assignment>(&exprStatement->expression());
+		if (assignment == nullptr || assignment->assignmentOperator() != Token::Assign) {
+			return false;
+		}
+		auto id = to<Identifier>(&assignment->leftHandSide());
+		if (id == nullptr || !m_pusher.getStack().isParam(id->annotation().referencedDeclaration)) {
+			return false;
+		}
+		var = id->annotation().referencedDeclaration;
+		varType = id->annotation().type;
+		read = &assignment->rightHandSide();
+	} else {
+		return false;
+	}
+
+	auto readIndex = to<IndexAccess>(read);
+	if (readIndex == nullptr || readIndex->indexExpression() == nullptr) {
+		return false;
+	}
+	auto mapId = to<Identifier>(&readIndex->baseExpression());
+	auto keyId = to<Identifier>(readIndex->indexExpression());
+	if (mapId == nullptr || keyId == nullptr || mapId->annotation().type->category() != Type::Category::Mapping) {
+		return false;
+	}
+	Declaration const* map = mapId->annotation().referencedDeclaration;
+	Declaration const* key = keyId->annotation().referencedDeclaration;
+	if (var == map || var == key || to<VariableDeclaration>(key) == nullptr) {
+		return false;
+	}
+	auto isSameElement = [&](Expression const& e) {
+		auto index = to<IndexAccess>(&e);
+		if (index == nullptr || index->indexExpression() == nullptr) {
+			return false;
+		}
+		auto m = to<Identifier>(&index->baseExpression());
+		auto k = to<Identifier>(index->indexExpression());
+		return m && k && m->annotation().referencedDeclaration == map && k->annotation().referencedDeclaration == key;
+	};
+
+	auto exprStatement = to<ExpressionStatement>(&second);
+	if (exprStatement == nullptr) {
+		return false;
+	}
+	Expression const* newValue{};
+	if (auto op = to<UnaryOperation>(&exprStatement->expression())) {
+		if (op->getOperator() != Token::Delete || !isSameElement(op->subExpression())) {
+			return false;
+		}
+	} else if (auto assignment = to<Assignment>(&exprStatement->expression())) {
+		if (assignment->assignmentOperator() != Token::Assign || !isSameElement(assignment->leftHandSide())) {
+			return false;
+		}
+		newValue = &assignment->rightHandSide();
+		auto canRead = [&](VariableDeclaration const& vd) { return &vd != var && &vd != map; };
+		if (!::isSideEffectFree(*newValue, canRead)) {
+			return false;
+		}
+	} else {
+		return false;
+	}
+
+	Type const* keyType{};
+	Type const* valueType{};
+	std::tie(keyType, valueType) = dictKeyValue(mapId->annotation().type);
+
+	const int stackSize = m_pusher.stackSize();
+	TVMExpressionCompiler ec{m_pusher};
+	const LValueInfo lValueInfo = ec.expandLValue(&readIndex->baseExpression(), true, true, nullptr); // mapLValue... map
+	GetDictOperation op = GetDictOperation::GetAndDeleteFromMapping;
+	DataType dataType = DataType::Slice;
+	if (newValue) {
+		op = GetDictOperation::GetAndSetFromMapping;
+		acceptExpr(newValue); // mapLValue... map value
+		m_pusher.hardConvert(valueType, newValue->annotation().type);
+		dataType = m_pusher.prepareValueForDictOperations(keyType, valueType, false); // mapLValue... map value'
+	}
+	acceptExpr(readIndex->indexExpression()); // mapLValue... map [value'] key
+	m_pusher.hardConvert(keyType, readIndex->indexExpression()->annotation().type);
+	m_pusher.prepareKeyForDictOperations(keyType, false);
+	if (newValue) {
+		m_pusher.rot(); // mapLValue... value' key map
+	} else {
+		m_pusher.exchange(1); // mapLValue... key map
+	}
+	m_pusher.getDict(*keyType, *valueType, op, dataType); // mapLValue... map value
+
+	const int cntOfValuesOnStack = m_pusher.stackSize() - stackSize; // mapLValue... map value
+	m_pusher.blockSwap(cntOfValuesOnStack - 1, 1); // value mapLValue... map
+	ec.collectLValue(lValueInfo, true, false); // value
+	m_pusher.hardConvert(varType, valueType);
+	if (newVar) {
+		m_pusher.getStack().add(newVar, false);
+	} else {
+		m_pusher.tryAssignParam(var);
+	}
+	m_pusher.ensureSize(stackSize + (newVar ? 1 : 0), "tryFuseDictReadAndChange");
+	return true;
+}
+
 bool TVMFunctionCompiler::visit(Block const& _block) {
 	acceptBody(_block, std::nullopt);
 	return false;
@@ -808,7 +1070,9 @@ bool TVMFunctionCompiler::visit(ExpressionStatement const& _statement) {
 	if (!_statement.expression().annotation().isPure) {
 	    pushLocation(_statement);
 		auto savedStackSize = m_pusher.stackSize();
-		acceptExpr(&_statement.expression(), false);
+		if (!tryAppendToStringBuilder(_statement)) {
+			acceptExpr(&_statement.expression(), false);
+		}
 		m_pusher.ensureSize(savedStackSize, _statement.location().text());
         pushLocation(_statement, true);
 	}
@@ -1014,10 +1278,21 @@ void TVMFunctionCompiler::afterLoopCheck(const ContInfo& ci, const int& loopVarQ
 }
 
 bool TVMFunctionCompiler::visit(WhileStatement const &_whileStatement) {
+	std::vector<ASTNode const*> loopParts{&_whileStatement.body()};
+	if (_whileStatement.loopType() != WhileStatement::LoopType::REPEAT) {
+		loopParts.push_back(&_whileStatement.condition());
+	}
+	std::vector<VariableDeclaration const*> stringBuilders = pushStringBuilders(loopParts);
+	std::vector<bigint> hoistedConstants = pushLoopInvariantConstants(loopParts);
+	std::vector<FunctionCall const*> messageTails = pushMessageTails(loopParts);
+
 	int saveStackSizeForWhile = m_pusher.stackSize();
 
 	if (_whileStatement.loopType() == WhileStatement::LoopType::DO_WHILE) {
 		doWhile(_whileStatement);
+		dropMessageTails(messageTails);
+		dropLoopInvariantConstants(hoistedConstants);
+		assembleStringBuilders(stringBuilders);
 		return false;
 	}
 
@@ -1061,6 +1336,9 @@ bool TVMFunctionCompiler::visit(WhileStatement const &_whileStatement) {
 	afterLoopCheck(ci, 0);
 
 	m_pusher.ensureSize(saveStackSizeForWhile, "");
+	dropMessageTails(messageTails);
+	dropLoopInvariantConstants(hoistedConstants);
+	assembleStringBuilders(stringBuilders);
 
 	return false;
 }
@@ -1081,11 +1359,16 @@ bool TVMFunctionCompiler::visit(ForEachStatement const& _forStatement) {
 	// For mapping:
 	//
 	// dict
-	// public key (can be changed in solidity code)
-	// value
-	// private key (not visible in solidity code)
+	// key - as it's stored in the dict. It's the iteration variable if it isn't changed in solidity code.
+	// [public key] - optional. If the key is a struct or is changed in solidity code.
+	// [value] - optional. If the value is used in solidity code. It's decoded at the beginning of the body.
 	// [return flag] - optional. If have return/break/continue.
 
+	std::vector<ASTNode const*> loopParts{&_forStatement.body()};
+	std::vector<VariableDeclaration const*> stringBuilders = pushStringBuilders(loopParts);
+	std::vector<bigint> hoistedConstants = pushLoopInvariantConstants(loopParts);
+	std::vector<FunctionCall const*> messageTails = pushMessageTails(loopParts, _forStatement.rangeDeclaration());
+
 	const int saveStackSize = m_pusher.stackSize();
 	TVMExpressionCompiler ec{m_pusher};
 	ec.acceptExpr(_forStatement.rangeExpression(), true); // stack: dict
@@ -1095,6 +1378,18 @@ bool TVMFunctionCompiler::visit(ForEachStatement const& _forStatement) {
 	auto mappingType = to<MappingType>(_forStatement.rangeExpression()->annotation().type);
 	auto vds = to<VariableDeclarationStatement>(_forStatement.rangeDeclaration());
 	int loopVarQty{};
+	int pubKeySlot = -1;
+	int valueSlot = -1;
+	// stack: ... dict nbits or ... key dict nbits
+	auto pushKeyAndValue = [&](std::string const& dictOpcode, int take) {
+		m_pusher.startOpaque();
+		m_pusher.pushAsym(dictOpcode); // value key -1 or 0
+		m_pusher.pushAsym("NULLSWAPIFNOT");
+		m_pusher.pushAsym("NULLSWAPIFNOT");
+		m_pusher.endOpaque(take, 3);
+		m_pusher.drop();
+		// stack: ... value key  or  ... null null
+	};
 	if (arrayType) {
 		solAssert(vds->declarations().size() == 1, "");
 		auto iterVar = vds->declarations().at(0).get();
@@ -1111,26 +1406,49 @@ bool TVMFunctionCompiler::visit(ForEachStatement const& _forStatement) {
 		m_pusher.getStack().add(iterVar, false);
 		// stack: dict 0 value
 	} else if (mappingType) {
+		auto iterKey = vds->declarations().at(0).get();
+		auto iterVal = vds->declarations().at(1).get();
+		const bool isKeyUsed = iterKey != nullptr && isVariableUsed(*iterKey, _forStatement.body());
+		const bool isValueUsed = iterVal != nullptr && isVariableUsed(*iterVal, _forStatement.body());
+		const bool needPubKey = isKeyUsed && (
+			mappingType->keyType()->category() == Type::Category::Struct ||
+			isVariableChanged(*iterKey, _forStatement.body())
+		);
+		loopVarQty = 2;
+		if (needPubKey) {
+			pubKeySlot = loopVarQty++;
+		}
+		if (isValueUsed) {
+			valueSlot = loopVarQty++;
+		}
+
 		// stack: dict
 		m_pusher.pushS(0); // stack: dict dict
-		DictMinMax dictMinMax{m_pusher, *mappingType->keyType(), *mappingType->valueType(), true};
-		dictMinMax.minOrMax(true);
-		// stack: dict minKey(private) minKey(pub) value
+		m_pusher.pushInt(lengthOfDictKey(mappingType->keyType())); // stack: dict dict nbits
+		pushKeyAndValue("DICT" + typeToDictChar(mappingType->keyType()) + "MIN", 2);
+		// stack: dict value key
+		if (isValueUsed) {
+			m_pusher.exchange(1);
+		} else {
+			m_pusher.dropUnder(1, 1);
+		}
+		if (needPubKey) {
+			m_pusher.pushNull();
+			if (isValueUsed) {
+				m_pusher.exchange(1);
+			}
+		}
+		// stack: dict key [null] [value]
 
-		m_pusher.push(-2, ""); // fix stack
-		auto iterKey = vds->declarations().at(0).get();
-		auto iterVal = vds->declarations().at(1).get();
-		if (iterKey == nullptr)
-			m_pusher.push(+1, "");
-		else
+		m_pusher.push(-(loopVarQty - 1), ""); // fix stack
+		if (isKeyUsed && !needPubKey)
 			m_pusher.getStack().add(iterKey, true);
-		if (iterVal == nullptr)
-			m_pusher.push(+1, "");
 		else
+			m_pusher.push(+1, "");
+		if (needPubKey)
+			m_pusher.getStack().add(iterKey, true);
+		if (isValueUsed)
 			m_pusher.getStack().add(iterVal, true);
-
-		// stack: dict minKey(pub) value minKey(private)
-		loopVarQty = 4;
 	} else {
 		solUnimplemented("");
 	}
@@ -1163,7 +1481,7 @@ bool TVMFunctionCompiler::visit(ForEachStatement const& _forStatement) {
 				m_pusher.push(-1 + 1, "NOT");
 			}
 		} else if (mappingType) {
-			// stack: dict minKey(private) minKey(pub) value  [flag]
+			// stack: dict key [pubKey] [value] [flag]
 			m_pusher.pushS(m_pusher.stackSize() - saveStackSize - 2);
 			m_pusher.push(-1 + 1, "ISNULL");
 			m_pusher.push(-1 + 1, "NOT");
@@ -1206,6 +1524,27 @@ bool TVMFunctionCompiler::visit(ForEachStatement const& _forStatement) {
 
 				solAssert(ss == m_pusher.stackSize(), "");
 			}
+		} else if (mappingType) {
+			// stack: dict key [pubKey] [value] [flag]
+			if (pubKeySlot != -1) {
+				m_pusher.pushS(m_pusher.stackSize() - saveStackSize - 2);
+				if (auto structType = to<StructType>(mappingType->keyType())) {
+					StructCompiler sc{&m_pusher, structType};
+					sc.convertSliceToTuple();
+				}
+				m_pusher.popS(m_pusher.stackSize() - saveStackSize - 1 - pubKeySlot);
+			}
+			if (valueSlot != -1) {
+				m_pusher.pushS(m_pusher.stackSize() - saveStackSize - 1 - valueSlot);
+				m_pusher.recoverKeyAndValueAfterDictOperation(
+					mappingType->keyType(),
+					mappingType->valueType(),
+					false,
+					false,
+					StackPusher::DecodeType::DecodeValue
+				);
+				m_pusher.popS(m_pusher.stackSize() - saveStackSize - 1 - valueSlot);
+			}
 		}
 	};
 	std::function<void()> pushLoopExpression = [&]() {
@@ -1220,18 +1559,18 @@ bool TVMFunctionCompiler::visit(ForEachStatement const& _forStatement) {
 			}
 		} else if (mappingType) {
 			const int sss = m_pusher.stackSize();
-			// stack: dict minKey(private) minKey(pub) value [flag]
-			m_pusher.pushS(m_pusher.stackSize() - saveStackSize - 2); // stack: dict minKey(private) minKey(pub) value [flag] minKey
-			m_pusher.pushS(m_pusher.stackSize() - saveStackSize - 1); // stack: dict minKey(private) minKey(pub) value [flag] minKey dict
-			m_pusher.pushInt(lengthOfDictKey(mappingType->keyType()));      // stack: dict minKey(private) minKey(pub) value [flag] minKey dict nbits
-
-			DictPrevNext dictPrevNext{m_pusher, *mappingType->keyType(), *mappingType->valueType(), "next"};
-			dictPrevNext.prevNext(true);
-
-			// stack: dict minKey(private) minKey(pub) value [flag] minKey(private) minKey(pub) value
-			m_pusher.popS(m_pusher.stackSize() - saveStackSize - 4);
-			m_pusher.popS(m_pusher.stackSize() - saveStackSize - 3);
+			// stack: dict key [pubKey] [value] [flag]
+			m_pusher.pushS(m_pusher.stackSize() - saveStackSize - 2); // stack: dict key [pubKey] [value] [flag] key
+			m_pusher.pushS(m_pusher.stackSize() - saveStackSize - 1); // stack: dict key [pubKey] [value] [flag] key dict
+			m_pusher.pushInt(lengthOfDictKey(mappingType->keyType())); // stack: dict key [pubKey] [value] [flag] key dict nbits
+			pushKeyAndValue("DICT" + typeToDictChar(mappingType->keyType()) + "GETNEXT", 3);
+			// stack: dict key [pubKey] [value] [flag] nextValue nextKey
 			m_pusher.popS(m_pusher.stackSize() - saveStackSize - 2);
+			if (valueSlot != -1) {
+				m_pusher.popS(m_pusher.stackSize() - saveStackSize - 1 - valueSlot);
+			} else {
+				m_pusher.drop();
+			}
 			solAssert(sss == m_pusher.stackSize(), "");
 		} else {
 			solUnimplemented("");
@@ -1242,6 +1581,9 @@ bool TVMFunctionCompiler::visit(ForEachStatement const& _forStatement) {
 	// bottom
 	afterLoopCheck(ci, loopVarQty);
 	m_pusher.ensureSize(saveStackSize, "for");
+	dropMessageTails(messageTails);
+	dropLoopInvariantConstants(hoistedConstants);
+	assembleStringBuilders(stringBuilders);
 
 	return false;
 }
@@ -1323,6 +1665,15 @@ bool TVMFunctionCompiler::visit(ForStatement const &_forStatement) {
 	//     loopExpression
 	// }
 
+	std::vector<ASTNode const*> loopParts{
+		_forStatement.condition(),
+		&_forStatement.body(),
+		_forStatement.loopExpression()
+	};
+	std::vector<VariableDeclaration const*> stringBuilders = pushStringBuilders(loopParts);
+	std::vector<bigint> hoistedConstants = pushLoopInvariantConstants(loopParts);
+	std::vector<FunctionCall const*> messageTails = pushMessageTails(loopParts, _forStatement.initializationExpression());
+
 	int saveStackSize = m_pusher.stackSize();
 	// init
 	bool haveDeclLoopVar = false;
@@ -1358,6 +1709,9 @@ bool TVMFunctionCompiler::visit(ForStatement const &_forStatement) {
 	// bottom
 	afterLoopCheck(ci, haveDeclLoopVar);
 	m_pusher.ensureSize(saveStackSize, "for");
+	dropMessageTails(messageTails);
+	dropLoopInvariantConstants(hoistedConstants);
+	assembleStringBuilders(stringBuilders);
 
 	return false;
 }
@@ -1383,6 +1737,7 @@ bool TVMFunctionCompiler::visit(Return const& _return) {
 	if (expr) {
 		acceptExpr(expr);
 	}
+	saveCachedStateVariables();
 
 	int retCount = 0;
 	if (_return.annotation().functionReturnParameters != nullptr) {
@@ -1924,12 +2279,18 @@ void TVMFunctionCompiler::buildPublicFunctionSelector(
 }
 
 void TVMFunctionCompiler::pushLocation(const ASTNode& node, bool reset) {
-    SourceLocation const &loc = node.location();
-    SourceReference sr = SourceReferenceExtractor::extract(&loc);
-    const int line = reset ? 0 : sr.position.line + 1;
-
-	fs::path curDir = fs::current_path();
-	std::string p = fs::relative(sr.sourceName, curDir).generic_string();
-
-    m_pusher.pushLoc(p, line);
+	SourceLocation const &loc = node.location();
+	int line = 0;
+	int column = 0;
+	int start = -1;
+	int end = -1;
+	if (!reset && loc.hasText()) {
+		auto [l, c] = loc.source->translatePositionToLineColumn(loc.start);
+		line = l + 1;
+		column = c + 1;
+		start = loc.start;
+		end = loc.end;
+	}
+	std::string const& sourceName = loc.source ? loc.source->name() : "";
+	m_pusher.pushLoc(m_pusher.ctx().locFileId(sourceName), line, column, start, end);
 }
\ No newline at end of file
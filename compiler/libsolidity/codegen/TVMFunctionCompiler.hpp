@@ -75,6 +75,15 @@ protected:
 
 	void emitOnPublicFunctionReturn();
 	void pushDefaultParameters(const ast_vec<VariableDeclaration>& returnParameters);
+	void pushCachedStateVariables();
+	void saveCachedStateVariables();
+	std::vector<bigint> pushLoopInvariantConstants(std::vector<ASTNode const*> const& loopParts);
+	void dropLoopInvariantConstants(std::vector<bigint> const& hoistedConstants);
+	std::vector<VariableDeclaration const*> pushStringBuilders(std::vector<ASTNode const*> const& loopParts);
+	void assembleStringBuilders(std::vector<VariableDeclaration const*> const& stringBuilders);
+	std::vector<FunctionCall const*> pushMessageTails(std::vector<ASTNode const*> const& loopParts, Statement const* loopVarDecl = nullptr);
+	void dropMessageTails(std::vector<FunctionCall const*> const& messages);
+	bool tryAppendToStringBuilder(ExpressionStatement const& _statement);
 
 	void acceptExpr(const Expression* expr, bool isResultNeeded = true);
 
@@ -88,6 +97,7 @@ private:
 
 	bool visit(VariableDeclarationStatement const& _variableDeclarationStatement) override;
 	void acceptBody(Block const& _block, std::optional<std::tuple<int, int>> functionBlock);
+	bool tryFuseDictReadAndChange(Statement const& first, Statement const& second);
 	bool visit(Block const& _block) override;
 	bool visit(ExpressionStatement const& _expressionStatement) override;
 	bool visit(IfStatement const& _ifStatement) override;
@@ -138,6 +148,10 @@ private:
 	ContractDefinition const *m_contract{};
 	const bool m_isLibraryWithObj{};
 	const bool m_pushArgs{};
+	// state variables that are kept on the stack and must be saved before leaving the function
+	std::vector<VariableDeclaration const*> m_writtenCachedStateVariables;
+	// string variable -> stack position of the builder that accumulates its tail in a loop
+	std::map<VariableDeclaration const*, int> m_stringBuilders;
 };
 
 }	// end solidity::frontend
@@ -24,6 +24,7 @@
 #include "TVMABI.hpp"
 #include "TVMConstants.hpp"
 
+#include <boost/filesystem.hpp>
 #include <boost/range/adaptor/map.hpp>
 
 using namespace solidity::frontend;
@@ -35,8 +36,8 @@ StackPusher::StackPusher(TVMCompilerContext *ctx, const int stackSize) :
 	m_instructions.emplace_back();
 }
 
-void StackPusher::pushLoc(const std::string& file, int line) {
-	auto op = createNode<Loc>(file, line);
+void StackPusher::pushLoc(int fileId, int line, int column, int start, int end) {
+	auto op = createNode<Loc>(fileId, line, column, start, end);
 	m_instructions.back().opcodes.emplace_back(op);
 }
 
@@ -125,6 +126,48 @@ Pointer<Function> StackPusher::generateC7ToT4Macro() {
 	return f;
 }
 
+Pointer<Function> StackPusher::generateC7ToT4MacroForCells(int cellQty) {
+	solAssert(!m_ctx->usage().hasAwaitCall(), "");
+	const int varQty = m_ctx->storageCellStarts().at(cellQty);
+	std::vector<Type const *> memberTypes = m_ctx->notConstantStateVariableTypes();
+	memberTypes.resize(varQty);
+	// the rest of the chain is kept: it's the last reference of the last rebuilt cell
+	memberTypes.push_back(TypeProvider::tvmcell());
+
+	pushC4();
+	push(-1 + 1, "CTOS");
+	for (int i = 0; i < cellQty; ++i) {
+		pushS(0);
+		push(-1 + 1, "SREFS");
+		push(0, "DEC");
+		push(-2 + 1, "PLDREFVAR");
+		if (i + 1 < cellQty) {
+			push(-1 + 1, "CTOS");
+		}
+	}
+	for (int i = varQty - 1; i >= 0; --i) {
+		getGlob(TvmConst::C7::FirstIndexForVariables + i);
+	}
+	if (ctx().storeTimestampInC4()) {
+		getGlob(TvmConst::C7::ReplayProtTime);
+	}
+	getGlob(TvmConst::C7::TvmPubkey);
+	push(+1, "NEWC");
+	push(-2 + 1, "STU 256");
+	if (ctx().storeTimestampInC4()) {
+		push(-2 + 1, "STU 64");
+	}
+	push(-1 + 1, "STONE"); // constructor flag
+	ChainDataEncoder encoder{this};
+	EncodePosition position{m_ctx->getOffsetC4(), memberTypes};
+	encoder.encodeParameters(memberTypes, position);
+
+	push(-1 + 1, "ENDC");
+	popRoot();
+	const std::string name = "c7_to_c4_for_" + toString(cellQty) + "_cells";
+	return createNode<Function>(0, 0, name, Function::FunctionType::Macro, getBlock());
+}
+
 // TODO unit with generateC7ToT4Macro
 Pointer<Function> StackPusher::generateC7ToT4MacroForAwait() {
 	const std::vector<Type const *>& memberTypes = m_ctx->notConstantStateVariableTypes();
@@ -374,8 +417,7 @@ void StackPusher::recoverKeyAndValueAfterDictOperation(
 	Type const* valueType,
 	bool haveKey,
 	bool didUseOpcodeWithRef,
-	const DecodeType& decodeType,
-	bool saveOrigKeyAndNoTuple
+	const DecodeType& decodeType
 )
 {
 	const bool isValueStruct = valueType->category() == Type::Category::Struct;
@@ -388,21 +430,15 @@ void StackPusher::recoverKeyAndValueAfterDictOperation(
 	auto preloadValue = [&]() {
 		if (haveKey) {
 			// stack: value key
-			if (saveOrigKeyAndNoTuple) {
-				pushS(0); // stack: value key key
-			}
 			if (keyType->category() == Type::Category::Struct) {
 				StructCompiler sc{this, to<StructType>(keyType)};
 				sc.convertSliceToTuple();
-				// stack: value slice Tuple
+				// stack: value Tuple
 			}
-			if (saveOrigKeyAndNoTuple)
-				rot();
-			else
-				exchange(1);
-			// stack: slice key value
+			exchange(1);
+			// stack: key value
 		}
-		// stack: [slice, key] value
+		// stack: [key] value
 
 		switch (toDictValueType(valueType->category())) {
 			case DictValueType::Address:
@@ -499,34 +535,17 @@ void StackPusher::recoverKeyAndValueAfterDictOperation(
 			break;
 		}
 		case DecodeType::DecodeValueOrPushNull: {
-			if (!saveOrigKeyAndNoTuple) {
-				pushAsym("NULLSWAPIFNOT");
-			}
+			pushAsym("NULLSWAPIFNOT");
 
 			startContinuation();
 			preloadValue();
 			if (haveKey) {
-				if (!saveOrigKeyAndNoTuple) {
-					tuple(2);
-				}
+				tuple(2);
 			} else {
 				checkOnMappingOrOptional();
 			}
 			isValueStruct ? endContinuationFromRef() : endContinuation();
-
-			if (saveOrigKeyAndNoTuple) {
-				startContinuation();
-				push(+1, "NULL");
-				push(+1, "NULL");
-				push(+1, "NULL");
-				push(-3, ""); // fix stack
-				endContinuation();
-
-				ifElse();
-			} else {
-				_if();
-			}
-
+			_if();
 			break;
 		}
 		case DecodeType::PushNullOrDecodeValue: {
@@ -658,6 +677,18 @@ StackPusher::asym(const string& cmd) {
 		return false;
 	};
 
+	auto dictDelGet = [&]() {
+		for (std::string key : {"", "I", "U"}) {
+			for (std::string suf : {"", "REF"}) {
+				std::string candidat = "DICT" + key + "DELGET" + suf;
+				if (candidat == cmd) {
+					return true;
+				}
+			}
+		}
+		return false;
+	};
+
 	auto dictSomeGet = [&]() {
 		for (std::string key : {"", "I", "U"}) {
 			for (std::string op : {"SETGET", "ADDGET", "REPLACEGET"}) {
@@ -723,6 +754,7 @@ StackPusher::asym(const string& cmd) {
 	else if (f("DICTUGETPREVEQ")) { opcode = createNode<AsymGen>(cmd, 3, 1, 3); }
 
 	else if (dictSomeGet()) { opcode = createNode<AsymGen>(cmd, 4, 2, 3); }
+	else if (dictDelGet()) { opcode = createNode<AsymGen>(cmd, 3, 2, 3); }
 
 	else solAssert(opcode, "StackPusher::asym " + cmd);
 	return opcode;
@@ -1907,6 +1939,59 @@ void StackPusher::pushMacroCallInCallRef(int take, int ret, const string& functi
 	callRef(take, ret);
 }
 
+void StackPusher::appendStringToBuilders(const std::string& str) {
+	// stack: BldrList builder
+	size_t maxSlice = TvmConst::CellBitLength / 8;
+	for (size_t i = 0; i < str.length(); i += maxSlice) {
+		pushString(str.substr(i, min(maxSlice, str.length() - i)), true);
+		// stack: BldrList builder Slice
+		pushMacroCallInCallRef(3, 2, "storeStringInBuilders_macro");
+	}
+	// stack: BldrList builder
+}
+
+void StackPusher::appendStringToBuilders() {
+	// stack: BldrList builder string(cell)
+	m_ctx->setAppendStringToBuildersUsed();
+	pushMacroCallInCallRef(3, 2, "append_string_to_builders");
+	// stack: BldrList builder
+}
+
+Pointer<Function> StackPusher::generateAppendStringToBuildersMacro() {
+	change(3);
+	// stack: BldrList builder string(cell)
+	push(-1 + 1, "CTOS");
+	auto storeSlice = [&]() {
+		// stack: BldrList builder slice
+		m_instructions.back().opcodes.push_back(makeBLKPUSH(3, 2));
+		change(+3);
+		pushMacroCallInCallRef(3, 2, "storeStringInBuilders_macro");
+		popS(3);
+		popS(3);
+		// stack: BldrList builder slice
+	};
+	storeSlice();
+
+	startContinuation();
+	pushS(0);
+	pushInt(1);
+	push(-2 + 1, "SCHKREFSQ");
+	push(-1, ""); // fix stack
+	endContinuation();
+
+	startContinuation();
+	push(-1 + 2, "LDREFRTOS");
+	dropUnder(1, 1);
+	storeSlice();
+	endContinuation();
+	_while();
+
+	drop();
+	// stack: BldrList builder
+	solAssert(stackSize() == 2, "");
+	return createNode<Function>(3, 2, "append_string_to_builders", Function::FunctionType::Macro, getBlock());
+}
+
 void StackPusher::pushCallOrCallRef(
 	const string &functionName,
 	const FunctionType *ft,
@@ -2043,8 +2128,22 @@ void StackPusher::prepareKeyForDictOperations(Type const *key, bool doIgnoreByte
 	}
 }
 
+namespace {
+	// bit lengths of int_msg_info fields if they are zero
+	const std::vector<int> intMsgInfoFieldBitQty {1, 1, 1,
+											2, 2,
+											4, 1, 4, 4,
+											64, 32};
+}
+
 int StackPusher::int_msg_info(const std::set<int> &isParamOnStack, const std::map<int, std::string> &constParams,
 									bool isDestBuilder) {
+	push(+1, "NEWC");
+	return int_msg_info_fields(isParamOnStack, constParams, isDestBuilder, 0, TvmConst::int_msg_info::fieldQty);
+}
+
+int StackPusher::int_msg_info_fields(const std::set<int> &isParamOnStack, const std::map<int, std::string> &constParams,
+									bool isDestBuilder, int beginParam, int endParam) {
 	// int_msg_info$0  ihr_disabled:Bool  bounce:Bool(#1)  bounced:Bool
 	//				 src:MsgAddress  dest:MsgAddressInt(#4)
 	//				 value:CurrencyCollection(#5,#6)  ihr_fee:Grams  fwd_fee:Grams
@@ -2053,14 +2152,11 @@ int StackPusher::int_msg_info(const std::set<int> &isParamOnStack, const std::ma
 
 	// currencies$_ grams:Grams other:ExtraCurrencyCollection = CurrencyCollection;
 
-	static const std::vector<int> zeroes {1, 1, 1,
-									2, 2,
-									4, 1, 4, 4,
-									64, 32};
-	std::string bitString = "0";
+	const std::vector<int>& zeroes = intMsgInfoFieldBitQty;
+	// stack: builder
+	std::string bitString = beginParam == 0 ? "0" : "";
 	int maxBitStringSize = 0;
-	push(+1, "NEWC");
-	for (int param = 0; param < static_cast<int>(zeroes.size()); ++param) {
+	for (int param = beginParam; param < endParam; ++param) {
 		solAssert(constParams.count(param) == 0 || isParamOnStack.count(param) == 0, "");
 
 		if (constParams.count(param) != 0) {
@@ -2246,7 +2342,16 @@ void StackPusher::prepareMsg(
 			break;
 	}
 	// stack: builder
+	appendStateInitAndBody(msgInfoSize, appendBody, appendStateInit);
+	// stack: builder'
+	push(0, "ENDC"); // stack: cell
+}
 
+void StackPusher::appendStateInitAndBody(
+	int msgInfoSize,
+	const std::function<void(int)> &appendBody,
+	const std::function<void()> &appendStateInit
+) {
 	if (appendStateInit) {
 		// stack: values... builder
 		appendToBuilder("1");
@@ -2266,9 +2371,63 @@ void StackPusher::prepareMsg(
 	} else {
 		appendToBuilder("0"); // there is no body
 	}
+}
 
-	// stack: builder'
-	push(0, "ENDC"); // stack: cell
+// Pushes builder with the part of internal message after `value.grams`: extra currencies, the rest of the header,
+// StateInit and body. The part doesn't depend on destination and value, so it can be built once for several messages.
+void StackPusher::pushIntMsgTail(
+	const std::set<int>& isParamOnStack,
+	const std::map<int, std::string> &constParams,
+	const std::function<void(int)> &appendBody,
+	const std::function<void()> &appendStateInit
+) {
+	solAssert(isParamOnStack.count(TvmConst::int_msg_info::dest) == 0 &&
+		isParamOnStack.count(TvmConst::int_msg_info::tons) == 0, "");
+	// stack: [currencies]
+	push(+1, "NEWC");
+	int msgInfoSize = int_msg_info_fields(isParamOnStack, constParams, false,
+		TvmConst::int_msg_info::currency, TvmConst::int_msg_info::fieldQty);
+	// fields before extra currencies are stored in each message
+	for (int param = 0; param < TvmConst::int_msg_info::currency; ++param) {
+		if (constParams.count(param) != 0) {
+			msgInfoSize += constParams.at(param).length();
+		} else if (param == TvmConst::int_msg_info::dest) {
+			msgInfoSize += AddressInfo::maxBitLength();
+		} else if (param == TvmConst::int_msg_info::tons) {
+			msgInfoSize += VarUIntegerInfo::maxTonBitLength();
+		} else {
+			msgInfoSize += intMsgInfoFieldBitQty.at(param);
+		}
+	}
+	appendStateInitAndBody(msgInfoSize, appendBody, appendStateInit);
+	// stack: builder
+}
+
+// Sends internal message. The part after `value.grams` is taken from the builder pushed by pushIntMsgTail
+void StackPusher::sendIntMsgWithTail(
+	const std::map<int, Expression const *> &exprs,
+	const std::map<int, std::string> &constParams,
+	ASTNode const* message,
+	const std::function<void()> &pushSendrawmsgFlag
+) {
+	std::set<int> isParamOnStack;
+	for (auto &[param, expr] : exprs | boost::adaptors::reversed) {
+		solAssert(param < TvmConst::int_msg_info::currency, "");
+		isParamOnStack.insert(param);
+		TVMExpressionCompiler{*this}.compileNewExpr(expr);
+	}
+	push(+1, "NEWC");
+	(void)int_msg_info_fields(isParamOnStack, constParams, false, 0, TvmConst::int_msg_info::currency);
+	// stack: builder
+	pushS(*getStack().getMessageTailOffset(message));
+	push(-2 + 1, "STBR");
+	push(0, "ENDC");
+	if (pushSendrawmsgFlag) {
+		pushSendrawmsgFlag();
+	} else {
+		pushInt(TvmConst::SENDRAWMSG::DefaultFlag);
+	}
+	sendrawmsg();
 }
 
 void StackPusher::sendMsg(const std::set<int>& isParamOnStack,
@@ -2354,6 +2513,44 @@ void TVMStack::takeLast(int n) {
 	m_stackSize = vector<Declaration const*>(m_stackSize.end() - n, m_stackSize.end());
 	m_size = n;
 	solAssert(int(m_stackSize.size()) == n, "");
+	m_constants.clear();
+	m_messageTails.clear();
+}
+
+void TVMStack::addConstant(bigint const& value) {
+	solAssert(m_size > 0, "");
+	m_constants[value] = m_size - 1;
+}
+
+void TVMStack::removeConstant(bigint const& value) {
+	solAssert(m_constants.count(value), "");
+	m_constants.erase(value);
+}
+
+std::optional<int> TVMStack::getConstantOffset(bigint const& value) const {
+	auto it = m_constants.find(value);
+	if (it == m_constants.end() || it->second >= m_size) {
+		return {};
+	}
+	return getOffset(it->second);
+}
+
+void TVMStack::addMessageTail(ASTNode const* message) {
+	solAssert(m_size > 0, "");
+	m_messageTails[message] = m_size - 1;
+}
+
+void TVMStack::removeMessageTail(ASTNode const* message) {
+	solAssert(m_messageTails.count(message), "");
+	m_messageTails.erase(message);
+}
+
+std::optional<int> TVMStack::getMessageTailOffset(ASTNode const* message) const {
+	auto it = m_messageTails.find(message);
+	if (it == m_messageTails.end() || it->second >= m_size) {
+		return {};
+	}
+	return getOffset(it->second);
 }
 
 void TVMCompilerContext::initMembers(ContractDefinition const *contract) {
@@ -2364,11 +2561,21 @@ void TVMCompilerContext::initMembers(ContractDefinition const *contract) {
 		for (FunctionDefinition const *_function : c->definedFunctions()) {
 			const std::set<CallableDeclaration const*>& b = _function->annotation().baseFunctions;
 			m_baseFunctions.insert(b.begin(), b.end());
+			std::set<FunctionCall const*> gets = optionalGetsWithValue(*_function);
+			m_optionalGetsWithValue.insert(gets.begin(), gets.end());
+		}
+		for (ModifierDefinition const *modifier : c->functionModifiers()) {
+			std::set<FunctionCall const*> gets = optionalGetsWithValue(*modifier);
+			m_optionalGetsWithValue.insert(gets.begin(), gets.end());
 		}
 	}
 
 	ignoreIntOverflow = m_pragmaHelper.haveIgnoreIntOverflow();
-	for (VariableDeclaration const *variable: notConstantStateVariables()) {
+	m_storageLayout = notConstantStateVariables();
+	if (m_pragmaHelper.haveOptimizeStorageLayout()) {
+		m_storageLayout = optimizeStorageLayout(*contract, m_storageLayout, getOffsetC4(), m_usage.hasAwaitCall() ? 1 : 0);
+	}
+	for (VariableDeclaration const *variable: m_storageLayout) {
 		m_stateVarIndex[variable] = TvmConst::C7::FirstIndexForVariables + m_stateVarIndex.size();
 	}
 }
@@ -2385,10 +2592,14 @@ int TVMCompilerContext::getStateVarIndex(VariableDeclaration const *variable) co
 }
 
 std::vector<VariableDeclaration const *> TVMCompilerContext::notConstantStateVariables() const {
+	return notConstantStateVariables(getContract());
+}
+
+std::vector<VariableDeclaration const *> TVMCompilerContext::notConstantStateVariables(ContractDefinition const* contract) {
 	std::vector<VariableDeclaration const*> variableDeclarations;
-	std::vector<ContractDefinition const*> mainChain = getContractsChain(getContract());
-	for (ContractDefinition const* contract : mainChain) {
-		for (VariableDeclaration const *variable: contract->stateVariables()) {
+	std::vector<ContractDefinition const*> mainChain = getContractsChain(contract);
+	for (ContractDefinition const* c : mainChain) {
+		for (VariableDeclaration const *variable: c->stateVariables()) {
 			if (!variable->isConstant()) {
 				variableDeclarations.push_back(variable);
 			}
@@ -2401,9 +2612,33 @@ bool TVMCompilerContext::tooMuchStateVariables() const {
 	return notConstantStateVariables().size() >= TvmConst::C7::FirstIndexForVariables + 6;
 }
 
+std::map<int, int> TVMCompilerContext::storageCellStarts() const {
+	std::vector<Type const *> types = notConstantStateVariableTypes();
+	EncodePosition position{getOffsetC4(), types, m_usage.hasAwaitCall() ? 1 : 0};
+	std::map<int, int> res;
+	int cellNumber = 0;
+	std::function<void(Type const*, int, bool)> update = [&](Type const* type, int varIndex, bool isFirst) {
+		if (auto structType = to<StructType>(type)) {
+			for (ASTPointer<VariableDeclaration> const& m : structType->structDefinition().members()) {
+				update(m->type(), varIndex, isFirst);
+				isFirst = false;
+			}
+		} else if (position.needNewCell(type)) {
+			++cellNumber;
+			if (isFirst) {
+				res[cellNumber] = varIndex;
+			}
+		}
+	};
+	for (int i = 0; i < static_cast<int>(types.size()); ++i) {
+		update(types.at(i), i, true);
+	}
+	return res;
+}
+
 std::vector<Type const *> TVMCompilerContext::notConstantStateVariableTypes() const {
 	std::vector<Type const *> types;
-	for (VariableDeclaration const * var : notConstantStateVariables()) {
+	for (VariableDeclaration const * var : m_storageLayout) {
 		types.emplace_back(var->type());
 	}
 	return types;
@@ -2501,9 +2736,13 @@ void TVMCompilerContext::addLib(FunctionDefinition const* f) {
 }
 
 std::vector<std::pair<VariableDeclaration const*, int>> TVMCompilerContext::getStaticVariables() const {
+	return getStaticVariables(getContract());
+}
+
+std::vector<std::pair<VariableDeclaration const*, int>> TVMCompilerContext::getStaticVariables(ContractDefinition const* contract) {
 	int shift = 0;
 	std::vector<std::pair<VariableDeclaration const*, int>> res;
-	for (VariableDeclaration const* v : notConstantStateVariables()) {
+	for (VariableDeclaration const* v : notConstantStateVariables(contract)) {
 		if (v->isStatic()) {
 			res.emplace_back(v, TvmConst::C4::PersistenceMembersStartIndex + shift++);
 		}
@@ -2550,6 +2789,23 @@ bool TVMCompilerContext::isBaseFunction(CallableDeclaration const* d) const {
 	return m_baseFunctions.count(d) != 0;
 }
 
+bool TVMCompilerContext::isTupleArray(VariableDeclaration const* vd) {
+	auto it = m_tupleArrays.find(vd);
+	if (it == m_tupleArrays.end()) {
+		it = m_tupleArrays.emplace(vd, canBeTupleArray(*vd)).first;
+	}
+	return it->second;
+}
+
+int TVMCompilerContext::locFileId(std::string const& sourceName) {
+	auto it = m_locFileIds.find(sourceName);
+	if (it == m_locFileIds.end()) {
+		std::string path = boost::filesystem::relative(sourceName, boost::filesystem::current_path()).generic_string();
+		it = m_locFileIds.emplace(sourceName, Loc::fileId(path)).first;
+	}
+	return it->second;
+}
+
 bool TVMCompilerContext::dfs(FunctionDefinition const* v) {
 	if (color.at(v) == Color::Black) {
 		return false;
@@ -50,10 +50,20 @@ public:
 	int getStackSize(Declaration const* name) const;
 	void ensureSize(int savedStackSize, const string& location = "", const ASTNode* node = nullptr) const;
 	void takeLast(int n);
+	// Integer constants hoisted out of loops. They are kept on the stack until removeConstant is called.
+	void addConstant(bigint const& value);
+	void removeConstant(bigint const& value);
+	std::optional<int> getConstantOffset(bigint const& value) const;
+	// Builders with the parts of outbound messages built before loops. The key is the call that sends the message.
+	void addMessageTail(ASTNode const* message);
+	void removeMessageTail(ASTNode const* message);
+	std::optional<int> getMessageTailOffset(ASTNode const* message) const;
 
 private:
 	int m_size{};
 	std::vector<Declaration const*> m_stackSize;
+	std::map<bigint, int> m_constants;
+	std::map<ASTNode const*, int> m_messageTails;
 };
 
 class TVMCompilerContext {
@@ -62,8 +72,14 @@ public:
 	void initMembers(ContractDefinition const* contract);
 	int getStateVarIndex(VariableDeclaration const *variable) const;
 	std::vector<VariableDeclaration const *> notConstantStateVariables() const;
+	static std::vector<VariableDeclaration const *> notConstantStateVariables(ContractDefinition const* contract);
 	bool tooMuchStateVariables() const;
+	// Non-constant state variables in the order they are stored in c4 and c7
+	std::vector<VariableDeclaration const *> const& storageLayout() const { return m_storageLayout; }
 	std::vector<Type const *> notConstantStateVariableTypes() const;
+	// @returns map from the number of c4 cell (0 is the root) to the quantity of state variables stored before it.
+	// Only cells that begin with a state variable, not with a member of a struct, are present.
+	std::map<int, int> storageCellStarts() const;
 	PragmaDirectiveHelper const& pragmaHelper() const;
 	bool hasTimeInAbiHeader() const;
 	bool isStdlib() const;
@@ -78,6 +94,7 @@ public:
 	void addLib(FunctionDefinition const* f);
 	std::set<FunctionDefinition const*>& getLibFunctions() { return m_libFunctions; }
 	std::vector<std::pair<VariableDeclaration const*, int>> getStaticVariables() const;
+	static std::vector<std::pair<VariableDeclaration const*, int>> getStaticVariables(ContractDefinition const* contract);
 	void setCurrentFunction(FunctionDefinition const* f) { m_currentFunction = f; }
 	FunctionDefinition const* getCurrentFunction() { return m_currentFunction; }
 	void addInlineFunction(const std::string& name, Pointer<CodeBlock> body);
@@ -93,14 +110,22 @@ public:
 	void setIsReceiveGenerated() { m_isReceiveGenerated = true; }
 	bool isOnBounceGenerated() const { return m_isOnBounceGenerated; }
 	void setIsOnBounce() { m_isOnBounceGenerated = true; }
+	bool isAppendStringToBuildersUsed() const { return m_isAppendStringToBuildersUsed; }
+	void setAppendStringToBuildersUsed() { m_isAppendStringToBuildersUsed = true; }
 	bool isBaseFunction(CallableDeclaration const* d) const;
 	ContactsUsageScanner const& usage() const { return m_usage; }
+	bool isTupleArray(VariableDeclaration const* vd);
+	// @returns true if `x.get()` is called when `x` is known to have a value
+	bool isOptionalGetWithValue(FunctionCall const* get) const { return m_optionalGetsWithValue.count(get) != 0; }
+	// @returns id of the source path relative to the current directory, the path is computed once per source
+	int locFileId(std::string const& sourceName);
 
 private:
 	ContractDefinition const* m_contract{};
 	bool ignoreIntOverflow{};
 	PragmaDirectiveHelper const& m_pragmaHelper;
 	std::map<VariableDeclaration const*, int> m_stateVarIndex;
+	std::vector<VariableDeclaration const*> m_storageLayout;
 	std::set<FunctionDefinition const*> m_libFunctions;
 	FunctionDefinition const* m_currentFunction{};
 	std::map<std::string, Pointer<CodeBlock>> m_inlinedFunctions;
@@ -113,8 +138,12 @@ private:
 	bool m_isFallBackGenerated{};
 	bool m_isReceiveGenerated{};
 	bool m_isOnBounceGenerated{};
+	bool m_isAppendStringToBuildersUsed{};
     std::set<CallableDeclaration const*> m_baseFunctions;
     ContactsUsageScanner m_usage;
+	std::map<VariableDeclaration const*, bool> m_tupleArrays;
+	std::set<FunctionCall const*> m_optionalGetsWithValue;
+	std::map<std::string, int> m_locFileIds;
 };
 
 class StackPusher {
@@ -193,7 +222,7 @@ public:
 	void _throw(std::string cmd);
 
 	TVMStack& getStack();
-	void pushLoc(const std::string& file, int line);
+	void pushLoc(int fileId, int line, int column, int start, int end);
     void pushString(const std::string& str, bool toSlice);
 	void pushLog();
 	void untuple(int n);
@@ -232,6 +261,8 @@ public:
 	void store(const Type *type, bool reverse);
 	void pushZeroAddress();
 	Pointer<Function> generateC7ToT4Macro();
+	// Rebuilds only the first cellQty cells of c4 and keeps the rest of the chain from the current c4
+	Pointer<Function> generateC7ToT4MacroForCells(int cellQty);
 	Pointer<Function> generateC7ToT4MacroForAwait();
 
 	// TODO move to formatter
@@ -251,6 +282,12 @@ public:
 	void checkFit(Type const *type);
 	void pushParameter(std::vector<ASTPointer<VariableDeclaration>> const& params);
 	void pushMacroCallInCallRef(int take, int ret, const string& fname);
+	// Appends string to the builder list that is assembled by assembleList_macro.
+	// stack: BldrList builder string(cell) -> BldrList builder
+	void appendStringToBuilders();
+	void appendStringToBuilders(const std::string& str);
+	// Body of appendStringToBuilders(), that is shared by all the appends of the contract
+	Pointer<Function> generateAppendStringToBuildersMacro();
 	void pushCallOrCallRef(const string& functionName, FunctionType const* ft, const std::optional<std::pair<int, int>>& deltaStack = nullopt);
 	void pushCall(int take, int ret, const std::string& functionName);
 	void drop(int cnt = 1);
@@ -264,6 +301,11 @@ public:
 	[[nodiscard]]
 	int int_msg_info(const std::set<int> &isParamOnStack, const std::map<int, std::string> &constParams, bool isDestBuilder);
 	[[nodiscard]]
+	int int_msg_info_fields(const std::set<int> &isParamOnStack, const std::map<int, std::string> &constParams,
+							bool isDestBuilder, int beginParam, int endParam);
+	void appendStateInitAndBody(int msgInfoSize, const std::function<void(int)> &appendBody,
+								const std::function<void()> &appendStateInit);
+	[[nodiscard]]
 	int ext_msg_info(const std::set<int> &isParamOnStack, bool isOut);
 	void appendToBuilder(const std::string& bitString);
 	void checkOptionalValue();
@@ -286,8 +328,7 @@ public:
 		Type const* valueType,
 		bool haveKey,
 		bool didUseOpcodeWithRef,
-		const DecodeType& decodeType,
-		bool saveOrigKeyAndNoTuple = false
+		const DecodeType& decodeType
 	);
 	static TypePointer parseIndexType(Type const* type);
 	static TypePointer parseValueType(IndexAccess const& indexAccess);
@@ -317,6 +358,14 @@ public:
 					bool isAwait,
 					size_t callParamsOnStack,
 					const std::function<void()> &appendStateInit);
+	void pushIntMsgTail(const std::set<int>& isParamOnStack,
+						const std::map<int, std::string> &constParams,
+						const std::function<void(int)> &appendBody,
+						const std::function<void()> &appendStateInit);
+	void sendIntMsgWithTail(const std::map<int, const Expression *> &exprs,
+							const std::map<int, std::string> &constParams,
+							ASTNode const* message,
+							const std::function<void()> &pushSendrawmsgFlag);
 
 	enum class MsgType{
 		Internal,
@@ -79,7 +79,7 @@ bool Simulator::visit(HardCode &_node) {
 }
 
 bool Simulator::visit(Loc &_node) {
-	m_commands.emplace_back(createNode<Loc>(_node.file(), _node.line()));
+	m_commands.emplace_back(createNode<Loc>(_node.fileId(), _node.line(), _node.column(), _node.start(), _node.end()));
 	return false;
 }
 
@@ -0,0 +1,1041 @@
+/*
+ * Copyright 2018-2021 TON DEV SOLUTIONS LTD.
+ *
+ * Licensed under the  terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License.
+ *
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the  GNU General Public License for more details at: https://www.gnu.org/licenses/gpl-3.0.html
+ */
+/**
+ * @author TON Labs <connect@tonlabs.io>
+ * @date 2021
+ * Assembler of the TVM AST into a code cell
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <optional>
+#include <unordered_map>
+
+#include <boost/algorithm/string/predicate.hpp>
+
+#include <liblangutil/Exceptions.h>
+
+#include "TvmAssembler.hpp"
+#include "TVMCommons.hpp"
+#include "TVMConstants.hpp"
+
+using namespace solidity::frontend;
+
+namespace {
+
+using Args = std::vector<std::string_view>;
+
+struct BadArgument {};
+
+std::string_view trim(std::string_view _s) {
+	size_t const begin = _s.find_first_not_of(" \t\r");
+	if (begin == std::string_view::npos) {
+		return {};
+	}
+	size_t const end = _s.find_last_not_of(" \t\r");
+	return _s.substr(begin, end - begin + 1);
+}
+
+void check(bool _condition) {
+	if (!_condition) {
+		throw BadArgument{};
+	}
+}
+
+int64_t number(std::string_view _s) {
+	int64_t value{};
+	auto [end, ec] = std::from_chars(_s.data(), _s.data() + _s.size(), value);
+	check(ec == std::errc{} && end == _s.data() + _s.size());
+	return value;
+}
+
+// e.g. S3 or C7
+int64_t reg(std::string_view _s, char _kind) {
+	check(_s.size() >= 2 && std::toupper(_s[0]) == _kind);
+	return number(_s.substr(1));
+}
+
+bool isReg(std::string_view _s, char _kind) {
+	return !_s.empty() && std::toupper(_s[0]) == _kind;
+}
+
+int64_t inRange(int64_t _value, int64_t _min, int64_t _max) {
+	check(_min <= _value && _value <= _max);
+	return _value;
+}
+
+CellBuilder op(std::string_view _hex) {
+	CellBuilder b;
+	b.storeHex(_hex);
+	return b;
+}
+
+CellBuilder op(uint64_t _code, size_t _bits) {
+	CellBuilder b;
+	b.storeUInt(_code, _bits);
+	return b;
+}
+
+// Stores the data and the completion tag into the field of _size bits
+void storeWithTag(CellBuilder& _b, CellBuilder const& _data, size_t _size) {
+	check(_data.bitSize() < _size);
+	_b.append(_data).storeBit(true);
+	for (size_t i = _data.bitSize() + 1; i < _size; ++i) {
+		_b.storeBit(false);
+	}
+}
+
+CellBuilder slice(std::string_view _arg) {
+	CellBuilder data;
+	if (_arg == "0" || _arg == "1") {
+		data.storeBit(_arg == "1");
+	} else {
+		check(_arg.size() >= 1 && _arg[0] == 'x');
+		data.storeHex(_arg.substr(1));
+	}
+	return data;
+}
+
+CellBuilder pushInt(bigint const& _value) {
+	auto fits = [&](size_t _bits) {
+		bigint const bound = bigint(1) << (_bits - 1);
+		return -bound <= _value && _value < bound;
+	};
+	if (-5 <= _value && _value <= 10) {
+		return op(0x70 | (static_cast<int>(_value) & 0xF), 8);
+	}
+	if (fits(8)) {
+		return op(0x80, 8).storeInt(_value, 8);
+	}
+	if (fits(16)) {
+		return op(0x81, 8).storeInt(_value, 16);
+	}
+	for (size_t l = 0; l < 31; ++l) {
+		if (fits(8 * l + 19)) {
+			return op(0x82, 8).storeUInt(l, 5).storeInt(_value, 8 * l + 19);
+		}
+	}
+	throw BadArgument{};
+}
+
+CellBuilder pushSlice(CellBuilder const& _data) {
+	size_t const bits = _data.bitSize();
+	CellBuilder b;
+	if (bits <= 8 * 15 + 3) {
+		size_t const x = bits <= 3 ? 0 : (bits - 3 + 7) / 8;
+		storeWithTag(b.storeUInt(0x8B, 8).storeUInt(x, 4), _data, 8 * x + 4);
+	} else {
+		size_t const x = (bits - 5 + 7) / 8;
+		check(x <= 127);
+		storeWithTag(b.storeUInt(0x8D, 8).storeUInt(0, 3).storeUInt(x, 7), _data, 8 * x + 6);
+	}
+	return b;
+}
+
+CellBuilder stSliceConst(CellBuilder const& _data) {
+	size_t const bits = _data.bitSize();
+	size_t const y = bits <= 1 ? 0 : (bits - 1 + 7) / 8;
+	check(y <= 7);
+	CellBuilder b;
+	storeWithTag(b.storeUInt(0x19F, 9).storeUInt(0, 2).storeUInt(y, 3), _data, 8 * y + 2);
+	return b;
+}
+
+CellBuilder xchg(int64_t _i, int64_t _j) {
+	if (_i > _j) {
+		std::swap(_i, _j);
+	}
+	check(0 <= _i && _i < _j && _j <= 255);
+	if (_i == 0) {
+		return _j <= 15 ? op(_j, 8) : op(0x1100 | _j, 16);
+	}
+	check(_j <= 15);
+	if (_i == 1) {
+		return op(0x10 | _j, 8);
+	}
+	return op(0x1000 | (_i << 4) | _j, 16);
+}
+
+// Instructions without arguments
+std::unordered_map<std::string, std::string> const& simpleOpcodes() {
+	static std::unordered_map<std::string, std::string> const opcodes = [] {
+		std::unordered_map<std::string, std::string> res = {
+			// stack
+			{"NOP", "00"}, {"SWAP", "01"}, {"DUP", "20"}, {"OVER", "21"}, {"DROP", "30"}, {"NIP", "31"},
+			{"ROT", "58"}, {"ROTREV", "59"}, {"-ROT", "59"}, {"SWAP2", "5A"}, {"DROP2", "5B"}, {"DUP2", "5C"},
+			{"OVER2", "5D"}, {"PICK", "60"}, {"PUSHX", "60"}, {"ROLLX", "61"}, {"ROLLREVX", "62"}, {"-ROLLX", "62"},
+			{"BLKSWX", "63"}, {"REVX", "64"}, {"DROPX", "65"}, {"TUCK", "66"}, {"XCHGX", "67"}, {"DEPTH", "68"},
+			{"CHKDEPTH", "69"}, {"ONLYTOPX", "6A"}, {"ONLYX", "6B"},
+			// tuples and null
+			{"NULL", "6D"}, {"PUSHNULL", "6D"}, {"NEWDICT", "6D"}, {"ISNULL", "6E"}, {"DICTEMPTY", "6E"},
+			{"NIL", "6F00"}, {"SINGLE", "6F01"}, {"PAIR", "6F02"}, {"TRIPLE", "6F03"},
+			{"FIRST", "6F10"}, {"SECOND", "6F11"}, {"THIRD", "6F12"},
+			{"UNSINGLE", "6F21"}, {"UNPAIR", "6F22"}, {"UNTRIPLE", "6F23"},
+			{"TUPLEVAR", "6F80"}, {"INDEXVAR", "6F81"}, {"UNTUPLEVAR", "6F82"}, {"UNPACKFIRSTVAR", "6F83"},
+			{"EXPLODEVAR", "6F84"}, {"SETINDEXVAR", "6F85"}, {"INDEXVARQ", "6F86"}, {"SETINDEXVARQ", "6F87"},
+			{"TLEN", "6F88"}, {"QTLEN", "6F89"}, {"ISTUPLE", "6F8A"}, {"LAST", "6F8B"}, {"TPUSH", "6F8C"},
+			{"COMMA", "6F8C"}, {"TPOP", "6F8D"},
+			{"NULLSWAPIF", "6FA0"}, {"NULLSWAPIFNOT", "6FA1"}, {"NULLROTRIF", "6FA2"}, {"NULLROTRIFNOT", "6FA3"},
+			{"NULLSWAPIF2", "6FA4"}, {"NULLSWAPIFNOT2", "6FA5"}, {"NULLROTRIF2", "6FA6"}, {"NULLROTRIFNOT2", "6FA7"},
+			// constants
+			{"TRUE", "7F"}, {"FALSE", "70"}, {"ZERO", "70"}, {"ONE", "71"}, {"TWO", "72"}, {"TEN", "7A"},
+			// arithmetic
+			{"ADD", "A0"}, {"SUB", "A1"}, {"SUBR", "A2"}, {"NEGATE", "A3"}, {"INC", "A4"}, {"DEC", "A5"},
+			{"MUL", "A8"}, {"DIV", "A904"}, {"DIVR", "A905"}, {"DIVC", "A906"}, {"MOD", "A908"},
+			{"DIVMOD", "A90C"}, {"DIVMODR", "A90D"}, {"DIVMODC", "A90E"},
+			{"MULDIV", "A984"}, {"MULDIVR", "A985"}, {"MULDIVC", "A986"}, {"MULMOD", "A988"}, {"MULDIVMOD", "A98C"},
+			{"LSHIFT", "AC"}, {"RSHIFT", "AD"}, {"POW2", "AE"},
+			{"AND", "B0"}, {"OR", "B1"}, {"XOR", "B2"}, {"NOT", "B3"},
+			{"FITSX", "B600"}, {"UFITSX", "B601"}, {"BITSIZE", "B602"}, {"UBITSIZE", "B603"},
+			{"MIN", "B608"}, {"MAX", "B609"}, {"MINMAX", "B60A"}, {"ABS", "B60B"},
+			// comparison
+			{"SGN", "B8"}, {"LESS", "B9"}, {"EQUAL", "BA"}, {"LEQ", "BB"}, {"GREATER", "BC"}, {"NEQ", "BD"},
+			{"GEQ", "BE"}, {"CMP", "BF"}, {"ISZERO", "C000"}, {"ISNEG", "C100"}, {"ISNPOS", "C101"},
+			{"ISPOS", "C200"}, {"ISNNEG", "C2FF"}, {"ISNAN", "C4"}, {"CHKNAN", "C5"},
+			{"SEMPTY", "C700"}, {"SDEMPTY", "C701"}, {"SREMPTY", "C702"}, {"SDFIRST", "C703"},
+			{"SDLEXCMP", "C704"}, {"SDEQ", "C705"}, {"SDPFX", "C708"}, {"SDPFXREV", "C709"},
+			{"SDPPFX", "C70A"}, {"SDPPFXREV", "C70B"}, {"SDSFX", "C70C"}, {"SDSFXREV", "C70D"},
+			{"SDPSFX", "C70E"}, {"SDPSFXREV", "C70F"}, {"SDCNTLEAD0", "C710"}, {"SDCNTLEAD1", "C711"},
+			{"SDCNTTRAIL0", "C712"}, {"SDCNTTRAIL1", "C713"},
+			// builders
+			{"NEWC", "C8"}, {"ENDC", "C9"}, {"STREF", "CC"}, {"STBREFR", "CD"}, {"STSLICE", "CE"},
+			{"STIX", "CF00"}, {"STUX", "CF01"}, {"STIXR", "CF02"}, {"STUXR", "CF03"},
+			{"STBREF", "CF11"}, {"STB", "CF13"}, {"STREFR", "CF14"}, {"STSLICER", "CF16"}, {"STBR", "CF17"},
+			{"ENDXC", "CF23"}, {"BDEPTH", "CF30"}, {"BBITS", "CF31"}, {"BREFS", "CF32"}, {"BBITREFS", "CF33"},
+			{"BREMBITS", "CF35"}, {"BREMREFS", "CF36"}, {"BREMBITREFS", "CF37"},
+			{"STZEROES", "CF40"}, {"STONES", "CF41"}, {"STSAME", "CF42"}, {"STZERO", "CF81"}, {"STONE", "CF83"},
+			// slices
+			{"CTOS", "D0"}, {"ENDS", "D1"}, {"LDREF", "D4"}, {"LDREFRTOS", "D5"},
+			{"LDIX", "D700"}, {"LDUX", "D701"}, {"PLDIX", "D702"}, {"PLDUX", "D703"},
+			{"LDIXQ", "D704"}, {"LDUXQ", "D705"}, {"PLDIXQ", "D706"}, {"PLDUXQ", "D707"},
+			{"LDSLICEX", "D718"}, {"PLDSLICEX", "D719"}, {"LDSLICEXQ", "D71A"}, {"PLDSLICEXQ", "D71B"},
+			{"SDCUTFIRST", "D720"}, {"SDSKIPFIRST", "D721"}, {"SDCUTLAST", "D722"}, {"SDSKIPLAST", "D723"},
+			{"SDSUBSTR", "D724"}, {"SDBEGINSX", "D726"}, {"SDBEGINSXQ", "D727"},
+			{"SCUTFIRST", "D730"}, {"SSKIPFIRST", "D731"}, {"SCUTLAST", "D732"}, {"SSKIPLAST", "D733"},
+			{"SUBSLICE", "D734"}, {"SPLIT", "D736"}, {"SPLITQ", "D737"},
+			{"SCHKBITS", "D741"}, {"SCHKREFS", "D742"}, {"SCHKBITREFS", "D743"},
+			{"SCHKBITSQ", "D745"}, {"SCHKREFSQ", "D746"}, {"SCHKBITREFSQ", "D747"},
+			{"PLDREFVAR", "D748"}, {"SBITS", "D749"}, {"SREFS", "D74A"}, {"SBITREFS", "D74B"}, {"PLDREF", "D74C"},
+			{"LDZEROES", "D760"}, {"LDONES", "D761"}, {"LDSAME", "D762"}, {"SDEPTH", "D764"}, {"CDEPTH", "D765"},
+			// control flow
+			{"EXECUTE", "D8"}, {"CALLX", "D8"}, {"JMPX", "D9"}, {"RET", "DB30"}, {"RETALT", "DB31"},
+			{"RETBOOL", "DB32"}, {"CALLCC", "DB34"}, {"JMPXDATA", "DB35"},
+			{"IFRET", "DC"}, {"IFNOTRET", "DD"}, {"IF", "DE"}, {"IFNOT", "DF"}, {"IFJMP", "E0"}, {"IFNOTJMP", "E1"},
+			{"IFELSE", "E2"}, {"CONDSEL", "E304"}, {"CONDSELCHK", "E305"}, {"IFRETALT", "E308"}, {"IFNOTRETALT", "E309"},
+			{"REPEAT", "E4"}, {"REPEATEND", "E5"}, {"UNTIL", "E6"}, {"UNTILEND", "E7"}, {"WHILE", "E8"},
+			{"WHILEEND", "E9"}, {"AGAIN", "EA"}, {"AGAINEND", "EB"},
+			{"REPEATBRK", "E314"}, {"REPEATENDBRK", "E315"}, {"UNTILBRK", "E316"}, {"UNTILENDBRK", "E317"},
+			{"WHILEBRK", "E318"}, {"WHILEENDBRK", "E319"}, {"AGAINBRK", "E31A"}, {"AGAINENDBRK", "E31B"},
+			{"BLESS", "ED1E"}, {"BLESSVARARGS", "ED1F"}, {"PUSHROOT", "ED44"}, {"POPROOT", "ED54"},
+			{"COMPOS", "EDF0"}, {"BOOLAND", "EDF0"}, {"COMPOSALT", "EDF1"}, {"BOOLOR", "EDF1"},
+			{"COMPOSBOTH", "EDF2"}, {"ATEXIT", "EDF3"}, {"ATEXITALT", "EDF4"}, {"SETEXITALT", "EDF5"},
+			{"THENRET", "EDF6"}, {"THENRETALT", "EDF7"}, {"INVERT", "EDF8"}, {"BOOLEVAL", "EDF9"},
+			{"SAMEALT", "EDFA"}, {"SAMEALTSAVE", "EDFB"}, {"SETCP0", "FF00"},
+			// exceptions
+			{"THROWANY", "F2F0"}, {"THROWARGANY", "F2F1"}, {"THROWANYIF", "F2F2"}, {"THROWARGANYIF", "F2F3"},
+			{"THROWANYIFNOT", "F2F4"}, {"THROWARGANYIFNOT", "F2F5"}, {"TRY", "F2FF"},
+			// dictionaries
+			{"STDICT", "F400"}, {"STOPTREF", "F400"}, {"SKIPDICT", "F401"}, {"LDDICTS", "F402"},
+			{"PLDDICTS", "F403"}, {"LDDICT", "F404"}, {"LDOPTREF", "F404"}, {"PLDDICT", "F405"},
+			{"LDDICTQ", "F406"}, {"PLDDICTQ", "F407"},
+			{"DICTIGETJMP", "F4A0"}, {"DICTUGETJMP", "F4A1"}, {"DICTIGETEXEC", "F4A2"}, {"DICTUGETEXEC", "F4A3"},
+			// application-specific
+			{"ACCEPT", "F800"}, {"SETGASLIMIT", "F801"}, {"COMMIT", "F80F"}, {"RANDU256", "F810"}, {"RAND", "F811"},
+			{"SETRAND", "F814"}, {"ADDRAND", "F815"}, {"NOW", "F823"}, {"BLOCKLT", "F824"}, {"LTIME", "F825"},
+			{"RANDSEED", "F826"}, {"BALANCE", "F827"}, {"MYADDR", "F828"}, {"CONFIGROOT", "F829"},
+			{"CONFIGDICT", "F830"}, {"CONFIGPARAM", "F832"}, {"CONFIGOPTPARAM", "F833"},
+			{"GETGLOBVAR", "F840"}, {"SETGLOBVAR", "F860"},
+			{"HASHCU", "F900"}, {"HASHSU", "F901"}, {"SHA256U", "F902"}, {"CHKSIGNU", "F910"}, {"CHKSIGNS", "F911"},
+			{"CDATASIZEQ", "F940"}, {"CDATASIZE", "F941"}, {"SDATASIZEQ", "F942"}, {"SDATASIZE", "F943"},
+			{"LDGRAMS", "FA00"}, {"LDVARUINT16", "FA00"}, {"LDVARINT16", "FA01"}, {"STGRAMS", "FA02"},
+			{"STVARUINT16", "FA02"}, {"STVARINT16", "FA03"}, {"LDVARUINT32", "FA04"}, {"LDVARINT32", "FA05"},
+			{"STVARUINT32", "FA06"}, {"STVARINT32", "FA07"},
+			{"LDMSGADDR", "FA40"}, {"LDMSGADDRQ", "FA41"}, {"PARSEMSGADDR", "FA42"}, {"PARSEMSGADDRQ", "FA43"},
+			{"REWRITESTDADDR", "FA44"}, {"REWRITESTDADDRQ", "FA45"}, {"REWRITEVARADDR", "FA46"},
+			{"REWRITEVARADDRQ", "FA47"},
+			{"SENDRAWMSG", "FB00"}, {"RAWRESERVE", "FB02"}, {"RAWRESERVEX", "FB03"}, {"SETCODE", "FB04"},
+			{"SETLIBCODE", "FB06"}, {"CHANGELIB", "FB07"},
+			// debug
+			{"DUMPSTK", "FE00"}, {"HEXDUMP", "FE10"}, {"HEXPRINT", "FE11"}, {"BINDUMP", "FE12"},
+			{"BINPRINT", "FE13"}, {"STRDUMP", "FE14"}, {"STRPRINT", "FE15"},
+		};
+
+		// Dictionary operations come in families that differ in the key kind and in the value kind
+		auto add = [&](std::string const& _name, unsigned _code) {
+			std::ostringstream hex;
+			hex << std::uppercase << std::hex << _code;
+			res.emplace(_name, hex.str());
+		};
+		// DICTGET, DICTGETREF, DICTIGET, DICTIGETREF, DICTUGET, DICTUGETREF
+		for (auto const& [name, code] : std::vector<std::pair<std::string, unsigned>>{
+			{"GET", 0xF40A}, {"SET", 0xF412}, {"SETGET", 0xF41A}, {"REPLACE", 0xF422}, {"REPLACEGET", 0xF42A},
+			{"ADD", 0xF432}, {"ADDGET", 0xF43A}, {"DELGET", 0xF462}, {"MIN", 0xF482}, {"MAX", 0xF48A},
+			{"REMMIN", 0xF492}, {"REMMAX", 0xF49A}
+		}) {
+			add("DICT" + name, code);
+			add("DICT" + name + "REF", code + 1);
+			add("DICTI" + name, code + 2);
+			add("DICTI" + name + "REF", code + 3);
+			add("DICTU" + name, code + 4);
+			add("DICTU" + name + "REF", code + 5);
+		}
+		// DICTSETB, DICTISETB, DICTUSETB
+		for (auto const& [name, code] : std::vector<std::pair<std::string, unsigned>>{
+			{"SETB", 0xF441}, {"SETGETB", 0xF445}, {"REPLACEB", 0xF449}, {"REPLACEGETB", 0xF44D},
+			{"ADDB", 0xF451}, {"ADDGETB", 0xF455}, {"DEL", 0xF459}, {"GETOPTREF", 0xF469}, {"SETGETOPTREF", 0xF46D}
+		}) {
+			add("DICT" + name, code);
+			add("DICTI" + name, code + 1);
+			add("DICTU" + name, code + 2);
+		}
+		for (auto const& [name, code] : std::vector<std::pair<std::string, unsigned>>{
+			{"GETNEXT", 0xF474}, {"GETNEXTEQ", 0xF475}, {"GETPREV", 0xF476}, {"GETPREVEQ", 0xF477}
+		}) {
+			add("DICT" + name, code);
+			add("DICTI" + name, code + 4);
+			add("DICTU" + name, code + 8);
+		}
+		return res;
+	}();
+	return opcodes;
+}
+
+// @returns nullopt if the instruction is unknown
+std::optional<CellBuilder> encode(std::string_view _name, Args const& _args) {
+	size_t const n = _args.size();
+	if (n == 0) {
+		auto it = simpleOpcodes().find(std::string{_name});
+		if (it != simpleOpcodes().end()) {
+			return op(it->second);
+		}
+		return std::nullopt;
+	}
+	auto is = [&](std::string_view _opcode, size_t _argQty) {
+		return _name == _opcode && n == _argQty;
+	};
+	auto arg = [&](size_t _i, int64_t _min, int64_t _max) {
+		return inRange(number(_args.at(_i)), _min, _max);
+	};
+	auto s = [&](size_t _i, int64_t _max = 15, int64_t _shift = 0) {
+		return inRange(reg(_args.at(_i), 'S') + _shift, 0, _max);
+	};
+
+	// stack
+	if (is("XCHG", 1)) return xchg(0, s(0, 255));
+	if (is("XCHG", 2)) return xchg(s(0, 255), s(1, 255));
+	if (is("PUSH", 1) && isReg(_args[0], 'C')) return op(0xED40 | reg(_args[0], 'C'), 16);
+	if (is("POP", 1) && isReg(_args[0], 'C')) return op(0xED50 | reg(_args[0], 'C'), 16);
+	if (is("PUSH", 1)) {
+		int64_t const i = s(0, 255);
+		return i <= 15 ? op(0x20 | i, 8) : op(0x5600 | i, 16);
+	}
+	if (is("POP", 1)) {
+		int64_t const i = s(0, 255);
+		return i <= 15 ? op(0x30 | i, 8) : op(0x5700 | i, 16);
+	}
+	if (is("XCHG2", 2)) return op(0x5000 | s(0) << 4 | s(1), 16);
+	if (is("XCPU", 2)) return op(0x5100 | s(0) << 4 | s(1), 16);
+	if (is("PUXC", 2)) return op(0x5200 | s(0) << 4 | s(1, 15, 1), 16);
+	if (is("PUSH2", 2)) return op(0x5300 | s(0) << 4 | s(1), 16);
+	if (is("XCHG3", 3)) return op(0x4000 | s(0) << 8 | s(1) << 4 | s(2), 16);
+	if (is("XC2PU", 3)) return op(0x541000 | s(0) << 8 | s(1) << 4 | s(2), 24);
+	if (is("XCPUXC", 3)) return op(0x542000 | s(0) << 8 | s(1) << 4 | s(2, 15, 1), 24);
+	if (is("XCPU2", 3)) return op(0x543000 | s(0) << 8 | s(1) << 4 | s(2), 24);
+	if (is("PUXC2", 3)) return op(0x544000 | s(0) << 8 | s(1, 15, 1) << 4 | s(2, 15, 1), 24);
+	if (is("PUXCPU", 3)) return op(0x545000 | s(0) << 8 | s(1, 15, 1) << 4 | s(2, 15, 1), 24);
+	if (is("PU2XC", 3)) return op(0x546000 | s(0) << 8 | s(1, 15, 1) << 4 | s(2, 15, 2), 24);
+	if (is("PUSH3", 3)) return op(0x547000 | s(0) << 8 | s(1) << 4 | s(2), 24);
+	if (is("BLKSWAP", 2)) return op(0x5500 | (arg(0, 1, 16) - 1) << 4 | (arg(1, 1, 16) - 1), 16);
+	if (is("ROLL", 1)) return op(0x5500 | (arg(0, 1, 16) - 1), 16);
+	if (is("ROLLREV", 1)) return op(0x5500 | (arg(0, 1, 16) - 1) << 4, 16);
+	if (is("REVERSE", 2)) return op(0x5E00 | (arg(0, 2, 17) - 2) << 4 | arg(1, 0, 15), 16);
+	if (is("BLKDROP", 1)) return op(0x5F00 | arg(0, 0, 15), 16);
+	if (is("BLKPUSH", 2)) return op(0x5F00 | arg(0, 1, 15) << 4 | arg(1, 0, 15), 16);
+	if (is("BLKDROP2", 2)) return op(0x6C00 | arg(0, 1, 15) << 4 | arg(1, 0, 15), 16);
+
+	// tuples
+	if (is("TUPLE", 1)) return op(0x6F00 | arg(0, 0, 15), 16);
+	if (is("INDEX", 1)) return op(0x6F10 | arg(0, 0, 15), 16);
+	if (is("UNTUPLE", 1)) return op(0x6F20 | arg(0, 0, 15), 16);
+	if (is("UNPACKFIRST", 1)) return op(0x6F30 | arg(0, 0, 15), 16);
+	if (is("EXPLODE", 1)) return op(0x6F40 | arg(0, 0, 15), 16);
+	if (is("SETINDEX", 1)) return op(0x6F50 | arg(0, 0, 15), 16);
+	if (is("INDEXQ", 1)) return op(0x6F60 | arg(0, 0, 15), 16);
+	if (is("SETINDEXQ", 1)) return op(0x6F70 | arg(0, 0, 15), 16);
+	if (is("INDEX2", 2)) return op(0x6FB0 | arg(0, 0, 3) << 2 | arg(1, 0, 3), 16);
+	if (is("INDEX3", 3)) return op(0x6FC0 | arg(0, 0, 3) << 4 | arg(1, 0, 3) << 2 | arg(2, 0, 3), 16);
+
+	// constants
+	if (is("PUSHINT", 1)) {
+		std::string const value{_args[0]};
+		check(!value.empty() && (std::isdigit(value[0]) || value[0] == '-'));
+		return pushInt(bigint(value));
+	}
+	if (is("PUSHPOW2", 1)) return op(0x8300 | (arg(0, 1, 256) - 1), 16);
+	if (is("PUSHPOW2DEC", 1)) return op(0x8400 | (arg(0, 1, 256) - 1), 16);
+	if (is("PUSHNEGPOW2", 1)) return op(0x8500 | (arg(0, 1, 256) - 1), 16);
+	if (is("PUSHSLICE", 1)) return pushSlice(slice(_args[0]));
+
+	// arithmetic and comparison
+	if (is("ADDCONST", 1)) return op(0xA6, 8).storeInt(arg(0, -128, 127), 8);
+	if (is("MULCONST", 1)) return op(0xA7, 8).storeInt(arg(0, -128, 127), 8);
+	if (is("MODPOW2", 1)) return op(0xA93800 | (arg(0, 1, 256) - 1), 24);
+	if (is("LSHIFT", 1)) return op(0xAA00 | (arg(0, 1, 256) - 1), 16);
+	if (is("RSHIFT", 1)) return op(0xAB00 | (arg(0, 1, 256) - 1), 16);
+	if (is("FITS", 1)) return op(0xB400 | (arg(0, 1, 256) - 1), 16);
+	if (is("UFITS", 1)) return op(0xB500 | (arg(0, 1, 256) - 1), 16);
+	if (is("EQINT", 1)) return op(0xC0, 8).storeInt(arg(0, -128, 127), 8);
+	if (is("LESSINT", 1)) return op(0xC1, 8).storeInt(arg(0, -128, 127), 8);
+	if (is("GTINT", 1)) return op(0xC2, 8).storeInt(arg(0, -128, 127), 8);
+	if (is("NEQINT", 1)) return op(0xC3, 8).storeInt(arg(0, -128, 127), 8);
+
+	// cells
+	if (is("STI", 1)) return op(0xCA00 | (arg(0, 1, 256) - 1), 16);
+	if (is("STU", 1)) return op(0xCB00 | (arg(0, 1, 256) - 1), 16);
+	if (is("STIR", 1)) return op(0xCF0A00 | (arg(0, 1, 256) - 1), 24);
+	if (is("STUR", 1)) return op(0xCF0B00 | (arg(0, 1, 256) - 1), 24);
+	if (is("STSLICECONST", 1)) return stSliceConst(slice(_args[0]));
+	if (is("LDI", 1)) return op(0xD200 | (arg(0, 1, 256) - 1), 16);
+	if (is("LDU", 1)) return op(0xD300 | (arg(0, 1, 256) - 1), 16);
+	if (is("LDSLICE", 1)) return op(0xD600 | (arg(0, 1, 256) - 1), 16);
+	if (is("PLDI", 1)) return op(0xD70A00 | (arg(0, 1, 256) - 1), 24);
+	if (is("PLDU", 1)) return op(0xD70B00 | (arg(0, 1, 256) - 1), 24);
+	if (is("LDIQ", 1)) return op(0xD70C00 | (arg(0, 1, 256) - 1), 24);
+	if (is("LDUQ", 1)) return op(0xD70D00 | (arg(0, 1, 256) - 1), 24);
+	if (is("PLDIQ", 1)) return op(0xD70E00 | (arg(0, 1, 256) - 1), 24);
+	if (is("PLDUQ", 1)) return op(0xD70F00 | (arg(0, 1, 256) - 1), 24);
+	if (is("PLDREFIDX", 1)) return op(0xD74C | arg(0, 0, 3), 16);
+
+	// control flow and exceptions
+	if (is("CALL", 1) || is("CALLDICT", 1)) {
+		int64_t const id = arg(0, 0, (1 << 14) - 1);
+		return id < 256 ? op(0xF000 | id, 16) : op(0xF10000 | id, 24);
+	}
+	auto exception = [&](uint64_t _short, uint64_t _long) {
+		int64_t const code = arg(0, 0, 2047);
+		return code < 64 ? op(_short | code, 16) : op(_long | code, 24);
+	};
+	if (is("THROW", 1)) return exception(0xF200, 0xF2C000);
+	if (is("THROWIF", 1)) return exception(0xF240, 0xF2D000);
+	if (is("THROWIFNOT", 1)) return exception(0xF280, 0xF2E000);
+	if (is("THROWARG", 1)) return op(0xF2C800 | arg(0, 0, 2047), 24);
+	if (is("THROWARGIF", 1)) return op(0xF2D800 | arg(0, 0, 2047), 24);
+	if (is("THROWARGIFNOT", 1)) return op(0xF2E800 | arg(0, 0, 2047), 24);
+
+	// application-specific
+	if (is("GETPARAM", 1)) return op(0xF820 | arg(0, 0, 15), 16);
+	if (is("GETGLOB", 1)) return op(0xF840 | arg(0, 1, 31), 16);
+	if (is("SETGLOB", 1)) return op(0xF860 | arg(0, 1, 31), 16);
+
+	return std::nullopt;
+}
+
+} // end anonymous namespace
+
+TvmAssembler::TvmAssembler(TvmSourceMap& _sourceMap) :
+	m_printer{m_text},
+	m_sourceMap{_sourceMap}
+{
+}
+
+void TvmAssembler::addLibrary(std::string const& _source) {
+	Definition* current = nullptr;
+	for (std::string const& line : split(_source)) {
+		std::string_view const s = trim(line);
+		auto name = [&](std::string_view _directive) {
+			return std::string{trim(s.substr(_directive.size()))};
+		};
+		if (boost::starts_with(s, ".globl")) {
+			current = &m_definitions[name(".globl")];
+			*current = Definition{nullptr, {}, false};
+		} else if (boost::starts_with(s, ".macro")) {
+			current = &m_definitions[name(".macro")];
+			*current = Definition{nullptr, {}, true};
+		} else if (boost::starts_with(s, ".type")) {
+			continue;
+		} else if (current) {
+			current->lines.push_back(line);
+		}
+	}
+}
+
+CellPtr TvmAssembler::assemble(Contract& _contract) {
+	std::map<Function::FunctionType, Function*> entries;
+	for (Pointer<Function> const& f : _contract.functions()) {
+		switch (f->type()) {
+			case Function::FunctionType::PrivateFunction:
+				m_definitions[f->name()] = Definition{f.get(), {}, false};
+				break;
+			case Function::FunctionType::Macro:
+			case Function::FunctionType::MacroGetter:
+				m_definitions[f->name()] = Definition{f.get(), {}, true};
+				break;
+			default:
+				entries[f->type()] = f.get();
+				break;
+		}
+	}
+
+	std::map<Function::FunctionType, CellPtr> entryCells;
+	for (auto const& [type, f] : entries) {
+		entryCells[type] = pack(assembleDefinition(f->name(), Definition{f, {}, false}));
+	}
+
+	// The selector in c3 jumps to the function by its id, the small ones are stored right in the dictionary
+	std::map<uint64_t, CellBuilder> functions;
+	std::map<uint64_t, CellPtr> inlinedFunctions;
+	auto addFunction = [&](int _id, CellPtr const& _body) {
+		size_t const maxLabel = 2 + 6 + 32;
+		if (_body->bitSize() + maxLabel <= Cell::MaxBits) {
+			functions[_id].append(*_body);
+			inlinedFunctions[_id] = _body;
+		} else {
+			functions[_id] = withRef("DB3D", _body); // JMPREF
+		}
+	};
+	if (auto it = entryCells.find(Function::FunctionType::OnCodeUpgrade); it != entryCells.end()) {
+		addFunction(functionId(":onCodeUpgrade"), it->second);
+	}
+	while (!m_pendingFunctions.empty()) {
+		std::string const name = m_pendingFunctions.back();
+		m_pendingFunctions.pop_back();
+		addFunction(m_functionIds.at(name), pack(assembleDefinition(name, m_definitions.at(name))));
+	}
+	// The inlined bodies are at the end of the leaves
+	auto markLeaf = [&](uint64_t _key, Cell const& _leaf) {
+		auto it = inlinedFunctions.find(_key);
+		if (it == inlinedFunctions.end()) {
+			return;
+		}
+		if (std::vector<TvmSourceMap::Mark> const* marks = m_sourceMap.marks(it->second->hash())) {
+			std::vector<TvmSourceMap::Mark> leafMarks = *marks;
+			for (TvmSourceMap::Mark& m : leafMarks) {
+				m.offset += _leaf.bitSize() - it->second->bitSize();
+			}
+			m_sourceMap.addCell(_leaf.hash(), std::move(leafMarks));
+		}
+	};
+	CellBuilder selector;
+	if (!functions.empty()) {
+		selector
+			.storeHex(TvmConst::Selector::PrivateOpcode0())
+			.storeBit(true)
+			.storeRef(buildDictionary(functions, 32, markLeaf))
+			.storeUInt(32, 10)
+			.storeHex(TvmConst::Selector::PrivateOpcode1());
+	}
+	CellPtr const selectorCell = selector.build();
+
+	// The function id is left on the stack for the entry points, as the linker does
+	Code root{{instruction("SETCP0"), {}}, {withRef("8A", selectorCell), {}}, {instruction("POP C3"), {}}};
+	if (auto it = entryCells.find(Function::FunctionType::MainInternal); it != entryCells.end()) {
+		root.push_back({instruction("DUP"), {}});
+		root.push_back({withRef("E303", it->second), {}}); // IFNOTJMPREF
+	}
+	if (auto it = entryCells.find(Function::FunctionType::MainExternal); it != entryCells.end()) {
+		root.push_back({instruction("DUP"), {}});
+		root.push_back({instruction("EQINT -1"), {}});
+		root.push_back({withRef("E302", it->second), {}}); // IFJMPREF
+	}
+	if (auto it = entryCells.find(Function::FunctionType::OnTickTock); it != entryCells.end()) {
+		root.push_back({instruction("DUP"), {}});
+		root.push_back({instruction("EQINT -2"), {}});
+		root.push_back({withRef("E302", it->second), {}}); // IFJMPREF
+	}
+	// Other ids, e.g. onCodeUpgrade called by the previous code
+	root.push_back({withRef("DB3D", selectorCell), {}}); // JMPREF
+	CellPtr rootCell = pack(root);
+
+	std::vector<std::string> const& pragmas = _contract.pragmas();
+	if (std::find(pragmas.begin(), pragmas.end(), ".pragma selector-save-my-code") != pragmas.end()) {
+		Code saveMyCode{
+			{instruction("DUP"), {}},
+			{instruction("SETGLOB 1"), {}},
+			{instruction("BLESS"), {}},
+			{instruction("JMPX"), {}}
+		};
+		rootCell = CellBuilder()
+			.storeHex(TvmConst::Selector::RootCodeCell())
+			.storeRef(pack(saveMyCode))
+			.storeRef(rootCell)
+			.build();
+	}
+	return rootCell;
+}
+
+bool TvmAssembler::visit(AsymGen &_node) { return assembleLeaf(_node); }
+bool TvmAssembler::visit(DeclRetFlag &_node) { return assembleLeaf(_node); }
+bool TvmAssembler::visit(HardCode &_node) { return assembleLeaf(_node); }
+bool TvmAssembler::visit(TvmReturn &_node) { return assembleLeaf(_node); }
+bool TvmAssembler::visit(TvmException &_node) { return assembleLeaf(_node); }
+bool TvmAssembler::visit(GenOpcode &_node) { return assembleLeaf(_node); }
+bool TvmAssembler::visit(PushCellOrSlice &_node) { return assembleLeaf(_node); }
+bool TvmAssembler::visit(Glob &_node) { return assembleLeaf(_node); }
+bool TvmAssembler::visit(Stack &_node) { return assembleLeaf(_node); }
+
+bool TvmAssembler::visit(Loc &/*_node*/) {
+	return false;
+}
+
+bool TvmAssembler::visit(Opaque &_node) {
+	_node.block()->accept(*this);
+	return false;
+}
+
+bool TvmAssembler::visit(ReturnOrBreakOrCont &_node) {
+	_node.body()->accept(*this);
+	return false;
+}
+
+// The instruction indexes are taken in the order of the lines printed by Printer
+bool TvmAssembler::visit(CodeBlock &_node) {
+	switch (_node.type()) {
+		case CodeBlock::Type::None:
+			for (Pointer<TvmAstNode> const& inst : _node.instructions()) {
+				inst->accept(*this);
+			}
+			break;
+		case CodeBlock::Type::PUSHCONT: {
+			int const index = nextIndex();
+			m_code->push_back(pushCont(assembleInstructions(_node), index));
+			break;
+		}
+		case CodeBlock::Type::PUSHREFCONT: {
+			int const index = nextIndex();
+			m_code->push_back(at(index, withRef("8A", pack(assembleInstructions(_node)))));
+			break;
+		}
+	}
+	return false;
+}
+
+bool TvmAssembler::visit(SubProgram &_node) {
+	int const index = nextIndex();
+	switch (_node.type()) {
+		case SubProgram::Type::CALLX:
+			m_code->push_back(pushCont(assembleNode(*_node.block()), index));
+			m_code->push_back(at(nextIndex(), instruction("CALLX")));
+			break;
+		case SubProgram::Type::CALLREF:
+			m_code->push_back(at(index, withRef("DB3C", pack(assembleNode(*_node.block())))));
+			break;
+	}
+	return false;
+}
+
+bool TvmAssembler::visit(TvmCondition &_node) {
+	_node.trueBody()->accept(*this);
+	_node.falseBody()->accept(*this);
+	m_code->push_back(at(nextIndex(), instruction("IFELSE")));
+	return false;
+}
+
+bool TvmAssembler::visit(LogCircuit &_node) {
+	int const index = nextIndex();
+	m_code->push_back(pushCont(assembleNode(*_node.body()), index));
+	m_code->push_back(at(nextIndex(), instruction(_node.type() == LogCircuit::Type::AND ? "IF" : "IFNOT")));
+	return false;
+}
+
+bool TvmAssembler::visit(TvmIfElse &_node) {
+	std::string_view refOpcode;
+	switch (_node.type()) {
+		case TvmIfElse::Type::IFREF:
+			refOpcode = "E300";
+			break;
+		case TvmIfElse::Type::IFNOTREF:
+			refOpcode = "E301";
+			break;
+		case TvmIfElse::Type::IFJMPREF:
+			refOpcode = "E302";
+			break;
+		case TvmIfElse::Type::IFNOTJMPREF:
+			refOpcode = "E303";
+			break;
+		default:
+			break;
+	}
+	if (!refOpcode.empty()) {
+		int const index = nextIndex();
+		m_code->push_back(at(index, withRef(refOpcode, pack(assembleInstructions(*_node.trueBody())))));
+		return false;
+	}
+
+	_node.trueBody()->accept(*this);
+	if (_node.falseBody()) {
+		_node.falseBody()->accept(*this);
+	}
+	switch (_node.type()) {
+		case TvmIfElse::Type::IF:
+			m_code->push_back(at(nextIndex(), instruction("IF")));
+			break;
+		case TvmIfElse::Type::IFNOT:
+			m_code->push_back(at(nextIndex(), instruction("IFNOT")));
+			break;
+		case TvmIfElse::Type::IFJMP:
+			m_code->push_back(at(nextIndex(), instruction("IFJMP")));
+			break;
+		case TvmIfElse::Type::IFNOTJMP:
+			m_code->push_back(at(nextIndex(), instruction("IFNOTJMP")));
+			break;
+		case TvmIfElse::Type::IFELSE:
+			m_code->push_back(at(nextIndex(), instruction("IFELSE")));
+			break;
+		case TvmIfElse::Type::IFELSE_WITH_JMP:
+			m_code->push_back(at(nextIndex(), instruction("CONDSEL")));
+			m_code->push_back(at(nextIndex(), instruction("JMPX")));
+			break;
+		default:
+			solUnimplemented("");
+	}
+	return false;
+}
+
+bool TvmAssembler::visit(TvmRepeat &_node) {
+	_node.body()->accept(*this);
+	m_code->push_back(at(nextIndex(), instruction("REPEAT")));
+	return false;
+}
+
+bool TvmAssembler::visit(TvmUntil &_node) {
+	_node.body()->accept(*this);
+	m_code->push_back(at(nextIndex(), instruction("UNTIL")));
+	return false;
+}
+
+bool TvmAssembler::visit(While &_node) {
+	_node.condition()->accept(*this);
+	_node.body()->accept(*this);
+	m_code->push_back(at(nextIndex(), instruction("WHILE")));
+	return false;
+}
+
+bool TvmAssembler::visitNode(TvmAstNode const&) {
+	solUnimplemented("");
+}
+
+bool TvmAssembler::assembleLeaf(TvmAstNode& _node) {
+	_node.accept(m_printer);
+	m_printer.flush();
+	std::vector<std::string> const lines = split(m_text.str());
+	m_text.str({});
+	assembleText(lines, *m_code);
+	return false;
+}
+
+TvmAssembler::Code TvmAssembler::assembleNode(TvmAstNode& _node) {
+	Code code;
+	Code* const saved = m_code;
+	m_code = &code;
+	_node.accept(*this);
+	m_code = saved;
+	return code;
+}
+
+TvmAssembler::Code TvmAssembler::assembleInstructions(CodeBlock& _block) {
+	Code code;
+	Code* const saved = m_code;
+	m_code = &code;
+	for (Pointer<TvmAstNode> const& inst : _block.instructions()) {
+		inst->accept(*this);
+	}
+	m_code = saved;
+	return code;
+}
+
+void TvmAssembler::assembleText(std::vector<std::string> const& _lines, Code& _code) {
+	size_t pos = 0;
+	if (assembleLines(_lines, pos, _code)) {
+		fatal_error("Unexpected '}' in the assembly: " + _lines.at(pos - 1));
+	}
+}
+
+bool TvmAssembler::assembleLines(std::vector<std::string> const& _lines, size_t& _pos, Code& _code) {
+	while (_pos < _lines.size()) {
+		std::string_view line = _lines[_pos++];
+		line = trim(line.substr(0, line.find(';')));
+		if (line.empty()) {
+			continue;
+		}
+		if (boost::starts_with(line, ".loc")) {
+			// .loc file, line
+			std::string_view const loc = line.substr(4);
+			size_t const comma = loc.rfind(',');
+			if (m_librarySpans && comma != std::string_view::npos) {
+				std::string_view const lineNo = trim(loc.substr(comma + 1));
+				m_librarySpan = TvmSourceMap::Span{Loc::fileId(std::string{trim(loc.substr(0, comma))}), -1, -1, 0, 0};
+				std::from_chars(lineNo.data(), lineNo.data() + lineNo.size(), m_librarySpan.line);
+			}
+			continue;
+		}
+		if (line == "}") {
+			return true;
+		}
+		if (line.back() == '{') {
+			std::string_view const head = trim(line.substr(0, line.size() - 1));
+			// Directives, e.g. .cell, are not instructions
+			int const index = boost::starts_with(head, ".") ? -1 : nextIndex();
+			Code body;
+			if (!assembleLines(_lines, _pos, body)) {
+				fatal_error("Missing '}' in the assembly after: " + std::string{line});
+			}
+			_code.push_back(block(head, body, index));
+		} else if (boost::starts_with(line, ".blob")) {
+			std::string_view const blob = trim(line.substr(5));
+			if (blob.empty() || blob[0] != 'x') {
+				fatal_error("Unsupported blob in the assembly: " + std::string{line});
+			}
+			CellBuilder b;
+			b.storeHex(blob.substr(1));
+			_code.push_back({b, {}});
+		} else {
+			assembleInstruction(line, nextIndex(), _code);
+		}
+	}
+	return false;
+}
+
+void TvmAssembler::assembleInstruction(std::string_view _line, int _index, Code& _code) {
+	// Calls and pushes of function ids, e.g. CALL $name$ or PUSHINT $name$
+	size_t const begin = _line.find('$');
+	if (begin != std::string_view::npos) {
+		size_t const end = _line.find('$', begin + 1);
+		std::string_view const opcode = trim(_line.substr(0, begin));
+		if (end == std::string_view::npos || !isIn(opcode, "CALL", "PUSHINT")) {
+			fatal_error("Cannot assemble the instruction: " + std::string{_line});
+		}
+		std::string const name{_line.substr(begin + 1, end - begin - 1)};
+		auto it = m_definitions.find(name);
+		if (opcode == "CALL" && it != m_definitions.end() && it->second.isMacro) {
+			// The macro is inlined into the current frame by this call
+			for (Instruction inst : macro(name)) {
+				for (TvmSourceMap::Mark& m : inst.marks) {
+					m.frame = m_sourceMap.rebase(m.frame, m_frame, _index);
+				}
+				_code.push_back(std::move(inst));
+			}
+		} else {
+			_code.push_back(at(_index, instruction(std::string{opcode} + " " + std::to_string(functionId(name)))));
+		}
+		return;
+	}
+	_code.push_back(at(_index, instruction(_line)));
+}
+
+TvmAssembler::Code const& TvmAssembler::macro(std::string const& _name) {
+	auto it = m_macros.find(_name);
+	if (it != m_macros.end()) {
+		return it->second;
+	}
+	if (!m_expandingMacros.insert(_name).second) {
+		fatal_error("Recursive macro: " + _name);
+	}
+	Code code = assembleDefinition(_name, m_definitions.at(_name));
+	m_expandingMacros.erase(_name);
+	return m_macros.emplace(_name, std::move(code)).first->second;
+}
+
+int TvmAssembler::functionId(std::string const& _name) {
+	if (_name == ":onCodeUpgrade") {
+		return 2;
+	}
+	auto it = m_functionIds.find(_name);
+	if (it != m_functionIds.end()) {
+		return it->second;
+	}
+	auto def = m_definitions.find(_name);
+	if (def == m_definitions.end()) {
+		fatal_error("Function is not defined: " + _name + ". Specify the library with --tvm-lib.");
+	}
+	if (def->second.isMacro) {
+		fatal_error("Macro can't be called by id: " + _name);
+	}
+	// 0, -1, -2 and 2 are taken by the entry points
+	int const id = 3 + static_cast<int>(m_functionIds.size());
+	m_functionIds.emplace(_name, id);
+	m_pendingFunctions.push_back(_name);
+	return id;
+}
+
+TvmAssembler::Code TvmAssembler::assembleDefinition(std::string const& _name, Definition const& _definition) {
+	// Each definition starts its own outermost frame, macros are rebased when they are inlined
+	int const function = m_sourceMap.function(_name);
+	int const savedFrame = m_frame;
+	int const savedIndex = m_index;
+	std::vector<TvmSourceMap::Span>* const savedSpans = m_librarySpans;
+	TvmSourceMap::Span const savedSpan = m_librarySpan;
+	m_frame = m_sourceMap.frame({function, -1, -1});
+	m_index = 0;
+	m_librarySpan = {};
+
+	Code code;
+	if (_definition.function) {
+		m_librarySpans = nullptr;
+		code = assembleNode(*_definition.function->block());
+	} else {
+		std::vector<TvmSourceMap::Span> spans;
+		m_librarySpans = &spans;
+		assembleText(_definition.lines, code);
+		m_sourceMap.addSpans(function, std::move(spans));
+	}
+
+	m_frame = savedFrame;
+	m_index = savedIndex;
+	m_librarySpans = savedSpans;
+	m_librarySpan = savedSpan;
+	return code;
+}
+
+int TvmAssembler::nextIndex() {
+	if (m_librarySpans) {
+		m_librarySpans->push_back(m_librarySpan);
+	}
+	return m_index++;
+}
+
+TvmAssembler::Instruction TvmAssembler::at(int _index, CellBuilder _bits) const {
+	Instruction res{std::move(_bits), {}};
+	if (_index >= 0) {
+		res.marks.push_back({0, m_frame, _index});
+	}
+	return res;
+}
+
+CellBuilder TvmAssembler::instruction(std::string_view _line) {
+	size_t const space = _line.find_first_of(" \t");
+	std::string_view const name = _line.substr(0, space);
+	Args args;
+	if (space != std::string_view::npos) {
+		std::string_view rest = _line.substr(space);
+		while (!rest.empty()) {
+			size_t const comma = rest.find(',');
+			args.push_back(trim(rest.substr(0, comma)));
+			rest = comma == std::string_view::npos ? std::string_view{} : rest.substr(comma + 1);
+		}
+		if (args.size() == 1 && args[0].empty()) {
+			args.clear();
+		}
+	}
+	try {
+		if (std::optional<CellBuilder> res = encode(name, args)) {
+			return *res;
+		}
+	} catch (BadArgument const&) {
+		fatal_error("Cannot assemble the instruction, bad argument: " + std::string{_line});
+	}
+	fatal_error("Cannot assemble the instruction, unknown opcode: " + std::string{_line});
+}
+
+TvmAssembler::Instruction TvmAssembler::block(std::string_view _opcode, Code const& _body, int _index) {
+	if (_opcode == "PUSHCONT") {
+		return pushCont(_body, _index);
+	}
+	if (_opcode == "PUSHREF") return at(_index, withRef("88", dataCell(_body)));
+	if (_opcode == "PUSHREFSLICE") return at(_index, withRef("89", dataCell(_body)));
+	if (_opcode == ".cell") return at(_index, withRef("", dataCell(_body)));
+	if (_opcode == "PUSHREFCONT") return at(_index, withRef("8A", pack(_body)));
+	if (_opcode == "CALLREF") return at(_index, withRef("DB3C", pack(_body)));
+	if (_opcode == "IFREF") return at(_index, withRef("E300", pack(_body)));
+	if (_opcode == "IFNOTREF") return at(_index, withRef("E301", pack(_body)));
+	if (_opcode == "IFJMPREF") return at(_index, withRef("E302", pack(_body)));
+	if (_opcode == "IFNOTJMPREF") return at(_index, withRef("E303", pack(_body)));
+	fatal_error("Cannot assemble the block: " + std::string{_opcode});
+}
+
+CellBuilder TvmAssembler::withRef(std::string_view _opcode, CellPtr _cell) {
+	CellBuilder b;
+	b.storeHex(_opcode).storeRef(std::move(_cell));
+	return b;
+}
+
+TvmAssembler::Instruction TvmAssembler::pushCont(Code const& _body, int _index) {
+	Instruction body;
+	for (Instruction const& inst : _body) {
+		append(body, inst);
+	}
+	size_t const bits = body.bits.bitSize();
+	size_t const refs = body.bits.refs().size();
+	CellBuilder head;
+	if (bits % 8 == 0 && refs == 0 && bits <= 15 * 8) {
+		head.storeUInt(0x9, 4).storeUInt(bits / 8, 4);
+	} else if (bits % 8 == 0 && refs <= 3 && bits <= 127 * 8) {
+		head.storeUInt(0x47, 7).storeUInt(refs, 2).storeUInt(bits / 8, 7);
+	} else {
+		return at(_index, withRef("8A", pack(_body)));
+	}
+	Instruction res = at(_index, head);
+	append(res, body);
+	return res;
+}
+
+CellPtr TvmAssembler::pack(Code const& _code) {
+	// Ranges of the instructions that go to the same cell. A cell that is not the last one
+	// needs a free reference for the next cell, the VM jumps there when the bits are over.
+	std::vector<std::pair<size_t, size_t>> chunks;
+	size_t begin = 0;
+	while (true) {
+		size_t bits = 0;
+		size_t refs = 0;
+		size_t end = begin;
+		for (; end < _code.size(); ++end) {
+			bool const isLast = end + 1 == _code.size();
+			size_t const newBits = bits + _code[end].bits.bitSize();
+			size_t const newRefs = refs + _code[end].bits.refs().size();
+			if (newBits > Cell::MaxBits || newRefs + (isLast ? 0 : 1) > Cell::MaxRefs) {
+				break;
+			}
+			bits = newBits;
+			refs = newRefs;
+		}
+		solAssert(end > begin || _code.empty(), "Instruction doesn't fit into a cell");
+		chunks.emplace_back(begin, end);
+		if (end == _code.size()) {
+			break;
+		}
+		begin = end;
+	}
+
+	CellPtr next;
+	for (auto it = chunks.rbegin(); it != chunks.rend(); ++it) {
+		Instruction cell;
+		for (size_t i = it->first; i < it->second; ++i) {
+			append(cell, _code[i]);
+		}
+		if (next) {
+			cell.bits.storeRef(next);
+		}
+		next = cell.bits.build();
+		m_sourceMap.addCell(next->hash(), std::move(cell.marks));
+	}
+	return next;
+}
+
+CellPtr TvmAssembler::dataCell(Code const& _data) {
+	CellBuilder cell;
+	for (Instruction const& piece : _data) {
+		cell.append(piece.bits);
+	}
+	if (cell.bitSize() > Cell::MaxBits || cell.refs().size() > Cell::MaxRefs) {
+		fatal_error("Cell overflow in the assembly");
+	}
+	return cell.build();
+}
+
+void TvmAssembler::append(Instruction& _to, Instruction const& _from) {
+	for (TvmSourceMap::Mark m : _from.marks) {
+		m.offset += _to.bits.bitSize();
+		_to.marks.push_back(m);
+	}
+	_to.bits.append(_from.bits);
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright 2018-2021 TON DEV SOLUTIONS LTD.
+ *
+ * Licensed under the  terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License.
+ *
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the  GNU General Public License for more details at: https://www.gnu.org/licenses/gpl-3.0.html
+ */
+/**
+ * @author TON Labs <connect@tonlabs.io>
+ * @date 2021
+ * Assembler of the TVM AST into a code cell
+ */
+
+#pragma once
+
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <libsolidity/codegen/TvmAstVisitor.hpp>
+#include <libsolidity/codegen/TvmCell.hpp>
+#include <libsolidity/codegen/TvmSourceMap.hpp>
+
+namespace solidity::frontend
+{
+	// Encodes the final TVM AST of a contract into cells, without the textual assembly and the linker.
+	// Function calls are resolved the way the linker does it: macros are inlined, other functions are
+	// put into the dictionary of the selector that is stored in c3.
+	// The code cells are marked in the source map with the instructions of the functions they consist of.
+	class TvmAssembler : public TvmAstVisitor {
+	public:
+		explicit TvmAssembler(TvmSourceMap& _sourceMap);
+		// Adds the functions of a library in the textual assembly, e.g. stdlib_sol.tvm.
+		// The functions of the contract take precedence over the library ones with the same name.
+		void addLibrary(std::string const& _source);
+		// @returns the code cell of the contract. There is no data cell, so this is not a StateInit
+		// that can be deployed, and the cells do not match the ones of the linker bit for bit.
+		CellPtr assemble(Contract& _contract);
+		// @returns the encoding of a single line of the textual assembly, e.g. "PUSHINT 5"
+		static CellBuilder instruction(std::string_view _line);
+
+		bool visit(AsymGen &_node) override;
+		bool visit(DeclRetFlag &_node) override;
+		bool visit(Opaque &_node) override;
+		bool visit(HardCode &_node) override;
+		bool visit(Loc &_node) override;
+		bool visit(TvmReturn &_node) override;
+		bool visit(ReturnOrBreakOrCont &_node) override;
+		bool visit(TvmException &_node) override;
+		bool visit(GenOpcode &_node) override;
+		bool visit(PushCellOrSlice &_node) override;
+		bool visit(Glob &_node) override;
+		bool visit(Stack &_node) override;
+		bool visit(CodeBlock &_node) override;
+		bool visit(SubProgram &_node) override;
+		bool visit(TvmCondition &_node) override;
+		bool visit(LogCircuit &_node) override;
+		bool visit(TvmIfElse &_node) override;
+		bool visit(TvmRepeat &_node) override;
+		bool visit(TvmUntil &_node) override;
+		bool visit(While &_node) override;
+	protected:
+		bool visitNode(TvmAstNode const&) override;
+	private:
+		// Encoded instruction that must be put into a single cell, with the marks of the instructions
+		// of the functions it consists of, e.g. the body of PUSHCONT
+		struct Instruction {
+			CellBuilder bits;
+			std::vector<TvmSourceMap::Mark> marks;
+		};
+		using Code = std::vector<Instruction>;
+		struct Definition {
+			Function* function{}; // function of the contract
+			std::vector<std::string> lines; // or function of a library
+			bool isMacro{};
+		};
+
+		// Leaf nodes are printed and assembled from the text, so that both backends choose the same instructions
+		bool assembleLeaf(TvmAstNode& _node);
+		Code assembleNode(TvmAstNode& _node);
+		Code assembleInstructions(CodeBlock& _block);
+		void assembleText(std::vector<std::string> const& _lines, Code& _code);
+		// @returns true if stopped at the closing brace
+		bool assembleLines(std::vector<std::string> const& _lines, size_t& _pos, Code& _code);
+		void assembleInstruction(std::string_view _line, int _index, Code& _code);
+		Code const& macro(std::string const& _name);
+		int functionId(std::string const& _name);
+		Code assembleDefinition(std::string const& _name, Definition const& _definition);
+		// @returns the index of the next instruction of the current function
+		int nextIndex();
+		// @returns the instruction with the index @a _index of the current function
+		Instruction at(int _index, CellBuilder _bits) const;
+
+		Instruction block(std::string_view _opcode, Code const& _body, int _index);
+		static CellBuilder withRef(std::string_view _opcode, CellPtr _cell);
+		Instruction pushCont(Code const& _body, int _index);
+		// Puts the instructions into a chain of cells, the last reference of a cell is the next one
+		CellPtr pack(Code const& _code);
+		// Puts the data into a single cell
+		static CellPtr dataCell(Code const& _data);
+		static void append(Instruction& _to, Instruction const& _from);
+	private:
+		std::ostringstream m_text;
+		Printer m_printer;
+		TvmSourceMap& m_sourceMap;
+		Code* m_code{};
+		// Frame of the function that is being assembled and the number of its instructions so far
+		int m_frame{-1};
+		int m_index{};
+		// Spans from the .loc directives of a library function, nullptr for the contract functions
+		std::vector<TvmSourceMap::Span>* m_librarySpans{};
+		TvmSourceMap::Span m_librarySpan;
+		std::map<std::string, Definition> m_definitions;
+		std::map<std::string, Code> m_macros;
+		std::set<std::string> m_expandingMacros;
+		std::map<std::string, int> m_functionIds;
+		std::vector<std::string> m_pendingFunctions;
+	};
+}	// end solidity::frontend
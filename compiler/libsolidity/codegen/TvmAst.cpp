@@ -16,6 +16,8 @@
  * TVM Solidity abstract syntax tree.
  */
 
+#include <deque>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 
@@ -32,6 +34,38 @@ void Loc::accept(TvmAstVisitor& _visitor) {
 	_visitor.visit(*this);
 }
 
+namespace {
+	// Contracts can be compiled on several threads, so the table is shared and locked.
+	// Names are never removed, and a deque keeps the returned references valid as it grows.
+	struct LocFileNames {
+		std::mutex mutex;
+		std::deque<std::string> names;
+		std::unordered_map<std::string, int> ids;
+	};
+
+	LocFileNames& locFileNames() {
+		static LocFileNames table;
+		return table;
+	}
+}
+
+int Loc::fileId(std::string const& file) {
+	LocFileNames& table = locFileNames();
+	std::lock_guard<std::mutex> lock{table.mutex};
+	auto it = table.ids.find(file);
+	if (it == table.ids.end()) {
+		it = table.ids.emplace(file, table.names.size()).first;
+		table.names.push_back(file);
+	}
+	return it->second;
+}
+
+std::string const& Loc::fileName(int fileId) {
+	LocFileNames& table = locFileNames();
+	std::lock_guard<std::mutex> lock{table.mutex};
+	return table.names.at(fileId);
+}
+
 Stack::Stack(Stack::Opcode opcode, int i, int j, int k) : m_opcode{opcode}, m_i{i}, m_j{j}, m_k{k}
 {
 }
@@ -455,6 +489,7 @@ Pointer<GenOpcode> gen(const std::string& cmd) {
 		{"NEQ", {2, 1, true}},
 		{"OR", {2, 1, true}},
 		{"PAIR", {2, 1, true}},
+		{"PLDREFVAR", {2, 1}},
 		{"SCHKBITSQ", {2, 1, true}},
 		{"SCHKREFSQ", {2, 1, true}},
 		{"SDEQ", {2, 1, true}},
@@ -20,6 +20,7 @@
 
 #include <memory>
 #include <optional>
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -51,13 +52,25 @@ namespace solidity::frontend
 
 	class Loc : public Inst {
 	public:
-		explicit Loc(std::string  _file, int _line) : m_file{std::move(_file)}, m_line{_line} { }
+		// Source range [_start, _end) in bytes, -1 if unknown. The column is 1-based, as the line.
+		Loc(int _fileId, int _line, int _column, int _start, int _end) :
+			m_fileId{_fileId}, m_line{_line}, m_column{_column}, m_start{_start}, m_end{_end} { }
 		void accept(TvmAstVisitor& _visitor) override;
-		std::string const& file() const { return m_file; }
+		int fileId() const { return m_fileId; }
+		std::string const& file() const { return fileName(m_fileId); }
 		int line() const { return m_line; }
+		int column() const { return m_column; }
+		int start() const { return m_start; }
+		int end() const { return m_end; }
+		// File names are interned, so every node keeps only the id of the name
+		static int fileId(std::string const& file);
+		static std::string const& fileName(int fileId);
 	private:
-		std::string m_file;
+		int m_fileId;
 		int m_line;
+		int m_column;
+		int m_start;
+		int m_end;
 	};
 
 	class Stack : public Inst {
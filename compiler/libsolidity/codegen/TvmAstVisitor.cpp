@@ -22,18 +22,20 @@
 #include <libsolidity/codegen/TvmAstVisitor.hpp>
 #include <liblangutil/Exceptions.h>
 #include "TVMCommons.hpp"
+#include "TVMConstants.hpp"
+#include "TvmCell.hpp"
 
 using namespace solidity::frontend;
 
 bool Printer::visit(AsymGen &_node) {
 	tabs();
-	m_out << _node.opcode() << std::endl;
+	m_out << _node.opcode() << '\n';
 	return false;
 }
 
 bool Printer::visit(DeclRetFlag &/*_node*/) {
 	tabs();
-	m_out << "FALSE ; decl return flag" << std::endl;
+	m_out << "FALSE ; decl return flag\n";
 	return false;
 }
 
@@ -45,7 +47,7 @@ bool Printer::visit(Opaque &_node) {
 bool Printer::visit(HardCode &_node) {
 	for (const std::string& s : _node.code()) {
 		tabs();
-		m_out << s << std::endl;
+		m_out << s << '\n';
 	}
 	return false;
 }
@@ -55,7 +57,7 @@ bool Printer::visit(HardCode &_node) {
 
 bool Printer::visit(Loc &_node) {
 	tabs();
-	m_out << ".loc " << _node.file() << ", " << _node.line() << std::endl;
+	m_out << ".loc " << _node.file() << ", " << _node.line() << '\n';
 	return false;
 }
 
@@ -78,41 +80,42 @@ bool Printer::visit(TvmReturn &_node) {
 
 bool Printer::visit(ReturnOrBreakOrCont &_node) {
 	tabs();
-	m_out << "; start return" << std::endl;
+	m_out << "; start return\n";
 	_node.body()->accept(*this);
 	tabs();
-	m_out << "; end return" << std::endl;
+	m_out << "; end return\n";
 	return false;
 }
 
 bool Printer::visit(TvmException &_node) {
 	tabs();
-	m_out << _node.fullOpcode() << std::endl;
+	m_out << _node.fullOpcode() << '\n';
 	return false;
 }
 
 bool Printer::visit(GenOpcode &_node) {
 	tabs();
-	if (_node.fullOpcode() == "BITNOT") m_out << "NOT";
-	else if (_node.fullOpcode() == "TUPLE 1") m_out << "SINGLE";
-	else if (_node.fullOpcode() == "TUPLE 2") m_out << "PAIR";
-	else if (_node.fullOpcode() == "TUPLE 3") m_out << "TRIPLE";
-	else if (_node.fullOpcode() == "UNTUPLE 1") m_out << "UNSINGLE";
-	else if (_node.fullOpcode() == "UNTUPLE 2") m_out << "UNPAIR";
-	else if (_node.fullOpcode() == "UNTUPLE 3") m_out << "UNTRIPLE";
+	std::string const fullOpcode = _node.fullOpcode();
+	if (fullOpcode == "BITNOT") m_out << "NOT";
+	else if (fullOpcode == "TUPLE 1") m_out << "SINGLE";
+	else if (fullOpcode == "TUPLE 2") m_out << "PAIR";
+	else if (fullOpcode == "TUPLE 3") m_out << "TRIPLE";
+	else if (fullOpcode == "UNTUPLE 1") m_out << "UNSINGLE";
+	else if (fullOpcode == "UNTUPLE 2") m_out << "UNPAIR";
+	else if (fullOpcode == "UNTUPLE 3") m_out << "UNTRIPLE";
 	else if (isIn(_node.opcode(), "INDEX_EXCEP", "INDEX_NOEXCEP")) {
 		int index = boost::lexical_cast<int>(_node.arg());
 		if (index <= 15) {
 			m_out << "INDEX " << index;
 		} else {
-			m_out << "PUSHINT " << index << std::endl;
+			m_out << "PUSHINT " << index << '\n';
 			tabs();
 			m_out << "INDEXVAR";
 		}
 	} else {
-		m_out << _node.fullOpcode();
+		m_out << fullOpcode;
 	}
-	m_out << std::endl;
+	m_out << '\n';
 	return false;
 }
 
@@ -134,7 +137,7 @@ bool Printer::visit(PushCellOrSlice &_node) {
 	++m_tab;
 	if (!_node.blob().empty()) {
 		tabs();
-		m_out << _node.blob() << std::endl;
+		m_out << _node.blob() << '\n';
 	}
 	if (_node.child()) {
 		_node.child()->accept(*this);
@@ -142,7 +145,7 @@ bool Printer::visit(PushCellOrSlice &_node) {
 	--m_tab;
 
 	tabs();
-	m_out << "}" << std::endl;
+	m_out << "}\n";
 	return false;
 }
 
@@ -153,7 +156,7 @@ bool Printer::visit(Glob &_node) {
 			if (1 <= _node.index() && _node.index() <= 31) {
 				m_out << "GETGLOB " << _node.index();
 			} else {
-				m_out << "PUSHINT " << _node.index() << std::endl;
+				m_out << "PUSHINT " << _node.index() << '\n';
 				tabs();
 				m_out << "GETGLOBVAR";
 			}
@@ -162,7 +165,7 @@ bool Printer::visit(Glob &_node) {
 			if (1 <= _node.index() && _node.index() <= 31) {
 				m_out << "SETGLOB " << _node.index();
 			} else {
-				m_out << "PUSHINT " << _node.index() << std::endl;
+				m_out << "PUSHINT " << _node.index() << '\n';
 				tabs();
 				m_out << "SETGLOBVAR";
 			}
@@ -222,7 +225,7 @@ bool Printer::visit(Stack &_node) {
 			m_out << "BLKDROP";
 			printIndexes();
 		} else {
-			m_out << "PUSHINT " + std::to_string(n) << std::endl;
+			m_out << "PUSHINT " + std::to_string(n) << '\n';
 			tabs();
 			m_out << "DROPX";
 		}
@@ -257,11 +260,11 @@ bool Printer::visit(Stack &_node) {
 		}
 		case Stack::Opcode::BLKDROP2:
 			if (i > 15 || j > 15) {
-				m_out << "PUSHINT " << i << std::endl;
+				m_out << "PUSHINT " << i << '\n';
 				tabs();
-				m_out << "PUSHINT " << j << std::endl;
+				m_out << "PUSHINT " << j << '\n';
 				tabs();
-				m_out << "BLKSWX" << std::endl;
+				m_out << "BLKSWX\n";
 				tabs();
 				drop(i);
 			} else {
@@ -309,9 +312,9 @@ bool Printer::visit(Stack &_node) {
 					printIndexes();
 				}
 			} else {
-				m_out << "PUSHINT " << bottom << std::endl;
+				m_out << "PUSHINT " << bottom << '\n';
 				tabs();
-				m_out << "PUSHINT " << top << std::endl;
+				m_out << "PUSHINT " << top << '\n';
 				tabs();
 				m_out << "BLKSWX";
 			}
@@ -327,9 +330,9 @@ bool Printer::visit(Stack &_node) {
 				m_out << "REVERSE";
 				printIndexes();
 			} else {
-				m_out << "PUSHINT " << i << std::endl;
+				m_out << "PUSHINT " << i << '\n';
 				tabs();
-				m_out << "PUSHINT " << j << std::endl;
+				m_out << "PUSHINT " << j << '\n';
 				tabs();
 				m_out << "REVX";
 			}
@@ -346,7 +349,7 @@ bool Printer::visit(Stack &_node) {
 				bool first = true;
 				while (rest > 0) {
 					if (!first) {
-						m_out << std::endl;
+						m_out << '\n';
 						tabs();
 					}
 					m_out << "BLKPUSH " << std::min(15, rest) << ", " << j;
@@ -379,7 +382,7 @@ bool Printer::visit(CodeBlock &_node) {
 			break;
 		default:
 			tabs();
-			m_out << CodeBlock::toString(_node.type()) << " {" << std::endl;
+			m_out << CodeBlock::toString(_node.type()) << " {\n";
 			++m_tab;
 			break;
 	}
@@ -394,7 +397,7 @@ bool Printer::visit(CodeBlock &_node) {
 		default:
 			--m_tab;
 			tabs();
-			m_out << "}" << std::endl;
+			m_out << "}\n";
 			break;
 	}
 
@@ -411,19 +414,19 @@ bool Printer::visit(SubProgram &_node) {
 			m_out << "CALLREF";
 			break;
 	}
-	m_out << " {" << std::endl;
+	m_out << " {\n";
 
 	++m_tab;
 	_node.block()->accept(*this);
 	--m_tab;
 
 	tabs();
-	m_out << "}" << std::endl;
+	m_out << "}\n";
 
 	switch (_node.type()) {
 		case SubProgram::Type::CALLX:
 			tabs();
-			m_out << "CALLX" << std::endl;
+			m_out << "CALLX\n";
 			break;
 		default:
 			break;
@@ -436,20 +439,20 @@ bool Printer::visit(TvmCondition &_node)  {
 	_node.trueBody()->accept(*this);
 	_node.falseBody()->accept(*this);
 	tabs();
-	m_out << "IFELSE" << std::endl;
+	m_out << "IFELSE\n";
 	return false;
 }
 
 bool Printer::visit(LogCircuit &_node) {
 	tabs();
-	m_out << "PUSHCONT {" << std::endl;
+	m_out << "PUSHCONT {\n";
 
 	++m_tab;
 	_node.body()->accept(*this);
 	--m_tab;
 
 	tabs();
-	m_out << "}" << std::endl;
+	m_out << "}\n";
 
 	tabs();
 	switch (_node.type()) {
@@ -460,7 +463,7 @@ bool Printer::visit(LogCircuit &_node) {
 			m_out << "IFNOT";
 			break;
 	}
-	m_out << std::endl;
+	m_out << '\n';
 
 	return false;
 }
@@ -489,14 +492,14 @@ bool Printer::visit(TvmIfElse &_node) {
 			default:
 				solUnimplemented("");
 		}
-		m_out << " {" << std::endl;
+		m_out << " {\n";
 		++m_tab;
 		for (Pointer<TvmAstNode> const& i : _node.trueBody()->instructions()) {
 			i->accept(*this);
 		}
 		--m_tab;
 		tabs();
-		m_out << "}" << std::endl;
+		m_out << "}\n";
 	} else {
 		_node.trueBody()->accept(*this);
 		if (_node.falseBody()) {
@@ -520,14 +523,14 @@ bool Printer::visit(TvmIfElse &_node) {
 				m_out << "IFELSE";
 				break;
 			case TvmIfElse::Type::IFELSE_WITH_JMP:
-				m_out << "CONDSEL" << std::endl;
+				m_out << "CONDSEL\n";
 				tabs();
 				m_out << "JMPX";
 				break;
 			default:
 				solUnimplemented("");
 		}
-		m_out << std::endl;
+		m_out << '\n';
 	}
 
 	return false;
@@ -536,14 +539,14 @@ bool Printer::visit(TvmIfElse &_node) {
 bool Printer::visit(TvmRepeat &_node) {
 	_node.body()->accept(*this);
 	tabs();
-	m_out << "REPEAT" << std::endl;
+	m_out << "REPEAT\n";
 	return false;
 }
 
 bool Printer::visit(TvmUntil &_node) {
 	_node.body()->accept(*this);
 	tabs();
-	m_out << "UNTIL" << std::endl;
+	m_out << "UNTIL\n";
 	return false;
 }
 
@@ -551,14 +554,14 @@ bool Printer::visit(While &_node) {
 	_node.condition()->accept(*this);
 	_node.body()->accept(*this);
 	tabs();
-	m_out << "WHILE" << std::endl;
+	m_out << "WHILE\n";
 	return false;
 }
 
 bool Printer::visit(Contract &_node) {
 	for (const std::string& pragma : _node.pragmas()) {
-		m_out << pragma << std::endl;
-		m_out << std::endl;
+		m_out << pragma << '\n';
+		m_out << '\n';
 	}
 	for (const Pointer<Function>& f : _node.functions()){
 		f->accept(*this);
@@ -569,32 +572,32 @@ bool Printer::visit(Contract &_node) {
 bool Printer::visit(Function &_node) {
 	switch (_node.type()) {
 		case Function::FunctionType::PrivateFunction:
-			m_out << ".globl\t" << _node.name() << std::endl;
-			m_out << ".type\t" << _node.name() << ", @function" << std::endl;
+			m_out << ".globl\t" << _node.name() << '\n';
+			m_out << ".type\t" << _node.name() << ", @function\n";
 			break;
 		case Function::FunctionType::Macro:
 		case Function::FunctionType::MacroGetter:
-			m_out << ".macro " << _node.name() << std::endl;
+			m_out << ".macro " << _node.name() << '\n';
 			break;
 		case Function::FunctionType::MainInternal:
 			solAssert(_node.name() == "main_internal", "");
-			m_out << ".internal-alias :main_internal, 0" << std::endl
-				<< ".internal :main_internal" << std::endl;
+			m_out << ".internal-alias :main_internal, 0\n"
+				<< ".internal :main_internal\n";
 			break;
 		case Function::FunctionType::MainExternal:
 			solAssert(_node.name() == "main_external", "");
-			m_out << ".internal-alias :main_external, -1" << std::endl
-				  << ".internal :main_external" << std::endl;
+			m_out << ".internal-alias :main_external, -1\n"
+				  << ".internal :main_external\n";
 			break;
 		case Function::FunctionType::OnCodeUpgrade:
 			solAssert(_node.name() == "onCodeUpgrade", "");
-			m_out << ".internal-alias :onCodeUpgrade, 2" << std::endl
-				  << ".internal :onCodeUpgrade" << std::endl;
+			m_out << ".internal-alias :onCodeUpgrade, 2\n"
+				  << ".internal :onCodeUpgrade\n";
 			break;
 		case Function::FunctionType::OnTickTock:
 			solAssert(_node.name() == "onTickTock", "");
-			m_out << ".internal-alias :onTickTock, -2" << std::endl
-				  << ".internal :onTickTock" << std::endl;
+			m_out << ".internal-alias :onTickTock, -2\n"
+				  << ".internal :onTickTock\n";
 			break;
 	}
 	_node.block()->accept(*this);
@@ -607,12 +610,14 @@ bool Printer::visitNode(TvmAstNode const&) {
 }
 
 void Printer::endL() {
-	m_out << std::endl;
+	m_out << '\n';
 }
 
 void Printer::tabs() {
 	solAssert(m_tab >= 0, "");
-	m_out << std::string(m_tab, '\t');
+	if (m_tabs.size() < static_cast<size_t>(m_tab))
+		m_tabs.resize(m_tab, '\t');
+	m_out << std::string_view(m_tabs.data(), m_tab);
 }
 
 bool LocSquasher::visit(CodeBlock &_node) {
@@ -639,8 +644,8 @@ bool LocSquasher::visit(CodeBlock &_node) {
 	for (const Pointer<TvmAstNode>& node : res0) {
 		auto loc = std::dynamic_pointer_cast<Loc>(node);
 		if (loc) {
-			if (!lastLoc || std::make_pair(lastLoc.value()->file(), lastLoc.value()->line()) !=
-							std::make_pair(loc->file(), loc->line())) {
+			if (!lastLoc || std::make_pair(lastLoc.value()->fileId(), lastLoc.value()->line()) !=
+							std::make_pair(loc->fileId(), loc->line())) {
 				res.push_back(node);
 			}
 			//
@@ -776,3 +781,98 @@ bool LogCircuitExpander::isPureOperation(Pointer<TvmAstNode> const& op) {
 
 	return false;
 }
+
+bool ConstantPool::visit(Contract &_node) {
+	m_isCollecting = true;
+	for (Pointer<Function>& f : _node.functions()) {
+		f->accept(*this);
+	}
+	m_isCollecting = false;
+	for (Pointer<Function>& f : _node.functions()) {
+		f->accept(*this);
+	}
+	return false;
+}
+
+bool ConstantPool::visit(GenOpcode &_node) {
+	if (m_isCollecting) {
+		if (std::optional<std::string> slice = longSlice(_node)) {
+			++m_sliceUseQty[*slice];
+		}
+	}
+	return false;
+}
+
+void ConstantPool::endVisit(CodeBlock &_node) {
+	if (m_isCollecting) {
+		return;
+	}
+	std::vector<Pointer<TvmAstNode>> newInst;
+	for (Pointer<TvmAstNode> const& op : _node.instructions()) {
+		if (auto g = to<GenOpcode>(op.get())) {
+			std::optional<std::string> slice = longSlice(*g);
+			if (slice && m_sliceUseQty.at(*slice) >= TvmConst::ConstantPool::MinUseQty) {
+				newInst.emplace_back(createNode<PushCellOrSlice>(PushCellOrSlice::Type::PUSHREFSLICE, ".blob " + *slice, nullptr));
+				continue;
+			}
+		}
+		newInst.emplace_back(op);
+	}
+	_node.upd(newInst);
+}
+
+std::optional<std::string> ConstantPool::longSlice(GenOpcode const& _node) {
+	if (_node.opcode() != "PUSHSLICE" || _node.arg().empty() || _node.arg().at(0) != 'x') {
+		return std::nullopt;
+	}
+	// The trailing '_' is a completion tag, the last 1 bit and the zeros after it are not data
+	size_t const bitQty = CellBuilder{}.storeHex(std::string_view{_node.arg()}.substr(1)).bitSize();
+	if (bitQty < TvmConst::ConstantPool::MinSliceBitQty) {
+		return std::nullopt;
+	}
+	return _node.arg();
+}
+
+bool GlobWriteScanner::visit(Glob &_node) {
+	switch (_node.opcode()) {
+		case Glob::Opcode::SetOrSetVar:
+			m_setGlobs.insert(_node.index());
+			break;
+		case Glob::Opcode::POPROOT:
+		case Glob::Opcode::POP_C7:
+			m_hasUnknownWrite = true;
+			break;
+		default:
+			break;
+	}
+	return false;
+}
+
+bool GlobWriteScanner::visit(GenOpcode &_node) {
+	addCallee(_node.fullOpcode());
+	return false;
+}
+
+bool GlobWriteScanner::visit(HardCode &_node) {
+	for (std::string const& line : _node.code()) {
+		if (line.find("SETGLOB") != std::string::npos ||
+			line.find("POPROOT") != std::string::npos ||
+			line.find("POP c") != std::string::npos
+		) {
+			m_hasUnknownWrite = true;
+		}
+		addCallee(line);
+	}
+	return false;
+}
+
+void GlobWriteScanner::addCallee(std::string const& line) {
+	// e.g. CALL $name$ or PUSHINT $name$
+	size_t begin = line.find('$');
+	if (begin == std::string::npos) {
+		return;
+	}
+	size_t end = line.find('$', begin + 1);
+	solAssert(end != std::string::npos, "");
+	m_callees.insert(line.substr(begin + 1, end - begin - 1));
+}
@@ -18,7 +18,15 @@
 
 #pragma once
 
+#include <charconv>
+#include <map>
 #include <memory>
+#include <optional>
+#include <ostream>
+#include <set>
+#include <string>
+#include <string_view>
+#include <type_traits>
 #include <vector>
 
 #include <boost/noncopyable.hpp>
@@ -62,6 +70,9 @@ namespace solidity::frontend
 	class Printer : public TvmAstVisitor {
 	public:
 		explicit Printer(std::ostream& out) : m_out{out} { }
+		~Printer() override { flush(); }
+		// Writes the text printed so far to the stream
+		void flush() { m_out.flush(); }
 		bool visit(AsymGen &_node) override;
 		bool visit(DeclRetFlag &_node) override;
 		bool visit(Opaque &_node) override;
@@ -90,7 +101,39 @@ namespace solidity::frontend
 		void endL();
 		void tabs();
 	private:
-		std::ostream& m_out;
+		// Collects the text and writes it to the stream in large chunks, so that printing
+		// a line costs appending to a string rather than a formatted stream insertion.
+		class Buffer {
+		public:
+			explicit Buffer(std::ostream& _out) : m_out{_out} { m_data.reserve(Capacity); }
+			Buffer& operator<<(std::string_view _s) {
+				m_data.append(_s);
+				if (m_data.size() >= Capacity)
+					flush();
+				return *this;
+			}
+			Buffer& operator<<(char _c) {
+				m_data.push_back(_c);
+				return *this;
+			}
+			template <typename T>
+			std::enable_if_t<std::is_integral_v<T>, Buffer&> operator<<(T _value) {
+				char digits[24];
+				char* end = std::to_chars(digits, digits + sizeof(digits), _value).ptr;
+				return *this << std::string_view(digits, end - digits);
+			}
+			void flush() {
+				m_out.write(m_data.data(), m_data.size());
+				m_data.clear();
+			}
+		private:
+			static size_t constexpr Capacity = 1 << 16;
+			std::ostream& m_out;
+			std::string m_data;
+		};
+
+		Buffer m_out;
+		std::string m_tabs;
 		int m_tab{};
 	};
 
@@ -119,4 +162,36 @@ namespace solidity::frontend
 		std::vector<Pointer<TvmAstNode>> m_newInst;
 	};
 
+	// Moves long slice literals, that are used several times in the contract, to cells:
+	// PUSHSLICE is replaced with PUSHREFSLICE. See TvmConst::ConstantPool for the gas trade-off.
+	class ConstantPool : public TvmAstVisitor {
+	public:
+		bool visit(Contract &_node) override;
+		bool visit(GenOpcode &_node) override;
+		void endVisit(CodeBlock &_node) override;
+	private:
+		static std::optional<std::string> longSlice(GenOpcode const& _node);
+	private:
+		bool m_isCollecting{};
+		std::map<std::string, int> m_sliceUseQty;
+	};
+
+	// Collects indexes of GLOB variables set by a function and names of functions and macros it refers to.
+	// Writes of c4 and c7 registers as a whole can't be tracked by indexes, so they are marked as unknown writes.
+	class GlobWriteScanner : public TvmAstVisitor {
+	public:
+		bool visit(Glob &_node) override;
+		bool visit(GenOpcode &_node) override;
+		bool visit(HardCode &_node) override;
+		std::set<int> const& setGlobs() const { return m_setGlobs; }
+		std::set<std::string> const& callees() const { return m_callees; }
+		bool hasUnknownWrite() const { return m_hasUnknownWrite; }
+	private:
+		void addCallee(std::string const& line);
+	private:
+		std::set<int> m_setGlobs;
+		std::set<std::string> m_callees;
+		bool m_hasUnknownWrite{};
+	};
+
 }	// end solidity::frontend
@@ -0,0 +1,310 @@
+/*
+ * Copyright 2018-2021 TON DEV SOLUTIONS LTD.
+ *
+ * Licensed under the  terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License.
+ *
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the  GNU General Public License for more details at: https://www.gnu.org/licenses/gpl-3.0.html
+ */
+/**
+ * @author TON Labs <connect@tonlabs.io>
+ * @date 2021
+ * TVM cells and their serialization to a bag of cells.
+ */
+
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+
+#include <libsolutil/picosha2.h>
+#include <liblangutil/Exceptions.h>
+
+#include "TvmCell.hpp"
+
+using namespace solidity;
+using namespace solidity::frontend;
+
+namespace {
+
+uint64_t lowBits(uint64_t _value, size_t _bits) {
+	return _bits >= 64 ? _value : _value & ((uint64_t{1} << _bits) - 1);
+}
+
+// Number of bits needed to store integers from 0 to _value
+size_t bitLength(uint64_t _value) {
+	size_t len = 0;
+	for (; _value != 0; _value >>= 1) {
+		++len;
+	}
+	return len;
+}
+
+// Bytes needed to store integers from 0 to _value, at least one
+size_t byteLength(uint64_t _value) {
+	return std::max<size_t>(1, (bitLength(_value) + 7) / 8);
+}
+
+void storeBigEndian(bytes& _out, uint64_t _value, size_t _bytes) {
+	for (size_t i = _bytes; i-- > 0; ) {
+		_out.push_back(static_cast<uint8_t>(_value >> (8 * i)));
+	}
+}
+
+uint32_t crc32c(bytes const& _data) {
+	static std::array<uint32_t, 256> const table = [] {
+		std::array<uint32_t, 256> t{};
+		for (uint32_t i = 0; i < 256; ++i) {
+			uint32_t c = i;
+			for (int k = 0; k < 8; ++k) {
+				c = (c & 1) ? (c >> 1) ^ 0x82F63B78 : c >> 1;
+			}
+			t[i] = c;
+		}
+		return t;
+	}();
+	uint32_t crc = 0xFFFFFFFF;
+	for (uint8_t b : _data) {
+		crc = table[(crc ^ b) & 0xFF] ^ (crc >> 8);
+	}
+	return crc ^ 0xFFFFFFFF;
+}
+
+// hml_short$0, hml_long$10 or hml_same$11, whichever is the shortest, as the node builder does
+void storeLabel(CellBuilder& _cell, uint64_t _label, size_t _len, size_t _maxLen) {
+	size_t const k = bitLength(_maxLen);
+	bool const same = _len > 0 && (_label == 0 || _label == lowBits(~uint64_t{0}, _len));
+	size_t const shortSize = 2 + 2 * _len;
+	size_t const longSize = 2 + k + _len;
+	size_t const sameSize = 3 + k;
+	if (same && sameSize < std::min(shortSize, longSize)) {
+		_cell.storeUInt(3, 2).storeBit(_label != 0).storeUInt(_len, k);
+	} else if (longSize < shortSize) {
+		_cell.storeUInt(2, 2).storeUInt(_len, k).storeUInt(_label, _len);
+	} else {
+		_cell.storeBit(false);
+		for (size_t i = 0; i < _len; ++i) {
+			_cell.storeBit(true);
+		}
+		_cell.storeBit(false).storeUInt(_label, _len);
+	}
+}
+
+using DictEntry = std::pair<uint64_t, CellBuilder const*>;
+
+// Only the lower _keyLength bits of the keys in [_begin, _end) are left to be matched
+CellPtr buildDictionaryNode(
+	std::vector<DictEntry>::const_iterator _begin,
+	std::vector<DictEntry>::const_iterator _end,
+	size_t _keyLength,
+	DictLeafCallback const& _onLeaf
+) {
+	size_t prefix = _keyLength;
+	if (_end - _begin > 1) {
+		uint64_t const diff = lowBits(_begin->first ^ std::prev(_end)->first, _keyLength);
+		prefix = _keyLength - bitLength(diff);
+	}
+	uint64_t const label = prefix == 0 ? 0 : lowBits(_begin->first >> (_keyLength - prefix), prefix);
+
+	CellBuilder node;
+	storeLabel(node, label, prefix, _keyLength);
+	if (prefix == _keyLength) {
+		node.append(*_begin->second);
+	} else {
+		size_t const rest = _keyLength - prefix - 1;
+		auto middle = std::find_if(_begin, _end, [&](DictEntry const& e) { return (e.first >> rest) & 1; });
+		node.storeRef(buildDictionaryNode(_begin, middle, rest, _onLeaf));
+		node.storeRef(buildDictionaryNode(middle, _end, rest, _onLeaf));
+	}
+	CellPtr cell = node.build();
+	if (prefix == _keyLength && _onLeaf) {
+		_onLeaf(_begin->first, *cell);
+	}
+	return cell;
+}
+
+} // end anonymous namespace
+
+Cell::Cell(bytes _data, size_t _bitSize, std::vector<CellPtr> _refs) :
+	m_data{std::move(_data)},
+	m_bitSize{_bitSize},
+	m_refs{std::move(_refs)}
+{
+	solAssert(m_bitSize <= MaxBits && m_refs.size() <= MaxRefs, "");
+	solAssert(m_data.size() == (m_bitSize + 7) / 8, "");
+
+	bytes repr = descriptorsAndData();
+	for (CellPtr const& ref : m_refs) {
+		m_depth = std::max<uint16_t>(m_depth, ref->depth() + 1);
+		storeBigEndian(repr, ref->depth(), 2);
+	}
+	for (CellPtr const& ref : m_refs) {
+		repr.insert(repr.end(), ref->hash().begin(), ref->hash().end());
+	}
+	picosha2::hash256(repr.begin(), repr.end(), m_hash.begin(), m_hash.end());
+}
+
+bytes Cell::descriptorsAndData() const {
+	bytes res;
+	res.reserve(2 + m_data.size());
+	res.push_back(static_cast<uint8_t>(m_refs.size()));
+	res.push_back(static_cast<uint8_t>(m_bitSize / 8 + (m_bitSize + 7) / 8));
+	res.insert(res.end(), m_data.begin(), m_data.end());
+	if (m_bitSize % 8 != 0) {
+		res.back() |= uint8_t{0x80} >> (m_bitSize % 8);
+	}
+	return res;
+}
+
+CellBuilder& CellBuilder::storeBit(bool _bit) {
+	if (m_bitSize % 8 == 0) {
+		m_data.push_back(0);
+	}
+	if (_bit) {
+		m_data.back() |= uint8_t{0x80} >> (m_bitSize % 8);
+	}
+	++m_bitSize;
+	return *this;
+}
+
+CellBuilder& CellBuilder::storeUInt(uint64_t _value, size_t _bits) {
+	solAssert(_bits <= 64 && lowBits(_value, _bits) == _value, "");
+	for (size_t i = _bits; i-- > 0; ) {
+		storeBit((_value >> i) & 1);
+	}
+	return *this;
+}
+
+CellBuilder& CellBuilder::storeInt(bigint const& _value, size_t _bits) {
+	solAssert(_bits > 0, "");
+	bigint const bound = bigint(1) << (_bits - 1);
+	solAssert(-bound <= _value && _value < bound, "");
+	bigint const value = _value < 0 ? _value + (bound << 1) : _value;
+	for (size_t i = _bits; i-- > 0; ) {
+		storeBit(boost::multiprecision::bit_test(value, i));
+	}
+	return *this;
+}
+
+CellBuilder& CellBuilder::storeHex(std::string_view _hex) {
+	bool const hasTag = !_hex.empty() && _hex.back() == '_';
+	if (hasTag) {
+		_hex.remove_suffix(1);
+	}
+	size_t const begin = m_bitSize;
+	for (char c : _hex) {
+		int digit = 0;
+		if ('0' <= c && c <= '9') digit = c - '0';
+		else if ('a' <= c && c <= 'f') digit = c - 'a' + 10;
+		else if ('A' <= c && c <= 'F') digit = c - 'A' + 10;
+		else solAssert(false, std::string{"Bad hex digit: "} + c);
+		storeUInt(digit, 4);
+	}
+	if (hasTag) {
+		while (m_bitSize > begin && !bit(m_bitSize - 1)) {
+			--m_bitSize;
+		}
+		solAssert(m_bitSize > begin, "");
+		--m_bitSize;
+		m_data.resize((m_bitSize + 7) / 8);
+		if (m_bitSize % 8 != 0) {
+			m_data.back() &= static_cast<uint8_t>(0xFF00 >> (m_bitSize % 8));
+		}
+	}
+	return *this;
+}
+
+CellBuilder& CellBuilder::append(CellBuilder const& _other) {
+	if (m_bitSize % 8 == 0) {
+		m_data.insert(m_data.end(), _other.m_data.begin(), _other.m_data.end());
+		m_bitSize += _other.m_bitSize;
+	} else {
+		for (size_t i = 0; i < _other.m_bitSize; ++i) {
+			storeBit(_other.bit(i));
+		}
+	}
+	m_refs.insert(m_refs.end(), _other.m_refs.begin(), _other.m_refs.end());
+	return *this;
+}
+
+CellBuilder& CellBuilder::append(Cell const& _cell) {
+	CellBuilder other;
+	other.m_data = _cell.data();
+	other.m_bitSize = _cell.bitSize();
+	other.m_refs = _cell.refs();
+	return append(other);
+}
+
+CellBuilder& CellBuilder::storeRef(CellPtr _cell) {
+	m_refs.emplace_back(std::move(_cell));
+	return *this;
+}
+
+CellPtr CellBuilder::build() const {
+	solAssert(m_bitSize <= Cell::MaxBits && m_refs.size() <= Cell::MaxRefs, "Cell overflow");
+	return std::make_shared<Cell const>(m_data, m_bitSize, m_refs);
+}
+
+CellPtr solidity::frontend::buildDictionary(
+	std::map<uint64_t, CellBuilder> const& _values,
+	size_t _keyLength,
+	DictLeafCallback const& _onLeaf
+) {
+	solAssert(!_values.empty() && _keyLength <= 64, "");
+	std::vector<DictEntry> entries;
+	for (auto const& [key, value] : _values) {
+		solAssert(lowBits(key, _keyLength) == key, "");
+		entries.emplace_back(key, &value);
+	}
+	return buildDictionaryNode(entries.begin(), entries.end(), _keyLength, _onLeaf);
+}
+
+bytes solidity::frontend::serializeBagOfCells(CellPtr const& _root) {
+	// Parents go before children, equal cells are stored once
+	std::vector<Cell const*> order;
+	std::unordered_map<std::string, size_t> index;
+	auto key = [](Cell const& _cell) { return std::string(_cell.hash().begin(), _cell.hash().end()); };
+	std::function<void(Cell const&)> visit = [&](Cell const& _cell) {
+		if (!index.emplace(key(_cell), 0).second) {
+			return;
+		}
+		for (CellPtr const& ref : _cell.refs()) {
+			visit(*ref);
+		}
+		order.push_back(&_cell);
+	};
+	visit(*_root);
+	std::reverse(order.begin(), order.end());
+	for (size_t i = 0; i < order.size(); ++i) {
+		index[key(*order[i])] = i;
+	}
+
+	size_t const refSize = byteLength(order.size());
+	bytes cells;
+	for (Cell const* cell : order) {
+		bytes const data = cell->descriptorsAndData();
+		cells.insert(cells.end(), data.begin(), data.end());
+		for (CellPtr const& ref : cell->refs()) {
+			storeBigEndian(cells, index.at(key(*ref)), refSize);
+		}
+	}
+	size_t const offsetSize = byteLength(cells.size());
+
+	bytes boc{0xb5, 0xee, 0x9c, 0x72};
+	boc.push_back(static_cast<uint8_t>(0x40 | refSize)); // has_crc32c, size
+	boc.push_back(static_cast<uint8_t>(offsetSize));
+	storeBigEndian(boc, order.size(), refSize); // cells
+	storeBigEndian(boc, 1, refSize); // roots
+	storeBigEndian(boc, 0, refSize); // absent
+	storeBigEndian(boc, cells.size(), offsetSize); // tot_cells_size
+	storeBigEndian(boc, 0, refSize); // root index
+	boc.insert(boc.end(), cells.begin(), cells.end());
+	uint32_t const crc = crc32c(boc);
+	for (int i = 0; i < 4; ++i) {
+		boc.push_back(static_cast<uint8_t>(crc >> (8 * i)));
+	}
+	return boc;
+}
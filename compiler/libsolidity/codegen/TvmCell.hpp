@@ -0,0 +1,102 @@
+/*
+ * Copyright 2018-2021 TON DEV SOLUTIONS LTD.
+ *
+ * Licensed under the  terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License.
+ *
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the  GNU General Public License for more details at: https://www.gnu.org/licenses/gpl-3.0.html
+ */
+/**
+ * @author TON Labs <connect@tonlabs.io>
+ * @date 2021
+ * TVM cells and their serialization to a bag of cells.
+ */
+
+#pragma once
+
+#include <libsolutil/Common.h>
+
+#include <array>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace solidity::frontend {
+
+	class Cell;
+	using CellPtr = std::shared_ptr<Cell const>;
+
+	// Ordinary cell: up to 1023 data bits and up to 4 references. Cells are immutable,
+	// the representation hash and the depth are computed on construction.
+	class Cell {
+	public:
+		static constexpr size_t MaxBits = 1023;
+		static constexpr size_t MaxRefs = 4;
+		using Hash = std::array<uint8_t, 32>;
+
+		Cell(bytes _data, size_t _bitSize, std::vector<CellPtr> _refs);
+		// Data bits starting from the most significant bit of the first byte, the unused bits are zero
+		bytes const& data() const { return m_data; }
+		size_t bitSize() const { return m_bitSize; }
+		std::vector<CellPtr> const& refs() const { return m_refs; }
+		Hash const& hash() const { return m_hash; }
+		uint16_t depth() const { return m_depth; }
+		// Descriptor bytes followed by the data bits with the completion tag, as they are
+		// stored in a bag of cells and hashed
+		bytes descriptorsAndData() const;
+	private:
+		bytes m_data;
+		size_t m_bitSize{};
+		std::vector<CellPtr> m_refs;
+		Hash m_hash{};
+		uint16_t m_depth{};
+	};
+
+	// Accumulates bits and references. Unlike a cell it has no size limit, so it is also used
+	// for encoded instructions and other pieces that are later put into cells.
+	class CellBuilder {
+	public:
+		size_t bitSize() const { return m_bitSize; }
+		std::vector<CellPtr> const& refs() const { return m_refs; }
+		bool bit(size_t _index) const { return (m_data[_index / 8] >> (7 - _index % 8)) & 1; }
+
+		CellBuilder& storeBit(bool _bit);
+		CellBuilder& storeUInt(uint64_t _value, size_t _bits);
+		// Two's complement representation of @a _value in @a _bits bits
+		CellBuilder& storeInt(bigint const& _value, size_t _bits);
+		// Hexadecimal digits, an optional trailing '_' means that the last 1 bit and the zeros after it
+		// are not data but a completion tag
+		CellBuilder& storeHex(std::string_view _hex);
+		// Appends the bits and the references of @a _other
+		CellBuilder& append(CellBuilder const& _other);
+		CellBuilder& append(Cell const& _cell);
+		CellBuilder& storeRef(CellPtr _cell);
+
+		CellPtr build() const;
+	private:
+		bytes m_data;
+		size_t m_bitSize{};
+		std::vector<CellPtr> m_refs;
+	};
+
+	// Called for each leaf of a dictionary with its key, the value is at the end of the leaf
+	using DictLeafCallback = std::function<void(uint64_t _key, Cell const& _leaf)>;
+
+	// @returns the root of a dictionary (Hashmap) with keys of @a _keyLength bits.
+	// Keys are unsigned, values must be small enough to fit into the leaves together with the labels.
+	CellPtr buildDictionary(
+		std::map<uint64_t, CellBuilder> const& _values,
+		size_t _keyLength,
+		DictLeafCallback const& _onLeaf = {}
+	);
+
+	// @returns the bag of cells with the single root @a _root and a CRC32-C checksum.
+	bytes serializeBagOfCells(CellPtr const& _root);
+
+}	// end solidity::frontend
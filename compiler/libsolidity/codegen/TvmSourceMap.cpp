@@ -0,0 +1,255 @@
+/*
+ * Copyright 2018-2021 TON DEV SOLUTIONS LTD.
+ *
+ * Licensed under the  terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License.
+ *
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the  GNU General Public License for more details at: https://www.gnu.org/licenses/gpl-3.0.html
+ */
+/**
+ * @author TON Labs <connect@tonlabs.io>
+ * @date 2021
+ * Source map of the generated code
+ */
+
+#include <climits>
+#include <streambuf>
+#include <string_view>
+
+#include <json/json.h>
+
+#include <libsolutil/CommonData.h>
+#include <libsolutil/JSON.h>
+
+#include "TvmAstVisitor.hpp"
+#include "TvmSourceMap.hpp"
+
+using namespace solidity;
+using namespace solidity::frontend;
+
+namespace {
+
+// Receives the textual assembly and records the current span for each instruction line
+class SpanRecorder : public std::streambuf {
+public:
+	void setSpan(TvmSourceMap::Span const& _span) { m_span = _span; }
+	std::vector<TvmSourceMap::Span> take() {
+		m_span = {};
+		return std::move(m_spans);
+	}
+protected:
+	int overflow(int _c) override {
+		if (_c != traits_type::eof()) {
+			put(static_cast<char>(_c));
+		}
+		return _c;
+	}
+	std::streamsize xsputn(char const* _s, std::streamsize _n) override {
+		for (std::streamsize i = 0; i < _n; ++i) {
+			put(_s[i]);
+		}
+		return _n;
+	}
+private:
+	void put(char _c) {
+		if (_c != '\n') {
+			m_line.push_back(_c);
+			return;
+		}
+		std::string_view line{m_line};
+		line = line.substr(0, line.find(';'));
+		size_t const begin = line.find_first_not_of(" \t\r");
+		if (begin != std::string_view::npos) {
+			line = line.substr(begin, line.find_last_not_of(" \t\r") - begin + 1);
+			if (line[0] != '.' && line != "}") {
+				m_spans.push_back(m_span);
+			}
+		}
+		m_line.clear();
+	}
+private:
+	std::string m_line;
+	TvmSourceMap::Span m_span;
+	std::vector<TvmSourceMap::Span> m_spans;
+};
+
+// Prints the functions as the textual assembly and takes the current span at each Loc
+class SpanCollector : public Printer {
+public:
+	SpanCollector(std::ostream& _out, SpanRecorder& _recorder, TvmSourceMap& _map) :
+		Printer{_out},
+		m_recorder{_recorder},
+		m_map{_map}
+	{
+	}
+	bool visit(Loc &_node) override {
+		flush();
+		m_recorder.setSpan({_node.fileId(), _node.start(), _node.end(), _node.line(), _node.column()});
+		return false;
+	}
+	bool visit(Function &_node) override {
+		flush();
+		m_recorder.take();
+		Printer::visit(_node);
+		flush();
+		m_map.addSpans(m_map.function(_node.name()), m_recorder.take());
+		return false;
+	}
+private:
+	SpanRecorder& m_recorder;
+	TvmSourceMap& m_map;
+};
+
+// Joins the entries, the fields that are equal to the previous ones are left empty.
+// @a _implicit returns the value of a field that can be omitted, e.g. the previous value.
+template <size_t N, typename Implicit>
+std::string compress(std::vector<std::array<int, N>> const& _entries, Implicit _implicit) {
+	std::string res;
+	std::array<int, N> prev;
+	prev.fill(INT_MIN);
+	for (size_t i = 0; i < _entries.size(); ++i) {
+		if (i != 0) {
+			res += ';';
+		}
+		std::string entry;
+		size_t used = 0;
+		for (size_t k = 0; k < N; ++k) {
+			if (k != 0) {
+				entry += ':';
+			}
+			if (_entries[i][k] != _implicit(k, prev[k])) {
+				entry += std::to_string(_entries[i][k]);
+				used = entry.size();
+			}
+		}
+		res += entry.substr(0, used);
+		prev = _entries[i];
+	}
+	return res;
+}
+
+} // end anonymous namespace
+
+void TvmSourceMap::addContract(Contract& _contract) {
+	SpanRecorder recorder;
+	std::ostream out{&recorder};
+	SpanCollector collector{out, recorder, *this};
+	_contract.accept(collector);
+}
+
+int TvmSourceMap::function(std::string const& _name) {
+	auto [it, isNew] = m_functionIds.emplace(_name, static_cast<int>(m_functionNames.size()));
+	if (isNew) {
+		m_functionNames.push_back(_name);
+		m_spans.emplace_back();
+	}
+	return it->second;
+}
+
+void TvmSourceMap::addSpans(int _function, std::vector<Span> _spans) {
+	std::vector<Span>& spans = m_spans.at(_function);
+	if (spans.empty()) {
+		spans = std::move(_spans);
+	}
+}
+
+int TvmSourceMap::frame(Frame const& _frame) {
+	std::tuple<int, int, int> const key{_frame.function, _frame.parent, _frame.call};
+	auto [it, isNew] = m_frameIds.emplace(key, static_cast<int>(m_frames.size()));
+	if (isNew) {
+		m_frames.push_back(_frame);
+	}
+	return it->second;
+}
+
+int TvmSourceMap::rebase(int _frame, int _parent, int _call) {
+	Frame const f = m_frames.at(_frame);
+	if (f.parent == -1) {
+		return frame({f.function, _parent, _call});
+	}
+	return frame({f.function, rebase(f.parent, _parent, _call), f.call});
+}
+
+void TvmSourceMap::addCell(Cell::Hash const& _hash, std::vector<Mark> _marks) {
+	if (!_marks.empty()) {
+		m_cells.emplace(_hash, std::move(_marks));
+	}
+}
+
+std::vector<TvmSourceMap::Mark> const* TvmSourceMap::marks(Cell::Hash const& _hash) const {
+	auto it = m_cells.find(_hash);
+	return it == m_cells.end() ? nullptr : &it->second;
+}
+
+void TvmSourceMap::print(std::ostream& _out) const {
+	Json::Value sources(Json::arrayValue);
+	std::map<int, int> sourceIndexes;
+	auto sourceIndex = [&](int _fileId) {
+		if (_fileId < 0 || Loc::fileName(_fileId).empty()) {
+			return -1;
+		}
+		auto [it, isNew] = sourceIndexes.emplace(_fileId, static_cast<int>(sources.size()));
+		if (isNew) {
+			sources.append(Loc::fileName(_fileId));
+		}
+		return it->second;
+	};
+	auto same = [](size_t, int _prev) { return _prev; };
+
+	Json::Value functions(Json::arrayValue);
+	for (size_t i = 0; i < m_functionNames.size(); ++i) {
+		std::vector<std::array<int, 5>> entries;
+		for (Span const& s : m_spans[i]) {
+			int const length = s.start < 0 ? -1 : s.end - s.start;
+			entries.push_back({s.start, length, sourceIndex(s.fileId), s.line, s.column});
+		}
+		Json::Value function(Json::objectValue);
+		function["name"] = m_functionNames[i];
+		function["map"] = compress(entries, same);
+		functions.append(function);
+	}
+
+	Json::Value frames(Json::arrayValue);
+	for (Frame const& f : m_frames) {
+		Json::Value frame(Json::arrayValue);
+		frame.append(f.function);
+		frame.append(f.parent);
+		frame.append(f.call);
+		frames.append(frame);
+	}
+
+	Json::Value root(Json::objectValue);
+	root["version"] = 1;
+	root["sources"] = sources;
+	root["functions"] = functions;
+	root["frames"] = frames;
+	if (m_codeFile.empty()) {
+		_out << util::jsonCompactPrint(root);
+		return;
+	}
+
+	Json::Value cells(Json::objectValue);
+	for (auto const& [hash, marks] : m_cells) {
+		std::vector<std::array<int, 3>> entries;
+		size_t offset = 0;
+		for (Mark const& m : marks) {
+			entries.push_back({static_cast<int>(m.offset - offset), m.frame, m.index});
+			offset = m.offset;
+		}
+		// The offset is always written, the index is implicit if it is the next one
+		cells[util::toHex(bytes(hash.begin(), hash.end()))] = compress(entries, [](size_t _k, int _prev) {
+			if (_k == 0) {
+				return INT_MIN;
+			}
+			return _k == 2 && _prev != INT_MIN ? _prev + 1 : _prev;
+		});
+	}
+
+	root["codeFile"] = m_codeFile;
+	root["cells"] = cells;
+	_out << util::jsonCompactPrint(root);
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2018-2021 TON DEV SOLUTIONS LTD.
+ *
+ * Licensed under the  terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License.
+ *
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the  GNU General Public License for more details at: https://www.gnu.org/licenses/gpl-3.0.html
+ */
+/**
+ * @author TON Labs <connect@tonlabs.io>
+ * @date 2021
+ * Source map of the generated code
+ */
+
+#pragma once
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <libsolidity/codegen/TvmAst.hpp>
+#include <libsolidity/codegen/TvmCell.hpp>
+
+namespace solidity::frontend
+{
+	// Maps the instructions of the functions to the source ranges and, if the contract is assembled,
+	// the bit offsets in the code cells to the instructions.
+	// An instruction index is the number of the instruction line in the textual assembly of the function,
+	// directives, comments and closing braces are not counted.
+	// Only the per-function maps apply to the deployed code, which the linker assembles from *.code:
+	// the cells are those of the experimental in-process assembler (--tvm-boc), which are not deployable.
+	class TvmSourceMap {
+	public:
+		// Source range of an instruction, see Loc
+		struct Span {
+			int fileId{-1};
+			int start{-1};
+			int end{-1};
+			int line{};
+			int column{};
+		};
+		// Function that is inlined into the parent frame by the call instruction with the index @a call.
+		// The outermost frames have no parent.
+		struct Frame {
+			int function{};
+			int parent{-1};
+			int call{-1};
+		};
+		// Instruction of a function, as it is inlined into the frame, at the bit offset of a code cell
+		struct Mark {
+			size_t offset{};
+			int frame{};
+			int index{};
+		};
+
+		// Collects the spans of the contract functions from their Loc nodes
+		void addContract(Contract& _contract);
+		// @returns the index of the function, adds it if it is new
+		int function(std::string const& _name);
+		// Sets the spans of the function unless they are known
+		void addSpans(int _function, std::vector<Span> _spans);
+		// @returns the index of the frame, adds it if it is new
+		int frame(Frame const& _frame);
+		// @returns the frame @a _frame that is inlined into @a _parent by the call @a _call
+		int rebase(int _frame, int _parent, int _call);
+		// Sets the marks of the cell unless they are known, equal cells are stored once
+		void addCell(Cell::Hash const& _hash, std::vector<Mark> _marks);
+		// Sets the file with the code assembled in process that the cells belong to. The cells are printed
+		// only if it is set, they do not match the code assembled by the linker.
+		void setCodeFile(std::string const& _fileName) { m_codeFile = _fileName; }
+		// @returns nullptr if the cell has no marks
+		std::vector<Mark> const* marks(Cell::Hash const& _hash) const;
+
+		// Prints the map as JSON. Lists are delta-encoded as in solc: entries are separated by ';',
+		// fields by ':', an empty field means the same value as in the previous entry.
+		// functions[i].map: start:length:source:line:column for each instruction
+		// cells[hash]: offset:frame:index for each instruction, offset is relative to the previous one,
+		// an empty index means the next one after the previous. Only with codeFile, the name of the *.code.boc
+		// file that has these cells.
+		void print(std::ostream& _out) const;
+	private:
+		std::vector<std::string> m_functionNames;
+		std::map<std::string, int> m_functionIds;
+		std::vector<std::vector<Span>> m_spans;
+		std::vector<Frame> m_frames;
+		std::map<std::tuple<int, int, int>, int> m_frameIds;
+		std::map<Cell::Hash, std::vector<Mark>> m_cells;
+		std::string m_codeFile;
+	};
+}	// end solidity::frontend
@@ -37,6 +37,7 @@
 #include <libsolidity/analysis/ViewPureChecker.h>
 
 #include <libsolidity/ast/AST.h>
+#include <libsolidity/ast/ASTVisitor.h>
 #include <libsolidity/ast/TypeProvider.h>
 #include <libsolidity/ast/ASTJsonImporter.h>
 #include <libsolidity/interface/Natspec.h>
@@ -54,6 +55,9 @@
 #include <json/json.h>
 #include <boost/algorithm/string.hpp>
 
+#include <atomic>
+#include <thread>
+
 #include <libsolidity/codegen/TVM.h>
 #include <libsolidity/codegen/TVMTypeChecker.hpp>
 #include <libsolidity/codegen/TVMAnalyzer.hpp>
@@ -193,6 +197,8 @@ void CompilerStack::reset(bool _keepSettings)
 	m_contracts.clear();
 	m_errorReporter.clear();
 	TypeProvider::reset();
+	m_astArena.reset();
+	m_importedSourceNames.clear();
 }
 
 void CompilerStack::setSources(StringMap _sources)
@@ -212,7 +218,7 @@ bool CompilerStack::parse()
 		BOOST_THROW_EXCEPTION(CompilerError() << errinfo_comment("Must call parse only after the SourcesSet state."));
 	m_errorReporter.clear();
 
-	Parser parser{m_errorReporter, m_evmVersion, m_parserErrorRecovery};
+	Parser parser{m_errorReporter, m_evmVersion, m_parserErrorRecovery, &m_astArena};
 	vector<string> sourcesToParse;
 	for (auto const& s: m_sources)
 		sourcesToParse.push_back(s.first);
@@ -253,7 +259,15 @@ void CompilerStack::importASTs(map<string, Json::Value> const& _sources)
 	if (m_stackState != Empty)
 		BOOST_THROW_EXCEPTION(CompilerError() << errinfo_comment("Must call importASTs only before the SourcesSet state."));
 	m_sourceJsons = _sources;
-	map<string, ASTPointer<SourceUnit>> reconstructedSources = ASTJsonImporter(m_evmVersion).jsonToSourceUnit(m_sourceJsons);
+	map<string, CharStream const*> sourceNames;
+	for (auto const& src: m_sourceJsons)
+	{
+		// Only the name of the source is used from the locations of the imported nodes
+		unique_ptr<CharStream>& name = m_importedSourceNames[src.first];
+		name = make_unique<CharStream>("", src.first);
+		sourceNames[src.first] = name.get();
+	}
+	map<string, ASTPointer<SourceUnit>> reconstructedSources = ASTJsonImporter(m_evmVersion, move(sourceNames)).jsonToSourceUnit(m_sourceJsons);
 	for (auto& src: reconstructedSources)
 	{
 		string const& path = src.first;
@@ -268,6 +282,67 @@ void CompilerStack::importASTs(map<string, Json::Value> const& _sources)
 	m_importedSources = true;
 }
 
+namespace
+{
+
+/// Creates the annotations of all visited nodes. Annotations are otherwise created on
+/// first access, which must not happen on several threads at once.
+class AnnotationInitializer: public ASTConstVisitor
+{
+protected:
+	bool visitNode(ASTNode const& _node) override
+	{
+		_node.annotation();
+		return true;
+	}
+};
+
+/// Calls @a _check for the indices 0 to @a _count - 1 on up to @a _threads threads.
+/// Every call reports to an error list of its own, which are merged into @a _errorReporter
+/// in the order of the indices afterwards, so the diagnostics do not depend on scheduling.
+/// If a call throws, the exception is rethrown after merging the errors up to that index,
+/// which is where a sequential run would have stopped.
+/// @returns false if any of the calls returned false.
+template <typename Check>
+bool checkConcurrently(size_t _count, unsigned _threads, ErrorReporter& _errorReporter, Check const& _check)
+{
+	vector<ErrorList> errors(_count);
+	vector<char> results(_count, true);
+	vector<exception_ptr> exceptions(_count);
+	atomic<size_t> next{0};
+	auto work = [&]() {
+		for (size_t i = next++; i < _count; i = next++)
+			try
+			{
+				ErrorReporter errorReporter(errors[i]);
+				results[i] = _check(i, errorReporter);
+			}
+			catch (...)
+			{
+				exceptions[i] = current_exception();
+			}
+	};
+
+	vector<thread> workers;
+	for (size_t i = 1; i < min<size_t>(_threads, _count); ++i)
+		workers.emplace_back(work);
+	work();
+	for (thread& worker: workers)
+		worker.join();
+
+	bool success = true;
+	for (size_t i = 0; i < _count; ++i)
+	{
+		_errorReporter.merge(errors[i]);
+		if (exceptions[i])
+			rethrow_exception(exceptions[i]);
+		success = success && results[i];
+	}
+	return success;
+}
+
+}
+
 bool CompilerStack::analyze()
 {
 	if (m_stackState != ParsingPerformed || m_stackState >= AnalysisPerformed)
@@ -344,48 +419,62 @@ bool CompilerStack::analyze()
 		//
 		// Note: this does not resolve overloaded functions. In order to do that, types of arguments are needed,
 		// which is only done one step later.
-		TypeChecker typeChecker(m_evmVersion, m_errorReporter);
+		vector<ContractDefinition const*> contracts;
+		vector<Source const*> sources;
 		for (Source const* source: m_sourceOrder)
 			if (source->ast)
-				for (ASTPointer<ASTNode> const& node: source->ast->nodes())
-					if (ContractDefinition* contract = dynamic_cast<ContractDefinition*>(node.get()))
-						if (!typeChecker.checkTypeRequirements(*contract))
-							noErrors = false;
+			{
+				sources.push_back(source);
+				for (ContractDefinition const* contract: ASTNode::filteredNodes<ContractDefinition>(source->ast->nodes()))
+					contracts.push_back(contract);
+			}
+
+		// The checks below are run per contract or per source unit, possibly on several threads.
+		if (m_analysisThreads > 1)
+		{
+			AnnotationInitializer annotationInitializer;
+			for (Source const* source: sources)
+				source->ast->accept(annotationInitializer);
+			for (Declaration const* declaration: m_globalContext->declarations())
+				declaration->annotation();
+		}
+
+		if (!checkConcurrently(contracts.size(), m_analysisThreads, m_errorReporter, [&](size_t _i, ErrorReporter& _errorReporter) {
+			return TypeChecker(m_evmVersion, _errorReporter).checkTypeRequirements(*contracts[_i]);
+		}))
+			noErrors = false;
 
 		if (noErrors)
 		{
 			// Checks that can only be done when all types of all AST nodes are known.
-			PostTypeChecker postTypeChecker(m_errorReporter);
-			for (Source const* source: m_sourceOrder)
-				if (source->ast && !postTypeChecker.check(*source->ast))
-					noErrors = false;
+			if (!checkConcurrently(sources.size(), m_analysisThreads, m_errorReporter, [&](size_t _i, ErrorReporter& _errorReporter) {
+				return PostTypeChecker(_errorReporter).check(*sources[_i]->ast);
+			}))
+				noErrors = false;
 		}
 
 		if (noErrors)
 		{
 			// Control flow graph generator and analyzer. It can check for issues such as
 			// variable is used before it is assigned to.
-			CFG cfg(m_errorReporter);
-			for (Source const* source: m_sourceOrder)
-				if (source->ast && !cfg.constructFlow(*source->ast))
-					noErrors = false;
-
-			if (noErrors)
-			{
-				ControlFlowAnalyzer controlFlowAnalyzer(cfg, m_errorReporter);
-				for (Source const* source: m_sourceOrder)
-					if (source->ast && !controlFlowAnalyzer.analyze(*source->ast))
-						noErrors = false;
-			}
+			// Constructing the graph does not report errors, so every source unit is analyzed
+			// right after its graph is constructed.
+			if (!checkConcurrently(sources.size(), m_analysisThreads, m_errorReporter, [&](size_t _i, ErrorReporter& _errorReporter) {
+				CFG cfg(_errorReporter);
+				return
+					cfg.constructFlow(*sources[_i]->ast) &&
+					ControlFlowAnalyzer(cfg, _errorReporter).analyze(*sources[_i]->ast);
+			}))
+				noErrors = false;
 		}
 
 		if (noErrors)
 		{
 			// Checks for common mistakes. Only generates warnings.
-			StaticAnalyzer staticAnalyzer(m_errorReporter);
-			for (Source const* source: m_sourceOrder)
-				if (source->ast && !staticAnalyzer.analyze(*source->ast))
-					noErrors = false;
+			if (!checkConcurrently(sources.size(), m_analysisThreads, m_errorReporter, [&](size_t _i, ErrorReporter& _errorReporter) {
+				return StaticAnalyzer(_errorReporter).analyze(*sources[_i]->ast);
+			}))
+				noErrors = false;
 		}
 
 		if (noErrors)
@@ -402,24 +491,21 @@ bool CompilerStack::analyze()
 
 		if (noErrors) {
 			//Checks for TVM specific issues.
-			TVMAnalyzer tvmAnalyzer(m_errorReporter, m_structWarning);
-			for (Source const* source: m_sourceOrder)
-				if (source->ast && !tvmAnalyzer.analyze(*source->ast))
-					noErrors = false;
+			if (!checkConcurrently(sources.size(), m_analysisThreads, m_errorReporter, [&](size_t _i, ErrorReporter& _errorReporter) {
+				return TVMAnalyzer(_errorReporter, m_structWarning).analyze(*sources[_i]->ast);
+			}))
+				noErrors = false;
 		}
 
 		if (noErrors)
 		{
-
-			for (Source const* source: m_sourceOrder) {
-
-				std::vector<PragmaDirective const *> pragmaDirectives = getPragmaDirectives(source);
-				TVMTypeChecker checker(m_errorReporter, pragmaDirectives);
-				source->ast->accept(checker);
-				if (m_errorReporter.hasErrors()) {
-					noErrors = false;
-				}
-			}
+			if (!checkConcurrently(sources.size(), m_analysisThreads, m_errorReporter, [&](size_t _i, ErrorReporter& _errorReporter) {
+				vector<PragmaDirective const*> pragmaDirectives = getPragmaDirectives(sources[_i]);
+				TVMTypeChecker checker(_errorReporter, pragmaDirectives);
+				sources[_i]->ast->accept(checker);
+				return !_errorReporter.hasErrors();
+			}))
+				noErrors = false;
 		}
 	}
 	catch (FatalError const&)
@@ -512,7 +598,7 @@ std::pair<bool, bool> CompilerStack::compile()
 
 			if (!m_mainContract.empty()) {
 				if (contract->name() == m_mainContract) {
-					if (m_generateCode && !contract->canBeDeployed()) {
+					if ((m_generateCode || m_generateBoc || m_generateSourceMap) && !contract->canBeDeployed()) {
 						m_errorReporter.typeError(
 								contract->location(),
 								"The desired contract isn't deployable (it has not public constructor or it's abstract or it's interface or it's library)."
@@ -523,7 +609,7 @@ std::pair<bool, bool> CompilerStack::compile()
 					targetPragmaDirectives = pragmaDirectives;
 				}
 			} else {
-				if (m_generateAbi && !m_generateCode) {
+				if (m_generateAbi && !m_generateCode && !m_generateBoc && !m_generateSourceMap) {
 					if (targetContract != nullptr) {
 						m_errorReporter.typeError(
 								targetContract->location(),
@@ -570,6 +656,9 @@ std::pair<bool, bool> CompilerStack::compile()
 				&targetPragmaDirectives,
 				m_generateAbi,
 				m_generateCode,
+				m_generateBoc,
+				m_generateSourceMap,
+				m_tvmLibraryPath,
 				m_inputFile,
 				m_folder,
 				m_file_prefix,
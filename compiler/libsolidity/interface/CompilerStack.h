@@ -32,12 +32,14 @@
 #include <liblangutil/EVMVersion.h>
 #include <liblangutil/SourceLocation.h>
 
+#include <libsolutil/Arena.h>
 #include <libsolutil/Common.h>
 #include <libsolutil/FixedHash.h>
 
 #include <boost/noncopyable.hpp>
 #include <json/json.h>
 
+#include <algorithm>
 #include <functional>
 #include <memory>
 #include <ostream>
@@ -163,6 +165,13 @@ public:
 		m_requestedContractNames = _contractNames;
 	}
 
+	/// Sets the number of threads the checks after name resolution are run on.
+	/// They are run per contract or per source unit, the diagnostics do not depend on it.
+	/// Must be set before analysis.
+	void setAnalysisThreads(unsigned _threads) {
+		m_analysisThreads = std::max(_threads, 1u);
+	}
+
 	void setStructWarning(bool _structWarning) {
 		m_structWarning = _structWarning;
 	}
@@ -183,6 +192,15 @@ public:
 		m_generateCode = true;
 	}
 
+	void generateBoc(std::string const& tvmLibraryPath) {
+		m_generateBoc = true;
+		m_tvmLibraryPath = tvmLibraryPath;
+	}
+
+	void generateSourceMap() {
+		m_generateSourceMap = true;
+	}
+
 	void setOutputFolder(const std::string& folder) {
 		m_folder = folder;
 	}
@@ -451,6 +469,12 @@ private:
 	/// list of path prefix remappings, e.g. mylibrary: github.com/ethereum = /usr/local/ethereum
 	/// "context:prefix=target"
 	std::vector<Remapping> m_remappings;
+	/// Memory of the parsed AST nodes. Declared before everything that can refer to them,
+	/// so that it is released last.
+	util::Arena m_astArena;
+	/// Streams without text that name the sources of imported ASTs in their source locations.
+	/// Declared before the sources for the same reason as the arena.
+	std::map<std::string, std::unique_ptr<langutil::CharStream>> m_importedSourceNames;
 	std::map<std::string const, Source> m_sources;
 	// if imported, store AST-JSONS for each filename
 	std::map<std::string, Json::Value> m_sourceJsons;
@@ -473,9 +497,13 @@ private:
 	bool m_hasError = false;
 	bool m_release = VersionIsRelease;
 	bool m_structWarning = false;
+	unsigned m_analysisThreads = 1;
 	std::string m_mainContract;
 	bool m_generateAbi{};
 	bool m_generateCode{};
+	bool m_generateBoc{};
+	std::string m_tvmLibraryPath;
+	bool m_generateSourceMap{};
 	bool m_withOptimizations{};
 	bool m_withDebugInfo{};
 	std::string m_folder;
@@ -27,6 +27,7 @@
 #include <liblangutil/Scanner.h>
 #include <liblangutil/SemVerHandler.h>
 #include <liblangutil/SourceLocation.h>
+#include <libsolutil/Arena.h>
 #include <cctype>
 #include <vector>
 
@@ -60,6 +61,13 @@ public:
 		solAssert(m_location.source, "");
 		if (m_location.end < 0)
 			markEndPosition();
+		if (m_parser.m_astArena)
+			return allocate_shared<NodeType>(
+				util::ArenaAllocator<NodeType>(*m_parser.m_astArena),
+				m_parser.nextID(),
+				m_location,
+				std::forward<Args>(_args)...
+			);
 		return make_shared<NodeType>(m_parser.nextID(), m_location, std::forward<Args>(_args)...);
 	}
 
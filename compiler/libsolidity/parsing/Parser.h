@@ -31,19 +31,28 @@ namespace solidity::langutil
 class Scanner;
 }
 
+namespace solidity::util
+{
+class Arena;
+}
+
 namespace solidity::frontend
 {
 
 class Parser: public langutil::ParserBase
 {
 public:
+	/// If @a _astArena is given, the AST nodes are allocated from it, so it has to
+	/// outlive all of them.
 	explicit Parser(
 		langutil::ErrorReporter& _errorReporter,
 		langutil::EVMVersion _evmVersion,
-		bool _errorRecovery = false
+		bool _errorRecovery = false,
+		util::Arena* _astArena = nullptr
 	):
 		ParserBase(_errorReporter, _errorRecovery),
-		m_evmVersion(_evmVersion)
+		m_evmVersion(_evmVersion),
+		m_astArena(_astArena)
 	{}
 
 	ASTPointer<SourceUnit> parse(std::shared_ptr<langutil::Scanner> const& _scanner);
@@ -211,6 +220,8 @@ private:
 	/// Flag that signifies whether '_' is parsed as a PlaceholderStatement or a regular identifier.
 	bool m_insideModifier = false;
 	langutil::EVMVersion m_evmVersion;
+	/// Memory for the AST nodes, nullptr to allocate them on the heap.
+	util::Arena* m_astArena = nullptr;
 	/// Counter for the next AST node ID
 	int64_t m_currentNodeID = 0;
 	
@@ -0,0 +1,115 @@
+/*
+	This file is part of solidity.
+
+	solidity is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	solidity is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with solidity.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * Monotonic memory arena and an allocator on top of it.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace solidity::util
+{
+
+/**
+ * Hands out memory from large chunks by bumping a pointer. Individual allocations
+ * are never freed, all memory is released at once by reset() or the destructor,
+ * so every object placed into the arena has to be destroyed before that.
+ * Not thread-safe.
+ */
+class Arena
+{
+public:
+	Arena() = default;
+	Arena(Arena const&) = delete;
+	Arena& operator=(Arena const&) = delete;
+
+	void* allocate(size_t _size, size_t _alignment)
+	{
+		uintptr_t current = (reinterpret_cast<uintptr_t>(m_current) + _alignment - 1) & ~uintptr_t(_alignment - 1);
+		if (m_current && current + _size <= reinterpret_cast<uintptr_t>(m_end))
+		{
+			m_current = reinterpret_cast<char*>(current + _size);
+			return reinterpret_cast<void*>(current);
+		}
+		return allocateInNewChunk(_size, _alignment);
+	}
+
+	/// Releases all memory of the arena.
+	void reset()
+	{
+		m_chunks.clear();
+		m_current = m_end = nullptr;
+	}
+
+private:
+	static size_t constexpr ChunkSize = 64 * 1024;
+
+	void* allocateInNewChunk(size_t _size, size_t _alignment)
+	{
+		size_t const chunkSize = std::max(ChunkSize, _size + _alignment);
+		m_chunks.emplace_back(new char[chunkSize]);
+		char* chunk = m_chunks.back().get();
+		// Oversized requests get a chunk of their own and leave the current one in use.
+		if (chunkSize > ChunkSize)
+			return reinterpret_cast<void*>(
+				(reinterpret_cast<uintptr_t>(chunk) + _alignment - 1) & ~uintptr_t(_alignment - 1)
+			);
+		m_current = chunk;
+		m_end = chunk + chunkSize;
+		return allocate(_size, _alignment);
+	}
+
+	std::vector<std::unique_ptr<char[]>> m_chunks;
+	char* m_current = nullptr;
+	char* m_end = nullptr;
+};
+
+/**
+ * Standard allocator that takes its memory from an Arena. Deallocation is a no-op.
+ * Can be used with std::allocate_shared, in which case the control block is placed
+ * into the arena together with the object.
+ */
+template <class T>
+class ArenaAllocator
+{
+public:
+	using value_type = T;
+
+	explicit ArenaAllocator(Arena& _arena) noexcept: m_arena(&_arena) {}
+	template <class U>
+	ArenaAllocator(ArenaAllocator<U> const& _other) noexcept: m_arena(&_other.arena()) {}
+
+	T* allocate(size_t _n) { return static_cast<T*>(m_arena->allocate(_n * sizeof(T), alignof(T))); }
+	void deallocate(T*, size_t) noexcept {}
+
+	Arena& arena() const noexcept { return *m_arena; }
+
+	template <class U>
+	bool operator==(ArenaAllocator<U> const& _other) const noexcept { return m_arena == &_other.arena(); }
+	template <class U>
+	bool operator!=(ArenaAllocator<U> const& _other) const noexcept { return !(*this == _other); }
+
+private:
+	Arena* m_arena;
+};
+
+}
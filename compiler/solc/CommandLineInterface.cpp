@@ -118,10 +118,16 @@ static string const g_argVersion = g_strVersion;
 static string const g_argSetContract = "contract";
 static string const g_argTvm = "tvm";
 static string const g_argTvmABI = "tvm-abi";
+#ifdef TVM_BOC
+static string const g_argTvmBoc = "tvm-boc";
+static string const g_argTvmLib = "tvm-lib";
+#endif
+static string const g_argTvmSourceMap = "tvm-source-map";
 static string const g_argTvmOptimize = "tvm-optimize";
 static string const g_argRefreshRemote = "tvm-refresh-remote";
 static string const g_argTvmUnsavedStructs = "tvm-unsaved-structs";
 static string const g_argFunctionIds = "function-ids";
+static string const g_argAnalysisThreads = "analysis-threads";
 
 
 static void version()
@@ -282,7 +288,20 @@ Allowed options)",
 			po::value<string>()->value_name("prefixName"),
 			"Set prefix of names of output files (*.code and *abi.json)."
 		)
+		(
+			g_argAnalysisThreads.c_str(),
+			po::value<unsigned>()->value_name("n"),
+			"Run the semantic checks of independent contracts on up to n threads."
+		)
 		;
+#ifdef TVM_BOC
+	desc.add_options()
+		(
+			g_argTvmLib.c_str(),
+			po::value<string>()->value_name("path/to/stdlib_sol.tvm"),
+			"Set the library for --tvm-boc. Defaults to the TVM_LINKER_LIB_PATH environment variable."
+		);
+#endif
 	po::options_description outputComponents("Output Components");
 	outputComponents.add_options()
 		(g_argAstJson.c_str(), "AST of all source files in JSON format.")
@@ -291,10 +310,25 @@ Allowed options)",
 		(g_argNatspecDev.c_str(), "Natspec developer documentation of all contracts.")
 		(g_argTvm.c_str(), "Produce TVM assembly (deprecated).")
 		(g_argTvmABI.c_str(), "Produce JSON ABI for contract.")
+		(
+			g_argTvmSourceMap.c_str(),
+			"Produce source map of the code (*.map.json): the source range of each instruction of the functions "
+			"in *.code. Traces of the code assembled by the linker cannot be mapped to the source."
+		)
 		(g_argFunctionIds.c_str(), "Print name and id for each public function.")
 		(g_argTvmOptimize.c_str(), "It's deprecated.")
 		(g_argTvmUnsavedStructs.c_str(), "Enable struct usage analyzer.")
 		(g_argRefreshRemote.c_str(), "Force download and rewrite remote import files.");
+#ifdef TVM_BOC
+	outputComponents.add_options()
+		(
+			g_argTvmBoc.c_str(),
+			"Assemble the code of the contract in process and save the code cell as a bag of cells (*.code.boc). "
+			"It has no data, so it is not a deployable StateInit, and its cells may differ from the ones the linker "
+			"builds for the same *.code. Requires --tvm-lib. Experimental. With --tvm-source-map the map also has "
+			"the instructions of each cell of *.code.boc."
+		);
+#endif
 	desc.add(outputComponents);
 
 	po::options_description allOptions = desc;
@@ -406,6 +440,9 @@ bool CommandLineInterface::processInput()
 		if (m_args.count(g_argRefreshRemote))
 		    m_compiler->setForceUpdate(true);
 
+		if (m_args.count(g_argAnalysisThreads))
+			m_compiler->setAnalysisThreads(m_args[g_argAnalysisThreads].as<unsigned>());
+
 		if (m_args.count(g_argSetContract))
 			m_compiler->setMainContract(m_args[g_argSetContract].as<string>());
 
@@ -419,6 +456,23 @@ bool CommandLineInterface::processInput()
 			m_compiler->generateAbi();
 		if (m_args.count(g_argTvm))
 			m_compiler->generateCode();
+#ifdef TVM_BOC
+		if (m_args.count(g_argTvmBoc)) {
+			string tvmLibraryPath;
+			if (m_args.count(g_argTvmLib))
+				tvmLibraryPath = m_args[g_argTvmLib].as<string>();
+			else if (char const* path = getenv("TVM_LINKER_LIB_PATH"))
+				tvmLibraryPath = path;
+			if (tvmLibraryPath.empty()) {
+				serr() << "Option --" << g_argTvmBoc << " requires --" << g_argTvmLib
+					<< " or the TVM_LINKER_LIB_PATH environment variable." << endl;
+				return false;
+			}
+			m_compiler->generateBoc(tvmLibraryPath);
+		}
+#endif
+		if (m_args.count(g_argTvmSourceMap))
+			m_compiler->generateSourceMap();
 		if (
 			m_args.count(g_argTvm) == 0 &&
 			m_args.count(g_argTvmABI) == 0 &&
@@ -0,0 +1,72 @@
+#!/usr/bin/env bash
+
+#------------------------------------------------------------------------------
+# Bash script to run the replay tests of the gas profiler.
+#
+# Usage: gasProfilerTests.sh <path to solc> <path to gas-profiler> <path to stdlib_sol.tvm>
+#
+# Each directory in test/gasProfilerTests has the source of a contract
+# (input.sol) and a trace of an execution of its code (trace). The source map
+# is created by solc, which must be built with TVM_BOC, and the profile printed
+# by gas-profiler is compared with the expected files output, folded and
+# annotated.
+#
+# The trace refers to the code cells by their hashes, so it must be updated if
+# the code cells change.
+# ------------------------------------------------------------------------------
+# This file is part of solidity.
+#
+# solidity is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# solidity is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with solidity.  If not, see <http://www.gnu.org/licenses/>
+#------------------------------------------------------------------------------
+
+set -e
+
+SOLC=$(realpath "$1")
+GAS_PROFILER=$(realpath "$2")
+TVM_LIB=$(realpath "$3")
+TESTS_DIR=$(cd "$(dirname "$0")" && pwd)/gasProfilerTests
+WORK_DIR=$(mktemp -d)
+trap 'rm -rf "$WORK_DIR"' EXIT
+
+failed=0
+for tdir in "$TESTS_DIR"/*/
+do
+    name=$(basename "$tdir")
+    echo " - $name"
+    mkdir "$WORK_DIR/$name"
+    cd "$WORK_DIR/$name"
+    cp "$tdir/input.sol" .
+    if ! "$SOLC" --tvm-boc --tvm-lib "$TVM_LIB" --tvm-source-map input.sol > /dev/null
+    then
+        echo "Compilation of $name failed"
+        failed=1
+        continue
+    fi
+    if ! "$GAS_PROFILER" --map input.map.json --folded folded --annotate annotated "$tdir/trace" > output 2>&1
+    then
+        cat output
+        echo "Profiling of $name failed"
+        failed=1
+        continue
+    fi
+    for file in output folded annotated
+    do
+        if ! diff -u "$tdir/$file" "$file"
+        then
+            echo "Unexpected $file of $name"
+            failed=1
+        fi
+    done
+done
+exit $failed
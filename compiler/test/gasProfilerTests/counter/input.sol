@@ -0,0 +1,16 @@
+pragma ton-solidity >= 0.50.0;
+
+contract Counter {
+	uint m_sum;
+
+	function add(uint n) public {
+		tvm.accept();
+		for (uint i = 0; i < n; ++i) {
+			m_sum += square(i);
+		}
+	}
+
+	function square(uint x) private pure returns (uint) {
+		return x * x;
+	}
+}
@@ -0,0 +1,314 @@
+/*
+	This file is part of solidity.
+
+	solidity is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	solidity is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with solidity.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * Unit tests for the in-process TVM assembler: encodings of single instructions,
+ * taken from the instruction table of the TVM specification, and the cell serialization.
+ */
+
+#define BOOST_TEST_MODULE TvmAssemblerTest
+
+#include <libsolidity/codegen/TvmAssembler.hpp>
+#include <libsolidity/codegen/TvmCell.hpp>
+
+#include <libsolutil/CommonData.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace solidity::frontend::test
+{
+
+namespace
+{
+
+/// @returns the bits of the builder in hex, with the completion tag if they are not whole nibbles.
+string toHex(CellBuilder const& _b)
+{
+	CellBuilder padded;
+	padded.append(_b);
+	bool const tagged = padded.bitSize() % 4 != 0;
+	if (tagged)
+	{
+		padded.storeBit(true);
+		while (padded.bitSize() % 4 != 0)
+			padded.storeBit(false);
+	}
+	string res;
+	for (size_t i = 0; i < padded.bitSize(); i += 4)
+	{
+		unsigned nibble = 0;
+		for (size_t j = 0; j < 4; ++j)
+			nibble = nibble << 1 | (padded.bit(i + j) ? 1 : 0);
+		res += "0123456789ABCDEF"[nibble];
+	}
+	return tagged ? res + "_" : res;
+}
+
+void checkEncodings(vector<pair<string, string>> const& _cases)
+{
+	for (auto const& [line, hex]: _cases)
+		BOOST_CHECK_MESSAGE(
+			toHex(TvmAssembler::instruction(line)) == hex,
+			line << ": expected " << hex << ", got " << toHex(TvmAssembler::instruction(line))
+		);
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(TvmAssemblerTest)
+
+BOOST_AUTO_TEST_CASE(stack_manipulation)
+{
+	checkEncodings({
+		{"NOP", "00"},
+		{"SWAP", "01"},
+		{"XCHG S2", "02"},
+		{"XCHG S1, S5", "15"},
+		{"XCHG S2, S5", "1025"},
+		{"DUP", "20"},
+		{"PUSH S3", "23"},
+		{"PUSH S20", "5614"},
+		{"DROP", "30"},
+		{"POP S3", "33"},
+		{"POP S20", "5714"},
+		{"XCHG2 S1, S2", "5012"},
+		{"PUSH2 S1, S2", "5312"},
+		{"PUSH3 S1, S2, S3", "547123"},
+		{"ROT", "58"},
+		{"ROLL 3", "5502"},
+		{"ROLLREV 3", "5520"},
+		{"BLKSWAP 2, 3", "5512"},
+		{"REVERSE 3, 1", "5E11"},
+		{"BLKDROP 3", "5F03"},
+		{"BLKPUSH 2, 1", "5F21"},
+		{"BLKDROP2 2, 1", "6C21"},
+		{"TUCK", "66"},
+		{"DEPTH", "68"},
+	});
+}
+
+BOOST_AUTO_TEST_CASE(constants)
+{
+	checkEncodings({
+		{"PUSHINT 0", "70"},
+		{"PUSHINT 10", "7A"},
+		{"PUSHINT -1", "7F"},
+		{"PUSHINT -5", "7B"},
+		{"PUSHINT 11", "800B"},
+		{"PUSHINT -128", "8080"},
+		{"PUSHINT 1000", "8103E8"},
+		{"PUSHINT 100000", "820186A0"},
+		{"PUSHPOW2 8", "8307"},
+		{"PUSHPOW2DEC 256", "84FF"},
+		{"PUSHSLICE x4_", "8B04"},
+		{"PUSHSLICE xABCD", "8B2ABCD8"},
+		{"NULL", "6D"},
+		{"TRUE", "7F"},
+		{"FALSE", "70"},
+		{"STSLICECONST 0", "CF81"},
+		{"STSLICECONST 1", "CF83"},
+		{"STSLICECONST xAB", "CF86AE"},
+	});
+}
+
+BOOST_AUTO_TEST_CASE(arithmetic_and_comparison)
+{
+	checkEncodings({
+		{"ADD", "A0"},
+		{"SUB", "A1"},
+		{"INC", "A4"},
+		{"DEC", "A5"},
+		{"ADDCONST 5", "A605"},
+		{"MULCONST -1", "A7FF"},
+		{"MUL", "A8"},
+		{"DIV", "A904"},
+		{"MOD", "A908"},
+		{"DIVMOD", "A90C"},
+		{"MODPOW2 8", "A93807"},
+		{"LSHIFT 3", "AA02"},
+		{"RSHIFT 3", "AB02"},
+		{"AND", "B0"},
+		{"NOT", "B3"},
+		{"FITS 8", "B407"},
+		{"UFITS 8", "B507"},
+		{"LESS", "B9"},
+		{"EQUAL", "BA"},
+		{"EQINT 5", "C005"},
+		{"LESSINT 5", "C105"},
+		{"GTINT 5", "C205"},
+		{"NEQINT 5", "C305"},
+		{"ISNULL", "6E"},
+	});
+}
+
+BOOST_AUTO_TEST_CASE(tuples)
+{
+	checkEncodings({
+		{"NIL", "6F00"},
+		{"PAIR", "6F02"},
+		{"TUPLE 5", "6F05"},
+		{"INDEX 3", "6F13"},
+		{"FIRST", "6F10"},
+		{"UNTUPLE 2", "6F22"},
+		{"UNPAIR", "6F22"},
+		{"SETINDEX 1", "6F51"},
+		{"INDEXQ 1", "6F61"},
+		{"SETINDEXQ 1", "6F71"},
+		{"INDEXVAR", "6F81"},
+		{"SETINDEXVAR", "6F85"},
+		{"TLEN", "6F88"},
+		{"TPUSH", "6F8C"},
+		{"NULLSWAPIFNOT", "6FA1"},
+		{"INDEX2 1, 0", "6FB4"},
+		{"INDEX3 1, 1, 0", "6FD4"},
+	});
+}
+
+BOOST_AUTO_TEST_CASE(cells_and_slices)
+{
+	checkEncodings({
+		{"NEWC", "C8"},
+		{"ENDC", "C9"},
+		{"STI 8", "CA07"},
+		{"STU 32", "CB1F"},
+		{"STREF", "CC"},
+		{"STSLICE", "CE"},
+		{"STREFR", "CF14"},
+		{"STUR 8", "CF0B07"},
+		{"STZEROES", "CF40"},
+		{"CTOS", "D0"},
+		{"ENDS", "D1"},
+		{"LDI 8", "D207"},
+		{"LDU 256", "D3FF"},
+		{"LDREF", "D4"},
+		{"LDSLICE 8", "D607"},
+		{"PLDU 64", "D70B3F"},
+		{"LDUQ 8", "D70D07"},
+		{"PLDREF", "D74C"},
+		{"SBITS", "D749"},
+		{"SEMPTY", "C700"},
+		{"SDEQ", "C705"},
+	});
+}
+
+BOOST_AUTO_TEST_CASE(control_flow)
+{
+	checkEncodings({
+		{"EXECUTE", "D8"},
+		{"JMPX", "D9"},
+		{"RET", "DB30"},
+		{"RETALT", "DB31"},
+		{"IFRET", "DC"},
+		{"IFNOTRET", "DD"},
+		{"IF", "DE"},
+		{"IFNOT", "DF"},
+		{"IFELSE", "E2"},
+		{"CONDSEL", "E304"},
+		{"REPEAT", "E4"},
+		{"UNTIL", "E6"},
+		{"WHILE", "E8"},
+		{"AGAIN", "EA"},
+		{"CALL 3", "F003"},
+		{"CALL 1000", "F103E8"},
+		{"THROW 5", "F205"},
+		{"THROWIF 63", "F27F"},
+		{"THROWIFNOT 50", "F2B2"},
+		{"THROW 100", "F2C064"},
+		{"THROWIF 100", "F2D064"},
+		{"THROWIFNOT 100", "F2E064"},
+		{"THROWANY", "F2F0"},
+		{"TRY", "F2FF"},
+		{"SETCP0", "FF00"},
+	});
+}
+
+BOOST_AUTO_TEST_CASE(dictionaries)
+{
+	checkEncodings({
+		{"STDICT", "F400"},
+		{"LDDICT", "F404"},
+		{"PLDDICT", "F405"},
+		{"DICTGET", "F40A"},
+		{"DICTUGET", "F40E"},
+		{"DICTUGETREF", "F40F"},
+		{"DICTUSET", "F416"},
+		{"DICTUSETB", "F443"},
+		{"DICTUSETGETB", "F447"},
+		{"DICTUSETGETREF", "F41F"},
+		{"DICTUDEL", "F45B"},
+		{"DICTUDELGET", "F466"},
+		{"DICTUDELGETREF", "F467"},
+		{"DICTUGETNEXT", "F47C"},
+		{"DICTUMIN", "F486"},
+		{"DICTUMAX", "F48E"},
+		{"DICTUGETJMP", "F4A1"},
+	});
+}
+
+BOOST_AUTO_TEST_CASE(application_specific)
+{
+	checkEncodings({
+		{"ACCEPT", "F800"},
+		{"NOW", "F823"},
+		{"BALANCE", "F827"},
+		{"MYADDR", "F828"},
+		{"GETPARAM 7", "F827"},
+		{"GETGLOB 9", "F849"},
+		{"SETGLOB 9", "F869"},
+		{"HASHCU", "F900"},
+		{"CHKSIGNU", "F910"},
+		{"LDGRAMS", "FA00"},
+		{"STGRAMS", "FA02"},
+		{"LDMSGADDR", "FA40"},
+		{"SENDRAWMSG", "FB00"},
+		{"RAWRESERVE", "FB02"},
+		{"SETCODE", "FB04"},
+		{"PUSHROOT", "ED44"},
+		{"POPROOT", "ED54"},
+		{"POP C3", "ED53"},
+	});
+}
+
+BOOST_AUTO_TEST_CASE(empty_cell)
+{
+	CellPtr cell = CellBuilder{}.build();
+	BOOST_CHECK_EQUAL(
+		util::toHex(bytes(cell->hash().begin(), cell->hash().end())),
+		"96a296d224f285c67bee93c30f8a309157f0daa35dc5b87e410b78630a09cfc7"
+	);
+	BOOST_CHECK_EQUAL(util::toHex(serializeBagOfCells(cell)), "b5ee9c72410101010002000000" "4cacb9cd");
+}
+
+BOOST_AUTO_TEST_CASE(cell_with_reference)
+{
+	CellBuilder b;
+	b.storeHex("AB").storeRef(CellBuilder{}.storeUInt(1, 1).build());
+	CellPtr cell = b.build();
+	BOOST_CHECK_EQUAL(cell->bitSize(), 8);
+	BOOST_CHECK_EQUAL(cell->depth(), 1);
+	BOOST_CHECK_EQUAL(util::toHex(cell->descriptorsAndData()), "0102ab");
+	BOOST_CHECK_EQUAL(util::toHex(cell->refs().at(0)->descriptorsAndData()), "0001c0");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
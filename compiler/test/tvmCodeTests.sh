@@ -0,0 +1,92 @@
+#!/usr/bin/env bash
+
+#------------------------------------------------------------------------------
+# Bash script to run the tests of the generated TVM assembly.
+#
+# Usage: tvmCodeTests.sh <path to solc> [<path to stdlib_sol.tvm>]
+#
+# Each directory in test/tvmCodeTests has a contract (input.sol) and the
+# assembly that solc is expected to generate for it (input.code). Run the
+# script with UPDATE=1 to overwrite the expected assembly with the generated
+# one, then review the changes.
+#
+# If solc is built with TVM_BOC and the library is given, the directories
+# that have the code cell (input.code.boc) also check the output of the
+# in-process assembler, which is compared byte by byte. The directories that
+# have the source map (input.map.json) check it as well, with the cells only
+# if the code cell is checked.
+# ------------------------------------------------------------------------------
+# This file is part of solidity.
+#
+# solidity is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# solidity is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with solidity.  If not, see <http://www.gnu.org/licenses/>
+#------------------------------------------------------------------------------
+
+set -e
+
+SOLC=$(realpath "$1")
+TVM_LIB=${2:+$(realpath "$2")}
+TESTS_DIR=$(cd "$(dirname "$0")" && pwd)/tvmCodeTests
+WORK_DIR=$(mktemp -d)
+trap 'rm -rf "$WORK_DIR"' EXIT
+
+failed=0
+for tdir in "$TESTS_DIR"/*/
+do
+    name=$(basename "$tdir")
+    echo " - $name"
+    mkdir "$WORK_DIR/$name"
+    cd "$WORK_DIR/$name"
+    cp "$tdir/input.sol" .
+    options=()
+    checkBoc=0
+    checkMap=0
+    if [[ -n "$TVM_LIB" && -f "$tdir/input.code.boc" ]]
+    then
+        options+=(--tvm-boc --tvm-lib "$TVM_LIB")
+        checkBoc=1
+    fi
+    # The map has the cells only if the code cell is assembled
+    if [[ -f "$tdir/input.map.json" && ( ! -f "$tdir/input.code.boc" || $checkBoc == 1 ) ]]
+    then
+        options+=(--tvm-source-map)
+        checkMap=1
+    fi
+    if ! "$SOLC" "${options[@]}" input.sol > /dev/null
+    then
+        echo "Compilation of $name failed"
+        failed=1
+    elif [[ "$UPDATE" == 1 ]]
+    then
+        cp input.code "$tdir/input.code"
+        [[ $checkBoc == 0 ]] || cp input.code.boc "$tdir/input.code.boc"
+        [[ $checkMap == 0 ]] || cp input.map.json "$tdir/input.map.json"
+    else
+        if ! diff -u "$tdir/input.code" input.code
+        then
+            echo "Unexpected assembly of $name"
+            failed=1
+        fi
+        if [[ $checkBoc == 1 ]] && ! cmp "$tdir/input.code.boc" input.code.boc
+        then
+            echo "Unexpected code cell of $name"
+            failed=1
+        fi
+        if [[ $checkMap == 1 ]] && ! diff -u "$tdir/input.map.json" input.map.json
+        then
+            echo "Unexpected source map of $name"
+            failed=1
+        fi
+    fi
+done
+exit $failed
@@ -0,0 +1,57 @@
+pragma ton-solidity >= 0.50.0;
+
+contract DictReadAndChange {
+	struct Point {
+		uint32 x;
+		uint32 y;
+	}
+
+	mapping(uint32 => uint64) m_counters;
+	mapping(uint32 => Point) m_points;
+	mapping(uint32 => TvmCell) m_cells;
+
+	// DICTUDELGET, the value is decoded from the returned slice
+	function takeCounter(uint32 key) public returns (uint64) {
+		uint64 value = m_counters[key];
+		delete m_counters[key];
+		return value;
+	}
+
+	// DICTUSETGETB, the old value is decoded from the returned slice
+	function swapCounter(uint32 key, uint64 newValue) public returns (uint64 old) {
+		old = m_counters[key];
+		m_counters[key] = newValue;
+	}
+
+	// The struct value is built into a builder for DICTUSETGETB
+	function movePoint(uint32 key, uint32 x) public returns (Point) {
+		Point p = m_points[key];
+		m_points[key] = Point(x, x);
+		return p;
+	}
+
+	function takePoint(uint32 key) public returns (Point) {
+		Point p = m_points[key];
+		delete m_points[key];
+		return p;
+	}
+
+	// DICTUDELGETREF and DICTUSETGETREF for the cell values
+	function takeCell(uint32 key) public returns (TvmCell) {
+		TvmCell c = m_cells[key];
+		delete m_cells[key];
+		return c;
+	}
+
+	function swapCell(uint32 key, TvmCell c) public returns (TvmCell) {
+		TvmCell old = m_cells[key];
+		m_cells[key] = c;
+		return old;
+	}
+
+	// The new value reads the variable that is assigned: not fused
+	function notFused(uint32 key) public returns (uint64 value) {
+		value = m_counters[key];
+		m_counters[key] = value + 1;
+	}
+}
@@ -0,0 +1,33 @@
+pragma ton-solidity >= 0.50.0;
+
+contract MappingIteration {
+	struct Point {
+		uint32 x;
+		uint32 y;
+	}
+
+	mapping(uint32 => Point) m_points;
+	mapping(int8 => uint) m_balances;
+
+	// The key is passed back to DICTUGETNEXT as it is returned, the value is not decoded
+	function countKeys() public view returns (uint32 sum) {
+		for ((uint32 key, ) : m_points) {
+			sum += key;
+		}
+	}
+
+	// The value is decoded at the start of the body, DICTIGETNEXT for the signed keys
+	function total() public view returns (uint sum) {
+		for ((, uint value) : m_balances) {
+			sum += value;
+		}
+	}
+
+	// The key is changed in the body, a separate copy is kept
+	function sumX() public view returns (uint32 sum) {
+		for ((uint32 key, Point p) : m_points) {
+			key += p.x;
+			sum += key;
+		}
+	}
+}
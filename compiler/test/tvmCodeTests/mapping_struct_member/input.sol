@@ -0,0 +1,62 @@
+pragma ton-solidity >= 0.50.0;
+
+contract MappingStructMember {
+	struct Small {
+		uint32 a;
+		uint64 b;
+		bool c;
+	}
+
+	struct Nested {
+		uint8 tag;
+		Small small;
+	}
+
+	// Too big for a leaf with a 256-bit key, the value is stored in a ref
+	struct Big {
+		uint256 a;
+		uint256 b;
+		uint256 c;
+		uint64 d;
+	}
+
+	// Encoded into two cells
+	struct Huge {
+		uint256 a;
+		uint256 b;
+		uint256 c;
+		uint256 d;
+	}
+
+	mapping(uint32 => Small) m_small;
+	mapping(uint32 => Nested) m_nested;
+	mapping(uint256 => Big) m_big;
+	mapping(uint32 => Huge) m_huge;
+
+	// The member is replaced in the slice of the value, it is not decoded and encoded again
+	function setA(uint32 key, uint32 value) public {
+		m_small[key].a = value;
+	}
+
+	function incB(uint32 key) public {
+		m_small[key].b += 1;
+	}
+
+	function setC(uint32 key) public returns (bool) {
+		return m_small[key].c = true;
+	}
+
+	function setNested(uint32 key, uint64 value) public {
+		m_nested[key].small.b = value;
+	}
+
+	// DICTUGETREF and DICTUSETREF
+	function incBig(uint256 key) public {
+		m_big[key].d += 2;
+	}
+
+	// Not replaced in place: the value is decoded and encoded again
+	function setHuge(uint32 key) public {
+		m_huge[key].d = 1;
+	}
+}
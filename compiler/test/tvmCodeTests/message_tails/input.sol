@@ -0,0 +1,28 @@
+pragma ton-solidity >= 0.50.0;
+
+contract MessageTails {
+	// The body is declared before the loop: the tail of the message is built once
+	function sendSame(address a, TvmCell body, uint n) public pure {
+		tvm.accept();
+		for (uint i = 0; i < n; ++i) {
+			a.transfer(1 ton, true, 0, body);
+		}
+	}
+
+	// The body is the range declaration: it changes on each iteration
+	function sendEach(address a, TvmCell[] cells) public pure {
+		tvm.accept();
+		for (TvmCell c : cells) {
+			a.transfer(1 ton, true, 0, c);
+		}
+	}
+
+	// The body is declared in the initialization of the loop: it is not on the stack before the loop
+	function sendInit(address a, TvmCell x, uint n) public pure {
+		tvm.accept();
+		uint i = 0;
+		for (TvmCell b = x; i < n; i++) {
+			a.transfer(1 ton, true, 0, b);
+		}
+	}
+}
@@ -0,0 +1,56 @@
+pragma ton-solidity >= 0.50.0;
+
+contract OptionalFlow {
+	struct Pair {
+		uint a;
+		uint b;
+	}
+
+	mapping(uint => uint) m_values;
+
+	// Known after set() and after an assignment of a non-optional value: no null check
+	function afterSet(uint x) public pure returns (uint) {
+		optional(uint) opt;
+		opt.set(x);
+		uint y = opt.get();
+		opt = x + 1;
+		return y + opt.get();
+	}
+
+	// Known after require(hasValue()) and in the guarded branch, the lvalue get() too
+	function guarded(uint key) public view returns (uint sum) {
+		optional(uint) opt = m_values.fetch(key);
+		if (opt.hasValue()) {
+			sum += opt.get();
+		}
+		optional(Pair) pair;
+		pair.set(Pair(1, 2));
+		pair.get().a = 3;
+		require(opt.hasValue(), 101);
+		sum += opt.get() + pair.get().a;
+	}
+
+	// Unknown after reset() and after a loop that changes it: the null check stays
+	function forgotten(uint key, uint n) public view returns (uint) {
+		optional(uint) opt = 1;
+		for (uint i = 0; i < n; ++i) {
+			opt = m_values.fetch(key + i);
+		}
+		uint x = opt.get();
+		opt.reset();
+		opt = m_values.fetch(key);
+		return x + opt.get();
+	}
+
+	// null is not a value: the null checks stay
+	function nullInit() public pure returns (uint) {
+		optional(uint) x = null;
+		return x.get();
+	}
+
+	function nullAssign(uint a) public pure returns (uint) {
+		optional(uint) y = a;
+		y = null;
+		return y.get();
+	}
+}
@@ -0,0 +1,35 @@
+pragma ton-solidity >= 0.50.0;
+
+contract StateVarCache {
+	uint m_total;
+	uint m_count;
+	uint m_limit;
+
+	constructor() public {
+		tvm.accept();
+		m_limit = 10;
+	}
+
+	// The variables are used in the loop, they are kept on the stack. m_total and m_count are saved
+	// before the return and at the end, m_limit is only read.
+	function addAll(uint[] values) public {
+		tvm.accept();
+		for (uint v : values) {
+			if (m_count == m_limit) {
+				return;
+			}
+			m_total += v;
+			++m_count;
+		}
+	}
+
+	// Accessed once, not cached
+	function reset() public {
+		tvm.accept();
+		m_total = 0;
+	}
+
+	function total() public view returns (uint) {
+		return m_total + m_count + m_limit;
+	}
+}
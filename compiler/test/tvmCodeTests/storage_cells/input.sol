@@ -0,0 +1,49 @@
+pragma ton-solidity >= 0.50.0;
+
+// The state variables take four cells of c4: the root cell keeps the pubkey, the timestamp,
+// the constructor flag, m_a and m_b, the next cells keep three uint256 each.
+contract StorageCells {
+	uint m_a;
+	uint m_b;
+	uint m_c;
+	uint m_d;
+	uint m_e;
+	uint m_f;
+	uint m_g;
+	uint m_h;
+	uint m_k;
+
+	constructor() public {
+		tvm.accept();
+	}
+
+	// Only the root cell is rebuilt
+	function setA(uint a) public {
+		tvm.accept();
+		m_a = a;
+	}
+
+	// The variables straddle the root and the second cell
+	function setBC(uint b, uint c) public {
+		tvm.accept();
+		m_b = b;
+		m_c = c;
+	}
+
+	// The third cell is rebuilt together with the cells above it
+	function setF(uint f) public {
+		tvm.accept();
+		m_f = f;
+	}
+
+	// The last cell falls back to the full c7_to_c4
+	function setK(uint k) public {
+		tvm.accept();
+		m_k = k;
+	}
+
+	// The replay protection timestamp is saved in the root cell
+	function getH() public view returns (uint) {
+		return m_h;
+	}
+}
@@ -0,0 +1,38 @@
+pragma ton-solidity >= 0.50.0;
+
+contract TupleArrays {
+	struct Point {
+		uint32 x;
+		uint32 y;
+	}
+
+	// Constant indexes use INDEX and SETINDEX, the length is a constant
+	function constIndexes() public pure returns (uint) {
+		uint[3] a = [uint(1), 2, 3];
+		a[0] = 5;
+		a[2] += a[1];
+		delete a[1];
+		return a[0] + a[1] + a[2] + a.length;
+	}
+
+	// Variable indexes use INDEXVAR and SETINDEXVAR after the bounds check (exit code 50)
+	function varIndexes(uint i, uint j) public pure returns (uint) {
+		uint[4] a = [uint(1), 2, 3, 4];
+		a[i] = a[j] + 1;
+		a[j] *= 2;
+		return a[i] + a[j];
+	}
+
+	function structs(uint i, uint32 x) public pure returns (uint32) {
+		Point[2] points = [Point(1, 2), Point(3, 4)];
+		points[i].x = x;
+		return points[i].y + points[0].x;
+	}
+
+	// The array is returned, so it is a PAIR(size, dict) array
+	function escapes(uint i) public pure returns (uint[3]) {
+		uint[3] a = [uint(1), 2, 3];
+		a[i] = 7;
+		return a;
+	}
+}
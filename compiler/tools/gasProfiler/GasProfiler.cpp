@@ -0,0 +1,438 @@
+/*
+	This file is part of solidity.
+
+	solidity is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	solidity is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with solidity.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <tools/gasProfiler/GasProfiler.h>
+
+#include <libsolutil/CommonIO.h>
+#include <libsolutil/JSON.h>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <climits>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <set>
+
+namespace po = boost::program_options;
+namespace fs = boost::filesystem;
+
+using namespace solidity;
+using namespace solidity::tools;
+using namespace solidity::util;
+using namespace std;
+
+static string const g_argHelp = "help";
+static string const g_argMap = "map";
+static string const g_argTrace = "trace";
+static string const g_argFolded = "folded";
+static string const g_argAnnotate = "annotate";
+static string const g_argBasePath = "base-path";
+
+namespace
+{
+
+/// Decodes a delta-encoded list of the source map: entries are separated by ';', fields by ':',
+/// an empty or missing field takes the value returned by `_implicit` for the previous entry.
+vector<vector<int>> decode(string const& _list, size_t _fields, function<int(size_t, int)> const& _implicit)
+{
+	vector<vector<int>> entries;
+	if (_list.empty())
+		return entries;
+	vector<string> items;
+	boost::split(items, _list, boost::is_any_of(";"));
+	vector<int> prev(_fields, INT_MIN);
+	for (string const& item: items)
+	{
+		vector<string> fields;
+		boost::split(fields, item, boost::is_any_of(":"));
+		vector<int> entry(_fields);
+		for (size_t k = 0; k < _fields; ++k)
+			entry[k] = k < fields.size() && !fields[k].empty() ? stoi(fields[k]) : _implicit(k, prev[k]);
+		entries.push_back(entry);
+		prev = entry;
+	}
+	return entries;
+}
+
+}
+
+bool GasProfiler::parseArguments(int _argc, char** _argv)
+{
+	po::options_description desc(R"(gas-profiler, the gas profiler of TON Solidity contracts.
+
+Replays an execution trace of a local TVM emulator run against the source map
+of the contract and prints where the gas is spent. The contract must be compiled
+with solc --tvm-boc --tvm-source-map (solc built with -DTVM_BOC=ON), and the trace
+must run the code of the *.code.boc file. Contracts deployed from the code that
+the linker assembles cannot be profiled: their cells are not in the map, which
+has only the per-function maps for them.
+
+The trace has one executed instruction per line:
+    <code cell hash in hex> <bit offset in the cell> <gas>
+
+The calls between cells are guessed from the order of the instructions:
+recursion is merged into the outermost call and tail calls are shown as calls.
+
+Usage: gas-profiler --map contract.map.json [options] trace.txt
+
+Allowed options)",
+		po::options_description::m_default_line_length,
+		po::options_description::m_default_line_length - 23
+	);
+	desc.add_options()
+		(g_argHelp.c_str(), "Show help message and exit.")
+		(
+			g_argMap.c_str(),
+			po::value<string>()->value_name("file"),
+			"Source map of the contract (*.map.json)."
+		)
+		(
+			g_argFolded.c_str(),
+			po::value<string>()->value_name("file"),
+			"Write the stacks with their inclusive gas in the folded format of flamegraph.pl."
+		)
+		(
+			g_argAnnotate.c_str(),
+			po::value<string>()->value_name("file"),
+			"Write the source files annotated with the inclusive and exclusive gas of each line."
+		)
+		(
+			g_argBasePath.c_str(),
+			po::value<string>()->value_name("path"),
+			"Directory the source paths of the source map are relative to, i.e. where solc has been run."
+		);
+
+	po::options_description allOptions = desc;
+	allOptions.add_options()(g_argTrace.c_str(), po::value<vector<string>>(), "trace file");
+
+	po::positional_options_description filesPositions;
+	filesPositions.add(g_argTrace.c_str(), -1);
+
+	try
+	{
+		po::command_line_parser cmdLineParser(_argc, _argv);
+		cmdLineParser.style(
+			po::command_line_style::default_style & (~po::command_line_style::allow_guessing)
+		);
+		cmdLineParser.options(allOptions).positional(filesPositions);
+		po::store(cmdLineParser.run(), m_args);
+	}
+	catch (po::error const& _exception)
+	{
+		cerr << _exception.what() << endl;
+		return false;
+	}
+
+	if (m_args.count(g_argHelp) || _argc == 1)
+	{
+		cout << desc;
+		return false;
+	}
+	if (!m_args.count(g_argMap) || !m_args.count(g_argTrace))
+	{
+		cerr << "Both the source map and the trace are required, see --help." << endl;
+		return false;
+	}
+	return true;
+}
+
+bool GasProfiler::processInput()
+{
+	if (!readSourceMap(m_args[g_argMap].as<string>()))
+		return false;
+	for (string const& trace: m_args[g_argTrace].as<vector<string>>())
+		if (!readTrace(trace))
+			return false;
+	if (m_unknownCellSteps > 0)
+		cerr << "Warning: " << m_unknownCellSteps << " of " << m_steps << " instructions ran in cells that are "
+			<< "not in the source map. Only the code of " << m_codeFile << " can be mapped, "
+			<< "not the code assembled by the linker." << endl;
+
+	printFunctions(cout);
+	auto write = [&](string const& _arg, void (GasProfiler::*_print)(ostream&) const) {
+		if (!m_args.count(_arg))
+			return true;
+		string const path = m_args[_arg].as<string>();
+		ofstream file(path);
+		if (!file)
+		{
+			cerr << "Failed to open the output file: " << path << endl;
+			return false;
+		}
+		(this->*_print)(file);
+		cout << "Written to " << path << endl;
+		return true;
+	};
+	return write(g_argFolded, &GasProfiler::printFolded) && write(g_argAnnotate, &GasProfiler::printAnnotated);
+}
+
+bool GasProfiler::readSourceMap(fs::path const& _path)
+{
+	Json::Value map;
+	string errors;
+	if (!jsonParseStrict(readFileAsString(_path.string()), map, &errors) || !map.isObject())
+	{
+		cerr << "Failed to read the source map " << _path.string() << ": " << errors << endl;
+		return false;
+	}
+	if (map["version"].asInt() != 1)
+	{
+		cerr << "Unsupported version of the source map: " << map["version"] << endl;
+		return false;
+	}
+
+	auto same = [](size_t, int _prev) { return _prev; };
+	for (Json::Value const& source: map["sources"])
+		m_sources.push_back(source.asString());
+	for (Json::Value const& function: map["functions"])
+	{
+		m_functionNames.push_back(function["name"].asString());
+		m_spans.emplace_back();
+		for (vector<int> const& e: decode(function["map"].asString(), 5, same))
+			m_spans.back().push_back({e[0], e[1], e[2], e[3], e[4]});
+	}
+	for (Json::Value const& frame: map["frames"])
+		m_frames.push_back({frame[0].asUInt(), frame[1].asInt(), frame[2].asInt()});
+	if (!map.isMember("cells"))
+	{
+		cerr << "The source map " << _path.string() << " has no code cells. "
+			<< "Compile the contract with both --tvm-source-map and --tvm-boc, "
+			<< "the latter needs solc built with -DTVM_BOC=ON." << endl;
+		return false;
+	}
+	m_codeFile = map["codeFile"].asString();
+	for (string const& hash: map["cells"].getMemberNames())
+	{
+		vector<Mark>& marks = m_cells[boost::to_lower_copy(hash)];
+		size_t offset = 0;
+		auto implicit = [](size_t _k, int _prev) { return _k == 2 && _prev != INT_MIN ? _prev + 1 : _prev; };
+		for (vector<int> const& e: decode(map["cells"][hash].asString(), 3, implicit))
+		{
+			offset += static_cast<size_t>(e[0]);
+			marks.push_back({offset, e[1], e[2]});
+		}
+	}
+	m_functionGas.resize(m_functionNames.size());
+	return true;
+}
+
+bool GasProfiler::readTrace(fs::path const& _path)
+{
+	ifstream trace(_path.string());
+	if (!trace)
+	{
+		cerr << "Failed to read the trace " << _path.string() << endl;
+		return false;
+	}
+	string line;
+	for (size_t lineNo = 1; getline(trace, line); ++lineNo)
+	{
+		boost::trim(line);
+		if (line.empty() || line[0] == '#')
+			continue;
+		vector<string> fields;
+		boost::split(fields, line, boost::is_any_of(" \t,"), boost::token_compress_on);
+		if (fields.size() != 3)
+		{
+			cerr << _path.string() << ":" << lineNo << ": expected <cell hash> <offset> <gas>" << endl;
+			return false;
+		}
+		string cell = boost::to_lower_copy(fields[0]);
+		if (boost::starts_with(cell, "0x"))
+			cell = cell.substr(2);
+		try
+		{
+			uint64_t const gas = stoull(fields[2]);
+			record(resolve(cell, stoull(fields[1])), gas);
+		}
+		catch (logic_error const&)
+		{
+			cerr << _path.string() << ":" << lineNo << ": bad number" << endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+GasProfiler::Stack GasProfiler::resolve(string const& _cell, size_t _offset)
+{
+	auto cell = m_cells.find(_cell);
+	if (cell == m_cells.end())
+	{
+		++m_unknownCellSteps;
+		return {};
+	}
+	vector<Mark> const& marks = cell->second;
+	auto mark = lower_bound(marks.begin(), marks.end(), _offset, [](Mark const& _mark, size_t _value) {
+		return _mark.offset < _value;
+	});
+	if (mark == marks.end() || mark->offset != _offset)
+		return {};
+
+	Stack stack;
+	int index = mark->index;
+	for (int frame = mark->frame; frame != -1; frame = m_frames.at(static_cast<size_t>(frame)).parent)
+	{
+		Frame const& f = m_frames.at(static_cast<size_t>(frame));
+		stack.push_back({f.function, index});
+		index = f.call;
+	}
+	reverse(stack.begin(), stack.end());
+
+	if (!isEntryPoint(stack.front().function))
+	{
+		size_t const outermost = stack.front().function;
+		auto entered = find_if(m_context.rbegin(), m_context.rend(), [&](Location const& _location) {
+			return _location.function == outermost;
+		});
+		// Called from the previous instruction if the function is not on the stack yet
+		auto end = entered == m_context.rend() ? m_context.end() : prev(entered.base());
+		stack.insert(stack.begin(), m_context.begin(), end);
+	}
+	m_context = stack;
+	return stack;
+}
+
+void GasProfiler::record(Stack const& _stack, uint64_t _gas)
+{
+	++m_steps;
+	m_totalGas += _gas;
+	if (_stack.empty())
+	{
+		m_unmappedGas += _gas;
+		m_foldedGas["[unmapped]"] += _gas;
+		return;
+	}
+
+	string folded;
+	set<size_t> functions;
+	set<pair<int, int>> lines;
+	for (Location const& location: _stack)
+	{
+		if (!folded.empty())
+			folded += ';';
+		folded += m_functionNames.at(location.function);
+		// Recursive calls are counted once
+		if (functions.insert(location.function).second)
+			m_functionGas[location.function].inclusive += _gas;
+		if (Span const* s = span(location))
+			if (lines.insert({s->source, s->line}).second)
+				m_lineGas[{s->source, s->line}].inclusive += _gas;
+	}
+	m_foldedGas[folded] += _gas;
+	m_functionGas[_stack.back().function].exclusive += _gas;
+	if (Span const* s = span(_stack.back()))
+		m_lineGas[{s->source, s->line}].exclusive += _gas;
+}
+
+GasProfiler::Span const* GasProfiler::span(Location const& _location) const
+{
+	vector<Span> const& spans = m_spans.at(_location.function);
+	if (_location.index < 0 || static_cast<size_t>(_location.index) >= spans.size())
+		return nullptr;
+	Span const& s = spans[static_cast<size_t>(_location.index)];
+	return s.source < 0 || s.line <= 0 ? nullptr : &s;
+}
+
+bool GasProfiler::isEntryPoint(size_t _function) const
+{
+	string const& name = m_functionNames.at(_function);
+	return name == "main_internal" || name == "main_external" || name == "onTickTock" || name == "onCodeUpgrade";
+}
+
+void GasProfiler::printFunctions(ostream& _out) const
+{
+	vector<size_t> order;
+	for (size_t i = 0; i < m_functionGas.size(); ++i)
+		if (m_functionGas[i].inclusive > 0)
+			order.push_back(i);
+	stable_sort(order.begin(), order.end(), [&](size_t _a, size_t _b) {
+		return m_functionGas[_a].inclusive > m_functionGas[_b].inclusive;
+	});
+
+	auto percent = [&](uint64_t _gas) {
+		ostringstream s;
+		s << fixed << setprecision(1) << (m_totalGas == 0 ? 0.0 : 100.0 * double(_gas) / double(m_totalGas)) << '%';
+		return s.str();
+	};
+	_out << "Instructions: " << m_steps << ", gas: " << m_totalGas
+		<< ", unmapped gas: " << m_unmappedGas << " (" << percent(m_unmappedGas) << ")" << endl << endl;
+	_out << setw(12) << "inclusive" << setw(8) << "" << setw(12) << "exclusive" << setw(8) << "" << "  function" << endl;
+	for (size_t i: order)
+	{
+		Gas const& gas = m_functionGas[i];
+		_out << setw(12) << gas.inclusive << setw(8) << percent(gas.inclusive)
+			<< setw(12) << gas.exclusive << setw(8) << percent(gas.exclusive)
+			<< "  " << m_functionNames[i] << endl;
+	}
+}
+
+void GasProfiler::printFolded(ostream& _out) const
+{
+	for (auto const& [stack, gas]: m_foldedGas)
+		_out << stack << ' ' << gas << '\n';
+}
+
+void GasProfiler::printAnnotated(ostream& _out) const
+{
+	fs::path const basePath = m_args.count(g_argBasePath) ? m_args[g_argBasePath].as<string>() : fs::path{};
+	for (size_t source = 0; source < m_sources.size(); ++source)
+	{
+		auto begin = m_lineGas.lower_bound({static_cast<int>(source), 0});
+		auto end = m_lineGas.lower_bound({static_cast<int>(source) + 1, 0});
+		if (begin == end)
+			continue;
+
+		_out << "======= " << m_sources[source] << " =======" << endl;
+		_out << setw(12) << "inclusive" << setw(12) << "exclusive" << " |" << endl;
+		auto printGas = [&](int _line) {
+			auto it = m_lineGas.find({static_cast<int>(source), _line});
+			if (it == m_lineGas.end())
+				_out << setw(24) << "";
+			else
+				_out << setw(12) << it->second.inclusive << setw(12) << it->second.exclusive;
+		};
+
+		fs::path const path = basePath / m_sources[source];
+		string const text = fs::exists(path) ? readFileAsString(path.string()) : string{};
+		if (text.empty())
+		{
+			// Only the lines with gas are known
+			for (auto it = begin; it != end; ++it)
+			{
+				printGas(it->first.second);
+				_out << " | line " << it->first.second << endl;
+			}
+		}
+		else
+		{
+			vector<string> lines;
+			boost::split(lines, text, boost::is_any_of("\n"));
+			if (!lines.empty() && lines.back().empty())
+				lines.pop_back();
+			for (size_t i = 0; i < lines.size(); ++i)
+			{
+				printGas(static_cast<int>(i) + 1);
+				_out << " | " << lines[i] << endl;
+			}
+		}
+		_out << endl;
+	}
+}
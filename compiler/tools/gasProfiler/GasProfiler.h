@@ -0,0 +1,147 @@
+/*
+	This file is part of solidity.
+
+	solidity is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	solidity is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with solidity.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <boost/filesystem/path.hpp>
+#include <boost/program_options.hpp>
+
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace solidity::tools
+{
+
+/**
+ * Gas profiler that replays an execution trace of a local TVM emulator run against
+ * the source map emitted by the compiler (solc --tvm-boc --tvm-source-map). Only the code
+ * cells of *.code.boc are mapped, the code that the linker assembles for deployment is not.
+ *
+ * The trace is a text file with one executed instruction per line:
+ *     <code cell hash in hex> <bit offset in the cell> <gas>
+ * Fields may be separated by spaces, tabs or commas, lines starting with '#' are ignored.
+ *
+ * The profile is printed per function and, optionally, as flamegraph folded stacks
+ * and as the annotated source with inclusive and exclusive gas of each line.
+ *
+ * The trace has no call stack, so the calls between cells are guessed, see resolve().
+ * Code inlined into a cell is attributed exactly, the guess is wrong for:
+ *  - recursion, direct or through other functions: a function that is already on the stack
+ *    is taken for a return to it, so all the levels are merged into the outermost one and
+ *    the functions called in between lose the gas of the inner levels. This includes a macro
+ *    that is inlined into f and calls g, which calls the same macro from its own cell;
+ *  - tail calls (JMPX, JMPREF, IFJMPREF to a function) are taken for calls, the function
+ *    that jumped stays on the stack until one of its callers is reached again;
+ *  - instructions that are not in the source map keep the stack of the last mapped one,
+ *    so the code that they call is attached to that stack.
+ */
+class GasProfiler
+{
+public:
+	/// Parse command line arguments and return false in case of a failure.
+	bool parseArguments(int _argc, char** _argv);
+	/// Reads the source map and the trace and prints the profiles.
+	bool processInput();
+
+private:
+	/// Source range of an instruction, source is -1 if unknown.
+	struct Span
+	{
+		int start;
+		int length;
+		int source;
+		int line;
+		int column;
+	};
+	/// Function inlined into the parent frame by the call instruction with the index `call`.
+	struct Frame
+	{
+		size_t function;
+		int parent;
+		int call;
+	};
+	/// Instruction of a frame at the bit offset of a code cell.
+	struct Mark
+	{
+		size_t offset;
+		int frame;
+		int index;
+	};
+	/// Instruction of a function that is being executed.
+	struct Location
+	{
+		size_t function;
+		int index;
+	};
+	/// Outermost function first.
+	using Stack = std::vector<Location>;
+	/// Inclusive and exclusive gas.
+	struct Gas
+	{
+		uint64_t inclusive = 0;
+		uint64_t exclusive = 0;
+	};
+
+	bool readSourceMap(boost::filesystem::path const& _path);
+	bool readTrace(boost::filesystem::path const& _path);
+
+	/// Returns the stack of the instruction at the offset of the cell, empty if it is not mapped.
+	/// The static frames of the source map are attached to the dynamic context of the previous
+	/// instruction: a cell that starts in the middle of the call stack, e.g. the body of a function
+	/// called by id or code of a macro stored in a separate cell, continues the stack where this
+	/// function has been entered.
+	Stack resolve(std::string const& _cell, size_t _offset);
+	void record(Stack const& _stack, uint64_t _gas);
+	/// Returns nullptr if the instruction has no known source line.
+	Span const* span(Location const& _location) const;
+	bool isEntryPoint(size_t _function) const;
+
+	void printFunctions(std::ostream& _out) const;
+	void printFolded(std::ostream& _out) const;
+	void printAnnotated(std::ostream& _out) const;
+
+	/// Command line arguments
+	boost::program_options::variables_map m_args;
+
+	/// Source map
+	std::vector<std::string> m_sources;
+	std::vector<std::string> m_functionNames;
+	std::vector<std::vector<Span>> m_spans;
+	std::vector<Frame> m_frames;
+	/// Marks of the code cells sorted by offset
+	std::map<std::string, std::vector<Mark>> m_cells;
+	/// Name of the *.code.boc file the cells belong to
+	std::string m_codeFile;
+
+	/// Stack of the previous instruction
+	Stack m_context;
+	/// Gas per function
+	std::vector<Gas> m_functionGas;
+	/// Gas per source and line
+	std::map<std::pair<int, int>, Gas> m_lineGas;
+	/// Gas per folded stack
+	std::map<std::string, uint64_t> m_foldedGas;
+	uint64_t m_totalGas = 0;
+	uint64_t m_unmappedGas = 0;
+	size_t m_steps = 0;
+	/// Number of the instructions in cells that are not in the source map
+	size_t m_unknownCellSteps = 0;
+};
+
+}
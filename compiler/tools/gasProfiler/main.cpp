@@ -0,0 +1,27 @@
+/*
+	This file is part of solidity.
+
+	solidity is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	solidity is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with solidity.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <tools/gasProfiler/GasProfiler.h>
+
+int main(int argc, char** argv)
+{
+	solidity::tools::GasProfiler profiler;
+	if (!profiler.parseArguments(argc, argv))
+		return 1;
+	if (!profiler.processInput())
+		return 1;
+	return 0;
+}